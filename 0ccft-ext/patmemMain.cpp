@@ -0,0 +1,84 @@
+#include "FamiTrackerModule.h"
+#include "SongData.h"
+#include "PatternData.h"
+#include "DocumentFile.h"
+#include "FamiTrackerDocIO.h"
+#include "FamiTrackerDocOldIO.h"
+#include "ModuleException.h"
+#include "ft0cc/doc/pattern_note.hpp"
+
+#include <iostream>
+#include <chrono>
+
+namespace {
+
+std::unique_ptr<CFamiTrackerModule> LoadModule(const fs::path &fname) {
+	CDocumentFile file;
+	file.Open(fname);
+	file.ValidateFile();
+	if (file.GetFileVersion() < 0x0200u)
+		return compat::OpenDocumentOld(file.GetBinaryReader());
+	return CFamiTrackerDocReader {file, module_error_level_t::MODULE_ERROR_DEFAULT}.Load();
+}
+
+int PrintUsage(const char *prog) {
+	std::cerr << "Usage: " << prog << " <module> [module...]\n";
+	return 1;
+}
+
+} // namespace
+
+// reports the pattern row storage of the given modules, compared to allocating
+// every row of every non-blank pattern
+int main(int argc, char *argv[]) try {
+	if (argc < 2)
+		return PrintUsage(argv[0]);
+
+	std::size_t totalPatterns = 0u;
+	std::size_t totalFull = 0u;
+	std::size_t totalRows = 0u;
+
+	for (int i = 1; i < argc; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		auto modfile = LoadModule(argv[i]);
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+		std::size_t patterns = 0u;
+		std::size_t full = 0u;
+		std::size_t rows = 0u;
+		modfile->VisitSongs([&] (const CSongData &song) {
+			song.VisitPatterns([&] (const CPatternData &pattern) {
+				if (const unsigned capacity = pattern.GetCapacity()) {
+					++patterns;
+					full += pattern.GetMaximumSize();
+					rows += capacity;
+				}
+			});
+		});
+
+		std::cout << argv[i] << ": " << patterns << " allocated pattern(s), "
+			<< full * sizeof(ft0cc::doc::pattern_note) << " -> " << rows * sizeof(ft0cc::doc::pattern_note)
+			<< " bytes of rows, loaded in " << elapsed.count() << " us\n";
+		totalPatterns += patterns;
+		totalFull += full;
+		totalRows += rows;
+	}
+
+	if (argc > 2)
+		std::cout << "total: " << totalPatterns << " allocated pattern(s), "
+			<< totalFull * sizeof(ft0cc::doc::pattern_note) << " -> " << totalRows * sizeof(ft0cc::doc::pattern_note)
+			<< " bytes of rows\n";
+	return 0;
+}
+catch (CModuleException &e) {
+	std::cerr << e.GetErrorString() << '\n';
+	return 1;
+}
+catch (std::exception &e) {
+	std::cerr << "C++ exception: " << e.what() << '\n';
+	return 1;
+}
+catch (...) {
+	std::cerr << "Unknown exception\n";
+	return 1;
+}
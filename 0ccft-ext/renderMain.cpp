@@ -0,0 +1,126 @@
+#include "FamiTrackerModule.h"
+#include "FamiTrackerEnv.h"
+#include "SoundChipService.h"
+#include "ChannelOrder.h"
+#include "DocumentFile.h"
+#include "FamiTrackerDocIO.h"
+#include "FamiTrackerDocOldIO.h"
+#include "ModuleException.h"
+#include "BinaryFileStream.h"
+#include "OfflineRenderer.h"
+#include "WaveRenderer.h"
+#include "WaveRendererFactory.h"
+#include "WaveStream.h"
+#include "APU/RegisterCapture.h"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+
+namespace {
+
+std::unique_ptr<CFamiTrackerModule> LoadModule(const fs::path &fname) {
+	CDocumentFile file;
+	file.Open(fname);
+	file.ValidateFile();
+	if (file.GetFileVersion() < 0x0200u)
+		return compat::OpenDocumentOld(file.GetBinaryReader());
+	return CFamiTrackerDocReader {file, module_error_level_t::MODULE_ERROR_DEFAULT}.Load();
+}
+
+int PrintUsage(const char *prog) {
+	std::cerr << "Usage: " << prog << " <module> <output.wav> [track] [loops|seconds] [count] [sample rate] [sample size] [register log|-] [stem prefix]\n";
+	return 1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) try {
+	if (argc < 3)
+		return PrintUsage(argv[0]);
+
+	unsigned track = argc > 3 ? std::stoul(argv[3]) : 0u;
+	render_type_t type = render_type_t::Loops;
+	if (argc > 4) {
+		if (std::string {argv[4]} == "seconds")
+			type = render_type_t::Seconds;
+		else if (std::string {argv[4]} != "loops")
+			return PrintUsage(argv[0]);
+	}
+	unsigned count = argc > 5 ? std::stoul(argv[5]) : (type == render_type_t::Loops ? 1u : 60u);
+
+	stOfflineRenderSettings settings;
+	if (argc > 6)
+		settings.SampleRate = std::stoul(argv[6]);
+	if (argc > 7)
+		settings.SampleSize = std::stoul(argv[7]);
+
+	auto modfile = LoadModule(argv[1]);
+	if (!modfile)
+		throw std::runtime_error {"Could not load module"};
+	if (track >= modfile->GetSongCount())
+		throw std::runtime_error {"Track index out of range"};
+
+	std::shared_ptr<CWaveRenderer> pRender = CWaveRendererFactory::Make(*modfile, track, type, count);
+	if (!pRender)
+		throw std::runtime_error {"Nothing to render"};
+	pRender->SetRenderTrack(track);
+
+	const CWaveFileFormat format {
+		CWaveFileFormat::format_code::pcm,
+		1,
+		static_cast<std::uint32_t>(settings.SampleRate),
+		static_cast<std::uint16_t>(settings.SampleSize),
+	};
+	auto pFile = std::make_shared<CBinaryFileStream>(argv[2], std::ios::out | std::ios::binary);
+	pRender->SetOutputStream(std::make_unique<COutputWaveStream>(pFile, format));
+
+	// one file per channel, rendered in the same pass as the main output
+	std::vector<std::shared_ptr<CBinaryFileStream>> stemFiles;
+	if (argc > 9)
+		modfile->GetChannelOrder().ForeachChannel([&] (stChannelID ch) {
+			std::string fname = argv[9] + std::string {FTEnv.GetSoundChipService()->GetChannelShortName(ch)} + ".wav";
+			auto pStemFile = std::make_shared<CBinaryFileStream>(fname, std::ios::out | std::ios::binary);
+			pRender->SetStemStream(ch, std::make_unique<COutputWaveStream>(pStemFile, format));
+			stemFiles.push_back(std::move(pStemFile));
+		});
+
+	COfflineRenderer renderer {*modfile, settings};
+	const CRegisterCapture *pCapture = argc > 8 && std::string {argv[8]} != "-" ? &renderer.StartRegisterCapture() : nullptr;
+
+	auto start = std::chrono::steady_clock::now();
+	renderer.Render(std::move(pRender));
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	pFile->Close();
+	for (auto &pStemFile : stemFiles)
+		pStemFile->Close();
+
+	if (pCapture) {
+		auto log = pCapture->GetLog();
+		CBinaryFileStream logfile {argv[8], std::ios::out | std::ios::binary};
+		logfile.WriteBytes({reinterpret_cast<const std::byte *>(log.data()), log.size()});
+		logfile.Close();
+	}
+
+	double frames = renderer.GetFrameCount();
+	double seconds = elapsed.count();
+	std::cout << "Rendered " << renderer.GetFrameCount() << " frames ("
+		<< frames / renderer.GetFrameRate() << " s of audio) in " << seconds << " s\n";
+	if (seconds > 0.)
+		std::cout << frames / seconds << " frames per second ("
+			<< frames / renderer.GetFrameRate() / seconds << "x realtime)\n";
+	return 0;
+}
+catch (CModuleException &e) {
+	std::cerr << e.GetErrorString() << '\n';
+	return 1;
+}
+catch (std::exception &e) {
+	std::cerr << "C++ exception: " << e.what() << '\n';
+	return 1;
+}
+catch (...) {
+	std::cerr << "Unknown exception\n";
+	return 1;
+}
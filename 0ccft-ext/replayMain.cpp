@@ -0,0 +1,99 @@
+#include "APU/APU.h"
+#include "APU/RegisterCapture.h"
+#include "BinaryFileStream.h"
+#include "OfflineRenderer.h"
+#include "WaveStream.h"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace {
+
+int PrintUsage(const char *prog) {
+	std::cerr << "Usage: " << prog << " <register log> <output.wav> [sample rate] [sample size]\n";
+	return 1;
+}
+
+std::vector<std::uint8_t> LoadLog(const fs::path &fname) {
+	CBinaryFileStream file {fname, std::ios::in | std::ios::binary};
+	if (!file)
+		throw std::runtime_error {"Could not open register log"};
+	std::vector<std::uint8_t> log(fs::file_size(fname));
+	file.ReadBuffer({reinterpret_cast<std::byte *>(log.data()), log.size()});
+	return log;
+}
+
+// writes the APU output straight to a wave stream
+class CReplayOutput : public IAudioCallback {
+public:
+	explicit CReplayOutput(std::unique_ptr<COutputWaveStream> pWave) : wave_(std::move(pWave)) {
+		wave_->WriteWAVHeader();
+	}
+
+	void FlushBuffer(array_view<const int16_t> Buffer) override {
+		wave_->WriteSamples(Buffer);
+	}
+	bool PlayBuffer() override {
+		return true;
+	}
+
+private:
+	std::unique_ptr<COutputWaveStream> wave_;
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) try {
+	if (argc < 3)
+		return PrintUsage(argv[0]);
+
+	stOfflineRenderSettings settings;
+	if (argc > 3)
+		settings.SampleRate = std::stoul(argv[3]);
+	if (argc > 4)
+		settings.SampleSize = std::stoul(argv[4]);
+
+	std::vector<std::uint8_t> log = LoadLog(argv[1]);
+	CRegisterReplayer replayer {log};
+
+	auto pFile = std::make_shared<CBinaryFileStream>(argv[2], std::ios::out | std::ios::binary);
+	{
+		CReplayOutput output {std::make_unique<COutputWaveStream>(pFile, CWaveFileFormat {
+			CWaveFileFormat::format_code::pcm,
+			1,
+			static_cast<std::uint32_t>(settings.SampleRate),
+			static_cast<std::uint16_t>(settings.SampleSize),
+		})};
+
+		// same setup order as COfflineRenderer
+		CAPU apu {&output};
+		if (!apu.SetupSound(settings.SampleRate, 1, replayer.GetMachine()))
+			throw std::runtime_error {"Could not allocate sound buffer"};
+		apu.SetupMixer(settings.BassFilter, settings.TrebleFilter, settings.TrebleDamping, settings.MixVolume);
+		apu.EnableMetering(settings.ChannelMeters);
+		replayer.ConfigureAPU(apu);
+
+		auto start = std::chrono::steady_clock::now();
+		unsigned frames = 0u;
+		while (replayer.ReplayFrame(apu))
+			++frames;
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		double seconds = elapsed.count();
+		std::cout << "Replayed " << frames << " frames in " << seconds << " s\n";
+		if (seconds > 0.)
+			std::cout << frames / seconds << " frames per second\n";
+	}
+	pFile->Close();
+	return 0;
+}
+catch (std::exception &e) {
+	std::cerr << "C++ exception: " << e.what() << '\n';
+	return 1;
+}
+catch (...) {
+	std::cerr << "Unknown exception\n";
+	return 1;
+}
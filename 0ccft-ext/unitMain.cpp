@@ -0,0 +1,832 @@
+#include "FamiTrackerModule.h"
+#include "FamiTrackerEnv.h"
+#include "SoundChipService.h"
+#include "SoundChipSet.h"
+#include "ChannelMap.h"
+#include "ChannelOrder.h"
+#include "SongData.h"
+#include "PatternData.h"
+#include "SongState.h"
+#include "RegisterState.h"
+#include "Kraid.h"
+#include "InstrumentManager.h"
+#include "Instrument.h"
+#include "SeqInstrument.h"
+#include "Sequence.h"
+#include "Compiler.h"
+#include "BinaryStream.h"
+#include "OfflineRenderer.h"
+#include "WaveRenderer.h"
+#include "WaveRendererFactory.h"
+#include "WaveStream.h"
+#include "APU/APU.h"
+#include "APU/RegisterCapture.h"
+#include "ext/Blip_Buffer/Blip_Buffer.h"
+#include "ext/emu/emu2413.h"
+#include "ft0cc/doc/pattern_note.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// deterministic tests of the caches and fast paths against the results computed
+// without them
+
+namespace {
+
+void Check(bool cond, const std::string &what) {
+	if (!cond)
+		throw std::runtime_error {"Check failed: " + what};
+}
+
+std::mt19937 rng;
+
+unsigned R(unsigned n) {
+	return static_cast<unsigned>(rng() % n);
+}
+
+void MakeChips(CFamiTrackerModule &modfile, CSoundChipSet chips, unsigned n163chs) {
+	modfile.SetChannelMap(FTEnv.GetSoundChipService()->MakeChannelMap(chips, n163chs));
+}
+
+// pattern use counts after frame edits match a scan of the frame list
+void TestPatternUses() {
+	rng.seed(1u);
+	CFamiTrackerModule modfile;
+	MakeChips(modfile, sound_chip_t::APU, 0);
+	CSongData &song = *modfile.GetSong(0);
+	auto other = modfile.MakeNewSong();
+	const unsigned PATTERNS = 8;
+
+	auto verify = [&] (const CSongData &s, int step) {
+		modfile.GetChannelOrder().ForeachChannel([&] (stChannelID ch) {
+			for (unsigned p = 0; p < PATTERNS; ++p) {
+				bool used = false;
+				for (unsigned f = 0; f < s.GetFrameCount(); ++f)
+					if (s.GetFramePattern(f, ch) == p)
+						used = true;
+				Check(s.IsPatternInUse(ch, p) == used, "pattern use count, step " + std::to_string(step));
+			}
+		});
+	};
+
+	for (int step = 0; step < 2000; ++step) {
+		CSongData &s = R(4) ? song : *other;
+		const unsigned frames = s.GetFrameCount();
+		switch (R(6)) {
+		case 0:
+			modfile.GetChannelOrder().ForeachChannel([&] (stChannelID ch) {
+				s.SetFramePattern(R(frames), ch, R(PATTERNS));
+			});
+			break;
+		case 1:
+			s.InsertFrame(R(frames + 1));
+			break;
+		case 2:
+			s.DeleteFrames(R(frames), 1 + R(3));
+			break;
+		case 3:
+			s.SwapFrames(R(frames), R(frames));
+			break;
+		case 4:
+			s.SetFrameCount(1 + R(32));
+			break;
+		case 5:
+			modfile.GetChannelOrder().ForeachChannel([&] (stChannelID ch) {
+				s.CopyTrack(ch, &s == &song ? *other : song, ch);
+			});
+			break;
+		}
+		verify(song, step);
+		verify(*other, step);
+	}
+}
+
+ft0cc::doc::pattern_note RandomNote(unsigned fxcols, unsigned density) {
+	using namespace ft0cc::doc;
+	pattern_note note;
+	if (R(100) >= density)
+		return note;
+	switch (unsigned k = R(20)) {
+	case 0: note.set_note(pitch::halt); break;
+	case 1: note.set_note(pitch::release); break;
+	case 2: case 3: case 4: note.set_note(pitch::echo); note.set_oct(R(6)); break;
+	default: note.set_note(enum_cast<pitch>(1 + k % 12)); note.set_oct(R(8));
+	}
+	if (R(3) == 0)
+		note.set_inst(R(4));
+	if (R(3) == 0)
+		note.set_vol(R(16));
+	for (unsigned c = 0; c < fxcols; ++c)
+		if (R(4) == 0) {
+			auto fx = enum_cast<effect_type>(1 + R(value_cast(effect_type::max)));
+			if (fx == effect_type::HALT || fx == effect_type::JUMP || fx == effect_type::SKIP)
+				continue;
+			note.set_fx_cmd(c, {fx, static_cast<unsigned char>(R(4) == 0 ? 0xE0 + R(4) : R(256))});
+		}
+	return note;
+}
+
+// pattern copies share rows until one of them is written, and writes never reach other copies
+void TestPatternCopies() {
+	rng.seed(4u);
+	const unsigned ROWS = 256u;
+	std::vector<ft0cc::doc::pattern_note> ref(ROWS);
+	CPatternData original;
+	for (unsigned r = 0; r < ROWS; r += 1 + R(8)) {
+		ref[r] = RandomNote(4, 100);
+		original.SetNoteOn(r, ref[r]);
+	}
+	const std::uint64_t version = original.GetVersion();
+	Check(version != 0u, "version of a written pattern");
+
+	CPatternData copy = original;
+	Check(copy == original && copy.GetVersion() == version, "copied pattern");
+	copy.SetNoteOn(10u, copy.GetNoteOn(10u));
+	Check(copy.GetVersion() == version, "version after writing an unchanged note");
+
+	std::vector<CPatternData> copies(4, original);
+	for (int i = 0; i < 400; ++i) {
+		auto &pat = copies[R(static_cast<unsigned>(copies.size()))];
+		const std::uint64_t before = pat.GetVersion();
+		auto note = RandomNote(4, 80);
+		unsigned row = R(ROWS);
+		bool changed = pat.GetNoteOn(row) != note;
+		pat.SetNoteOn(row, note);
+		Check(pat.GetNoteOn(row) == note, "written note");
+		Check(changed == (pat.GetVersion() != before), "version after a write");
+	}
+
+	for (unsigned r = 0; r < ROWS; ++r)
+		Check(original.GetNoteOn(r) == ref[r] && copy.GetNoteOn(r) == ref[r], "rows of the original pattern");
+	Check(original.GetVersion() == version, "version of the original pattern");
+
+	CPatternData moved = std::move(copy);
+	Check(moved == original && copy.GetCapacity() == 0u && copy.GetVersion() == 0u, "moved pattern");
+	copy = moved;
+	ft0cc::doc::pattern_note halt;
+	halt.set_note(ref[0].note() == ft0cc::doc::pitch::halt ? ft0cc::doc::pitch::release : ft0cc::doc::pitch::halt);
+	copy.SetNoteOn(0u, halt);
+	Check(copy.GetNoteOn(0u) == halt && moved == original, "pattern assigned from a copy");
+}
+
+bool SameState(const CSongState &a, const CSongState &b) {
+	if (a.Tempo != b.Tempo || a.Speed != b.Speed || a.GroovePos != b.GroovePos || a.State.size() != b.State.size())
+		return false;
+	for (const auto &[id, x] : a.State) {
+		auto it = b.State.find(id);
+		if (it == b.State.end())
+			return false;
+		const auto &y = it->second;
+		if (x.Instrument != y.Instrument || x.Volume != y.Volume || x.Effect != y.Effect ||
+			x.Effect_LengthCounter != y.Effect_LengthCounter || x.Effect_AutoFMMult != y.Effect_AutoFMMult || x.Echo != y.Echo)
+			return false;
+	}
+	return true;
+}
+
+// seeks using cached checkpoints match cold seeks, also after the song has been edited
+void TestSongStateCache() {
+	rng.seed(3u);
+	CFamiTrackerModule modfile;
+	MakeChips(modfile, CSoundChipSet {sound_chip_t::APU}.WithChip(sound_chip_t::VRC6)
+		.WithChip(sound_chip_t::FDS).WithChip(sound_chip_t::N163), 2);
+
+	CSongData &song = *modfile.GetSong(0);
+	const unsigned FRAMES = 24, ROWS = 32, PATTERNS = 6;
+	song.SetFrameCount(FRAMES);
+	song.SetPatternLength(ROWS);
+
+	std::vector<stChannelID> channels;
+	modfile.GetChannelOrder().ForeachChannel([&] (stChannelID ch) {
+		channels.push_back(ch);
+		song.SetEffectColumnCount(ch, 2);
+		for (unsigned f = 0; f < FRAMES; ++f)
+			song.SetFramePattern(f, ch, R(PATTERNS));
+		for (unsigned p = 0; p < PATTERNS; ++p)
+			for (unsigned r = 0; r < ROWS; ++r)
+				song.GetPattern(ch, p).SetNoteOn(r, RandomNote(2, 30));
+	});
+
+	CSongStateCache cache;
+	for (int round = 0; round < 40; ++round) {
+		for (int q = 0; q < 10; ++q) {
+			unsigned f = R(FRAMES), r = R(ROWS);
+			CSongState cold, cached;
+			cold.Retrieve(modfile, 0, f, r);
+			cached.Retrieve(modfile, 0, f, r, cache);
+			Check(SameState(cold, cached), "cached seek, round " + std::to_string(round));
+		}
+
+		stChannelID ch = channels[R(static_cast<unsigned>(channels.size()))];
+		switch (R(3)) {
+		case 0: song.GetPattern(ch, R(PATTERNS)).SetNoteOn(R(ROWS), RandomNote(2, 100)); break;
+		case 1: song.GetPattern(ch, R(PATTERNS)).SetNoteOn(R(ROWS), { }); break;
+		case 2: song.SetFramePattern(R(FRAMES), ch, R(PATTERNS)); break;
+		}
+	}
+}
+
+// lazily decayed register clocks match registers that are stepped on every tick
+void TestRegisterDecay() {
+	rng.seed(2u);
+	const unsigned LOW = 0x4000, HIGH = 0x4017;
+
+	CRegisterLogger logger;
+	Check(logger.AddRegisterRange(LOW, HIGH), "register range");
+	std::vector<CRegisterState> replay(HIGH - LOW + 1);
+
+	for (int tick = 0; tick < 5000; ++tick) {
+		for (unsigned n = R(4); n > 0; --n) {
+			unsigned addr = LOW + R(HIGH - LOW + 1);
+			auto value = static_cast<std::uint8_t>(R(3) ? R(4) : R(256));
+			logger.SetPort(addr);
+			logger.Write(value);
+			replay[addr - LOW].Update(value);
+		}
+		for (unsigned addr = LOW; addr <= HIGH; ++addr) {
+			auto reg = logger.GetRegister(addr);
+			const auto &ref = replay[addr - LOW];
+			Check(reg && reg->GetValue() == ref.GetValue() &&
+				reg->GetLastUpdatedTime() == ref.GetLastUpdatedTime() &&
+				reg->GetNewValueTime() == ref.GetNewValueTime(), "decayed register, tick " + std::to_string(tick));
+		}
+		logger.Step();
+		for (auto &r : replay)
+			r.Step();
+	}
+	Check(!logger.GetRegister(HIGH + 1), "register outside of range");
+}
+
+// collects written bytes in memory
+class CMemoryWriter : public CBinaryWriter {
+public:
+	std::size_t WriteBytes(array_view<const std::byte> buf) override {
+		if (pos_ + buf.size() > data_.size())
+			data_.resize(pos_ + buf.size());
+		std::copy(buf.begin(), buf.end(), data_.begin() + pos_);
+		pos_ += buf.size();
+		return buf.size();
+	}
+	void SeekWriter(std::size_t pos) override {
+		pos_ = pos;
+	}
+	std::size_t GetWriterPos() override {
+		return pos_;
+	}
+
+	const std::vector<std::byte> &GetData() const {
+		return data_;
+	}
+
+private:
+	std::vector<std::byte> data_;
+	std::size_t pos_ = 0u;
+};
+
+std::unique_ptr<COutputWaveStream> MakeWaveStream(std::shared_ptr<CBinaryWriter> pFile, const stOfflineRenderSettings &settings) {
+	return std::make_unique<COutputWaveStream>(std::move(pFile), CWaveFileFormat {
+		CWaveFileFormat::format_code::pcm,
+		1,
+		static_cast<std::uint32_t>(settings.SampleRate),
+		static_cast<std::uint16_t>(settings.SampleSize),
+	});
+}
+
+std::shared_ptr<CWaveRenderer> MakeRenderer(const CFamiTrackerModule &modfile, const stOfflineRenderSettings &settings,
+	std::shared_ptr<CBinaryWriter> pFile) {
+	auto pRender = CWaveRendererFactory::Make(modfile, 0, render_type_t::Loops, 1);
+	pRender->SetRenderTrack(0);
+	pRender->SetOutputStream(MakeWaveStream(std::move(pFile), settings));
+	return pRender;
+}
+
+// returns the samples of a wave file, without the header
+std::vector<std::byte> GetSamples(const CMemoryWriter &file) {
+	const auto &data = file.GetData();
+	Check(data.size() > 44u, "wave file");
+	return {data.begin() + 44, data.end()};
+}
+
+void MakeKraid(CFamiTrackerModule &modfile) {
+	MakeChips(modfile, sound_chip_t::APU, 0);
+	Kraid { }(modfile);
+}
+
+// a render resumed from an emulation snapshot matches the uninterrupted render
+void TestSnapshotResume() {
+	CFamiTrackerModule modfile;
+	MakeKraid(modfile);
+	const stOfflineRenderSettings settings;
+	const unsigned SNAPSHOT_FRAME = 600u;
+
+	std::vector<std::byte> snapshot;
+	auto pLive = std::make_shared<CMemoryWriter>();
+	{
+		COfflineRenderer renderer {modfile, settings};
+		renderer.StartRender(MakeRenderer(modfile, settings, pLive));
+		while (renderer.RenderFrame())
+			if (renderer.GetFrameCount() == SNAPSHOT_FRAME)
+				snapshot = renderer.SaveState();
+	}
+	Check(!snapshot.empty(), "snapshot taken");
+
+	auto pResumed = std::make_shared<CMemoryWriter>();
+	{
+		COfflineRenderer renderer {modfile, settings};
+		renderer.LoadState(snapshot, MakeRenderer(modfile, settings, pResumed));
+		while (renderer.RenderFrame())
+			;
+	}
+
+	const auto live = GetSamples(*pLive);
+	const auto resumed = GetSamples(*pResumed);
+	Check(resumed.size() < live.size() && std::equal(resumed.begin(), resumed.end(), live.end() - resumed.size()),
+		"render resumed from snapshot");
+}
+
+// writes the APU output of a register log replay to a wave stream
+class CReplayOutput : public IAudioCallback {
+public:
+	explicit CReplayOutput(std::unique_ptr<COutputWaveStream> pWave) : wave_(std::move(pWave)) {
+		wave_->WriteWAVHeader();
+	}
+
+	void FlushBuffer(array_view<const int16_t> Buffer) override {
+		wave_->WriteSamples(Buffer);
+	}
+	bool PlayBuffer() override {
+		return true;
+	}
+
+private:
+	std::unique_ptr<COutputWaveStream> wave_;
+};
+
+// replaying a captured register log reproduces the render it was captured from
+void TestRegisterReplay() {
+	CFamiTrackerModule modfile;
+	MakeKraid(modfile);
+	const stOfflineRenderSettings settings;
+
+	std::vector<std::uint8_t> log;
+	auto pLive = std::make_shared<CMemoryWriter>();
+	{
+		COfflineRenderer renderer {modfile, settings};
+		const CRegisterCapture &capture = renderer.StartRegisterCapture();
+		renderer.Render(MakeRenderer(modfile, settings, pLive));
+		auto data = capture.GetLog();
+		log.assign(data.begin(), data.end());
+	}
+
+	auto pReplayed = std::make_shared<CMemoryWriter>();
+	{
+		CRegisterReplayer replayer {log};
+		CReplayOutput output {MakeWaveStream(pReplayed, settings)};
+		CAPU apu {&output};
+		Check(apu.SetupSound(settings.SampleRate, 1, replayer.GetMachine()), "replay sound setup");
+		apu.SetupMixer(settings.BassFilter, settings.TrebleFilter, settings.TrebleDamping, settings.MixVolume);
+		apu.EnableMetering(settings.ChannelMeters);
+		replayer.ConfigureAPU(apu);
+		while (replayer.ReplayFrame(apu))
+			;
+	}
+
+	Check(GetSamples(*pReplayed) == GetSamples(*pLive), "register log replay");
+}
+
+// renders are identical with every level of the Blip_Buffer SIMD kernels
+void TestBlipKernels() {
+	CFamiTrackerModule modfile;
+	MakeChips(modfile, CSoundChipSet {sound_chip_t::APU}.WithChip(sound_chip_t::VRC7), 0);
+	Kraid { }(modfile);
+
+	// VRC7 is mixed through Blip_Buffer::mix_samples, let it double the triangle
+	const unsigned char VRC7_INST = 3u;
+	auto *pManager = modfile.GetInstrumentManager();
+	pManager->InsertInstrument(VRC7_INST, pManager->CreateNew(INST_VRC7));
+	CSongData &song = *modfile.GetSong(0);
+	for (unsigned f = 0, n = song.GetFrameCount(); f < n; ++f) {
+		const unsigned p = song.GetFramePattern(f, apu_subindex_t::triangle);
+		song.SetFramePattern(f, vrc7_subindex_t::ch1, p);
+		const auto &from = song.GetPattern(apu_subindex_t::triangle, p);
+		auto &to = song.GetPattern(vrc7_subindex_t::ch1, p);
+		for (unsigned row = 0, rows = from.GetCapacity(); row < rows; ++row) {
+			auto note = from.GetNoteOn(row);
+			if (note.inst() == 2u)
+				note.set_inst(VRC7_INST);
+			to.SetNoteOn(row, note);
+		}
+	}
+
+	const stOfflineRenderSettings settings;
+	const blip_simd_t initial = blip_get_simd();
+	std::vector<std::byte> scalar;
+	for (blip_simd_t simd : {blip_simd_none, blip_simd_sse2, blip_simd_avx2}) {
+		const blip_simd_t selected = blip_set_simd(simd);		// unsupported levels fall back
+		auto pFile = std::make_shared<CMemoryWriter>();
+		{
+			COfflineRenderer renderer {modfile, settings};
+			renderer.StartRender(MakeRenderer(modfile, settings, pFile));
+			while (renderer.RenderFrame())
+				;
+		}
+		if (selected == blip_simd_none)
+			scalar = GetSamples(*pFile);
+		else
+			Check(GetSamples(*pFile) == scalar, "render with SIMD level " + std::to_string(selected));
+	}
+	blip_set_simd(initial);
+}
+
+// module with several songs sharing patterns, instruments 4 to 7 copy instruments 0 to 3
+// and either share their sequences or use equal sequences of other indices
+void MakeExportModule(CFamiTrackerModule &modfile, bool shareSequences) {
+	rng.seed(5u);
+	MakeChips(modfile, CSoundChipSet {sound_chip_t::APU}.WithChip(sound_chip_t::VRC6)
+		.WithChip(sound_chip_t::FDS).WithChip(sound_chip_t::N163), 2);
+
+	const inst_type_t TYPES[] = {INST_2A03, INST_VRC6, INST_FDS, INST_N163};
+	auto *pManager = modfile.GetInstrumentManager();
+	for (unsigned i = 0; i < 8; ++i) {
+		pManager->InsertInstrument(i, pManager->CreateNew(TYPES[i % 4]));
+		if (auto pInst = std::dynamic_pointer_cast<CSeqInstrument>(pManager->GetInstrument(i)); pInst && TYPES[i % 4] != INST_FDS) {
+			pInst->SetSeqEnable(sequence_t::Volume, true);
+			pInst->SetSeqIndex(sequence_t::Volume, shareSequences ? i % 4 : i);
+			CSequence &seq = *pInst->GetSequence(sequence_t::Volume);
+			seq.SetItemCount(8);
+			for (unsigned k = 0; k < 8; ++k)
+				seq.SetItem(k, 15 - (i % 4) - k);
+		}
+	}
+
+	const unsigned SONGS = 3, FRAMES = 8, ROWS = 32, PATTERNS = 4;
+	for (unsigned s = 0; s < SONGS; ++s) {
+		auto pSong = modfile.MakeNewSong();
+		pSong->SetFrameCount(FRAMES);
+		pSong->SetPatternLength(ROWS);
+		modfile.GetChannelOrder().ForeachChannel([&] (stChannelID ch) {
+			pSong->SetEffectColumnCount(ch, 2);
+			const unsigned chip = ch.Chip == sound_chip_t::VRC6 ? 1 : ch.Chip == sound_chip_t::FDS ? 2 : ch.Chip == sound_chip_t::N163 ? 3 : 0;
+			for (unsigned f = 0; f < FRAMES; ++f)
+				pSong->SetFramePattern(f, ch, R(PATTERNS));
+			for (unsigned p = 0; p < PATTERNS; ++p) {
+				auto &pattern = pSong->GetPattern(ch, p);
+				if (s > 0 && R(2) == 0) {		// same pattern as in the first song
+					pattern = modfile.GetSong(0)->GetPattern(ch, p);
+					continue;
+				}
+				for (unsigned r = 0; r < ROWS; ++r) {
+					auto note = RandomNote(2, 25);
+					const unsigned copy = R(2);		// the FDS wave is not shared, so its copy stays unused
+					if (note.inst() < 4u)
+						note.set_inst(chip + (chip != 2 ? 4 * copy : 0));
+					pattern.SetNoteOn(r, note);
+				}
+			}
+		});
+		if (s == 0)
+			(void)modfile.ReplaceSong(0, std::move(pSong));
+		else
+			modfile.InsertSong(s, std::move(pSong));
+	}
+}
+
+class CStringLog : public CCompilerLog {
+public:
+	void WriteLog(std::string_view text) override {
+		log_ += text;
+	}
+	void Clear() override {
+		log_.clear();
+	}
+	const std::string &GetLog() const {
+		return log_;
+	}
+
+private:
+	std::string log_;
+};
+
+// exports a module in every format, the last item is the compiler log
+std::vector<std::vector<std::byte>> ExportAll(const CFamiTrackerModule &modfile, unsigned threads) {
+	std::vector<std::vector<std::byte>> files;
+	auto pLog = std::make_shared<CStringLog>();
+	const auto compile = [&] (auto f) {
+		CMemoryWriter file, dpcm;
+		CCompiler compiler {modfile, pLog};
+		compiler.SetThreadCount(threads);
+		f(compiler, file, dpcm);
+		files.push_back(file.GetData());
+		if (!dpcm.GetData().empty())
+			files.push_back(dpcm.GetData());
+	};
+	compile([] (CCompiler &c, CMemoryWriter &file, CMemoryWriter &) { c.ExportNSF(file, 0); });
+	compile([] (CCompiler &c, CMemoryWriter &file, CMemoryWriter &) { c.ExportNSFE(file, 0); });
+	compile([] (CCompiler &c, CMemoryWriter &file, CMemoryWriter &dpcm) { c.ExportBIN(file, dpcm); });
+	compile([] (CCompiler &c, CMemoryWriter &file, CMemoryWriter &) { c.ExportASM(file); });
+	const auto &log = pLog->GetLog();
+	files.emplace_back(reinterpret_cast<const std::byte *>(log.data()), reinterpret_cast<const std::byte *>(log.data() + log.size()));
+	return files;
+}
+
+std::uint64_t Fnv1a(const std::vector<std::byte> &data) {
+	std::uint64_t hash = 0xCBF29CE484222325u;
+	for (std::byte b : data)
+		hash = (hash ^ static_cast<std::uint64_t>(b)) * 0x100000001B3u;
+	return hash;
+}
+
+// exports match those of the single-threaded compiler with a linear duplicate
+// search, and equal sequences are stored as if the instruments shared them
+void TestExportIdentity() {
+	CFamiTrackerModule shared;
+	MakeExportModule(shared, true);
+	CFamiTrackerModule copied;
+	MakeExportModule(copied, false);
+
+	// hashes of the NSF, NSFE, BIN and ASM exports of the shared module, from the
+	// compiler before pattern compilation was threaded and chunks were hashed
+	const std::uint64_t LINEAR[] = {
+		0x5BBCA38FE1342C8Fu,
+		0xD05FE2EC3865E256u,
+		0xCC94DA769F5A1362u,
+		0x673C496DF3DC7870u,
+	};
+
+	const auto single = ExportAll(shared, 1u);
+	Check(single.size() == std::size(LINEAR) + 1u, "export count");
+	for (std::size_t i = 0; i < std::size(LINEAR); ++i)
+		Check(Fnv1a(single[i]) == LINEAR[i], "export " + std::to_string(i) + " against linear search");
+
+	const auto copies = ExportAll(copied, 1u);
+	Check(std::equal(single.begin(), single.end() - 1, copies.begin(), copies.end() - 1), "export of copied sequences");
+	for (unsigned threads : {2u, 4u, 7u}) {
+		Check(ExportAll(shared, threads) == single, "export with " + std::to_string(threads) + " threads");
+		Check(ExportAll(copied, threads) == copies, "export of copied sequences with " + std::to_string(threads) + " threads");
+	}
+}
+
+using opll_ptr = std::unique_ptr<OPLL, decltype(&OPLL_delete)>;
+
+opll_ptr MakeOPLL(std::uint32_t rate) {
+	opll_ptr opll {OPLL_new(3579545u, rate), &OPLL_delete};
+	OPLL_reset(opll.get());
+	OPLL_reset_patch(opll.get(), 1);
+	return opll;
+}
+
+// writes the registers for one block of samples, the same for every OPLL
+void WriteOPLL(OPLL *opll, unsigned block) {
+	const unsigned ch = block % 6;
+	OPLL_writeReg(opll, block % 8, (block * 13u) & 0xFFu);		// custom patch
+	OPLL_writeReg(opll, 0x10 + ch, (block * 37u) & 0xFFu);
+	OPLL_writeReg(opll, 0x30 + ch, (block % 16) << 4 | block % 8);
+	OPLL_writeReg(opll, 0x20 + ch, 0x10 | (block % 7) << 1 | (block / 7) % 2);
+	if (block % 5 == 0)
+		OPLL_writeReg(opll, 0x20 + (ch + 3) % 6, 0x00);
+}
+
+const unsigned OPLL_BLOCK = 256u;
+
+void RunOPLL(OPLL *opll, unsigned block, std::vector<std::int16_t> &out) {
+	WriteOPLL(opll, block);
+	const std::size_t pos = out.size();
+	out.resize(pos + OPLL_BLOCK);
+	OPLL_calc_block(opll, out.data() + pos, OPLL_BLOCK);
+}
+
+// OPLL objects at different sample rates run independently, and resume exactly
+// from saved states
+void TestOPLLInstances() {
+	OPLL_init();
+	const unsigned BLOCKS = 200u, SAVE_BLOCK = 120u;
+
+	std::vector<std::int16_t> alone44, alone48;
+	{
+		auto opll = MakeOPLL(44100u);
+		for (unsigned b = 0; b < BLOCKS; ++b)
+			RunOPLL(opll.get(), b, alone44);
+	}
+	{
+		auto opll = MakeOPLL(48000u);
+		for (unsigned b = 0; b < BLOCKS; ++b)
+			RunOPLL(opll.get(), b, alone48);
+	}
+	Check(alone44 != alone48, "OPLL output depends on the sample rate");
+
+	std::vector<std::int16_t> both44, both48;
+	std::vector<std::uint8_t> state(OPLL_getStateSize());
+	std::size_t savePos = 0u;
+	{
+		auto opll44 = MakeOPLL(44100u);
+		auto opll48 = MakeOPLL(48000u);
+		for (unsigned b = 0; b < BLOCKS; ++b) {
+			if (b == SAVE_BLOCK) {
+				OPLL_saveState(opll44.get(), state.data());
+				savePos = both44.size();
+			}
+			RunOPLL(opll44.get(), b, both44);
+			RunOPLL(opll48.get(), b, both48);
+		}
+	}
+	Check(both44 == alone44 && both48 == alone48, "interleaved OPLL objects");
+
+	std::vector<std::int16_t> resumed;
+	{
+		auto opll = MakeOPLL(44100u);
+		RunOPLL(opll.get(), 0u, resumed);		// state to be overwritten
+		resumed.clear();
+		OPLL_loadState(opll.get(), state.data());
+		for (unsigned b = SAVE_BLOCK; b < BLOCKS; ++b)
+			RunOPLL(opll.get(), b, resumed);
+	}
+	Check(std::equal(resumed.begin(), resumed.end(), alone44.begin() + savePos, alone44.end()), "OPLL resumed from saved state");
+}
+
+// bytes of a 16-bit sample in a given wave format
+std::vector<std::byte> ExpectedSample(std::int16_t x, const CWaveFileFormat &fmt) {
+	const auto u = static_cast<std::uint16_t>(x);
+	std::uint64_t bits = 0u;
+	if (fmt.Format == CWaveFileFormat::format_code::ieee_float && fmt.SampleSize == 32) {
+		const float f = x / 32768.f;
+		std::uint32_t b;
+		std::memcpy(&b, &f, sizeof(b));
+		bits = b;
+	}
+	else if (fmt.Format == CWaveFileFormat::format_code::ieee_float) {
+		const double d = x / 32768.;
+		std::memcpy(&bits, &d, sizeof(bits));
+	}
+	else if (fmt.SampleSize == 8)
+		bits = (u >> 8) ^ 0x80u;
+	else if (fmt.SampleSize == 12)
+		bits = u & 0xFFF0u;
+	else
+		bits = static_cast<std::uint64_t>(u) << (fmt.SampleSize - 16);
+
+	std::vector<std::byte> out;
+	for (unsigned b = 0; b < fmt.BytesPerSample(); ++b)
+		out.push_back(static_cast<std::byte>(bits >> (b * 8)));
+	return out;
+}
+
+std::uint32_t ReadLE(const std::vector<std::byte> &data, std::size_t pos, unsigned bytes) {
+	std::uint32_t x = 0u;
+	for (unsigned b = 0; b < bytes; ++b)
+		x |= static_cast<std::uint32_t>(data[pos + b]) << (b * 8);
+	return x;
+}
+
+// wave files of every supported format have consistent headers and convert samples
+// exactly, also across the blocks written at once
+void TestWaveFormats() {
+	rng.seed(6u);
+	std::vector<std::int16_t> samples {0, 1, -1, 0x7FFF, -0x8000, 0x1234, -0x1234, 0x00FF};
+	while (samples.size() < 10008u)
+		samples.push_back(static_cast<std::int16_t>(rng()));
+
+	using format_code = CWaveFileFormat::format_code;
+	const CWaveFileFormat FORMATS[] = {
+		{format_code::pcm, 1u, 44100u, 8u},
+		{format_code::pcm, 1u, 44100u, 12u},
+		{format_code::pcm, 1u, 44100u, 16u},
+		{format_code::pcm, 1u, 44100u, 24u},
+		{format_code::pcm, 1u, 44100u, 32u},
+		{format_code::ieee_float, 1u, 44100u, 32u},
+		{format_code::ieee_float, 1u, 44100u, 64u},
+	};
+
+	for (const auto &fmt : FORMATS) {
+		const bool pcm = fmt.Format == format_code::pcm;
+		const std::string name = (pcm ? "pcm " : "float ") + std::to_string(fmt.SampleSize);
+		auto pFile = std::make_shared<CMemoryWriter>();
+		{
+			COutputWaveStream stream {pFile, fmt};
+			stream.WriteWAVHeader();
+			stream.WriteSamples(array_view<const std::int16_t> {samples.data(), 3u});
+			stream.WriteSamples(array_view<const std::int16_t> {samples.data() + 3u, samples.size() - 3u});
+		}
+
+		const auto &data = pFile->GetData();
+		const std::size_t header = pcm ? 44u : 58u;
+		const std::size_t size = samples.size() * fmt.BytesPerSample();
+		Check(data.size() == header + size, name + " file size");
+		Check(ReadLE(data, 4u, 4u) == data.size() - 8u, name + " RIFF size");
+		Check(ReadLE(data, 20u, 2u) == static_cast<std::uint16_t>(fmt.Format) && ReadLE(data, 22u, 2u) == 1u &&
+			ReadLE(data, 24u, 4u) == 44100u && ReadLE(data, 28u, 4u) == 44100u * fmt.BytesPerSample() &&
+			ReadLE(data, 32u, 2u) == fmt.BytesPerSample() && ReadLE(data, 34u, 2u) == fmt.SampleSize, name + " format chunk");
+		Check(ReadLE(data, header - 4u, 4u) == size, name + " data size");
+
+		std::vector<std::byte> expected;
+		for (std::int16_t x : samples) {
+			const auto bytes = ExpectedSample(x, fmt);
+			expected.insert(expected.end(), bytes.begin(), bytes.end());
+		}
+		Check(std::equal(expected.begin(), expected.end(), data.begin() + header, data.end()), name + " samples");
+	}
+}
+
+std::vector<int> GetSamples16(const CMemoryWriter &file) {
+	const auto bytes = GetSamples(file);
+	std::vector<int> samples(bytes.size() / 2u);
+	for (std::size_t i = 0; i < samples.size(); ++i)
+		samples[i] = static_cast<std::int16_t>(static_cast<unsigned>(bytes[i * 2]) | static_cast<unsigned>(bytes[i * 2 + 1]) << 8);
+	return samples;
+}
+
+// stems of linearly mixed channels sum to the full mix; the 2A03 pulse and TND
+// outputs are nonlinear, so only one channel of each is used
+void TestStemSum() {
+	rng.seed(7u);
+	CFamiTrackerModule modfile;
+	MakeChips(modfile, CSoundChipSet {sound_chip_t::APU}.WithChip(sound_chip_t::VRC6).WithChip(sound_chip_t::N163), 2);
+	const inst_type_t TYPES[] = {INST_2A03, INST_VRC6, INST_N163};
+	auto *pManager = modfile.GetInstrumentManager();
+	for (unsigned i = 0; i < 3; ++i)
+		pManager->InsertInstrument(i, pManager->CreateNew(TYPES[i]));
+
+	CSongData &song = *modfile.GetSong(0);
+	const unsigned FRAMES = 2, ROWS = 64;
+	song.SetFrameCount(FRAMES);
+	song.SetPatternLength(ROWS);
+	modfile.GetChannelOrder().ForeachChannel([&] (stChannelID ch) {
+		if (ch == apu_subindex_t::pulse2 || ch == apu_subindex_t::noise || ch == apu_subindex_t::dpcm)
+			return;
+		const unsigned char inst = ch.Chip == sound_chip_t::VRC6 ? 1u : ch.Chip == sound_chip_t::N163 ? 2u : 0u;
+		for (unsigned f = 0; f < FRAMES; ++f) {
+			song.SetFramePattern(f, ch, f);
+			for (unsigned r = 0; r < ROWS; r += 4) {
+				ft0cc::doc::pattern_note note;
+				note.set_note(enum_cast<ft0cc::doc::pitch>(1 + R(12)));
+				note.set_oct(2 + R(4));
+				note.set_inst(inst);
+				note.set_vol(8 + R(8));
+				song.GetPattern(ch, f).SetNoteOn(r, note);
+			}
+		}
+	});
+
+	const stOfflineRenderSettings settings;
+	auto pMix = std::make_shared<CMemoryWriter>();
+	std::vector<std::shared_ptr<CMemoryWriter>> stems;
+	auto pRender = MakeRenderer(modfile, settings, pMix);
+	modfile.GetChannelOrder().ForeachChannel([&] (stChannelID ch) {
+		stems.push_back(std::make_shared<CMemoryWriter>());
+		pRender->SetStemStream(ch, MakeWaveStream(stems.back(), settings));
+	});
+	{
+		COfflineRenderer renderer {modfile, settings};
+		renderer.StartRender(pRender);
+		while (renderer.RenderFrame())
+			;
+	}
+	pRender.reset();		// finishes the wave files
+
+	const auto mix = GetSamples16(*pMix);
+	Check(*std::max_element(mix.begin(), mix.end()) > 1000, "audible mix");
+	std::vector<int> sum(mix.size());
+	for (const auto &pStem : stems) {
+		const auto stem = GetSamples16(*pStem);
+		Check(stem.size() == mix.size(), "stem length");
+		for (std::size_t i = 0; i < sum.size(); ++i)
+			sum[i] += stem[i];
+	}
+	// each stem is truncated to 16 bits on its own
+	const int tolerance = static_cast<int>(stems.size());
+	for (std::size_t i = 0; i < mix.size(); ++i)
+		Check(std::abs(sum[i] - mix[i]) <= tolerance, "stems summed at sample " + std::to_string(i));
+}
+
+} // namespace
+
+int main() try {
+	TestPatternUses();
+	TestPatternCopies();
+	TestRegisterDecay();
+	TestSongStateCache();
+	TestSnapshotResume();
+	TestRegisterReplay();
+	TestBlipKernels();
+	TestExportIdentity();
+	TestOPLLInstances();
+	TestWaveFormats();
+	TestStemSum();
+
+	std::cout << "Success\n";
+	return 0;
+}
+catch (std::exception &e) {
+	std::cerr << "C++ exception: " << e.what() << '\n';
+	return 1;
+}
+catch (...) {
+	std::cerr << "Unknown exception\n";
+	return 1;
+}
@@ -21,6 +21,7 @@
 */
 
 #include "APU/2A03.h"
+#include "StateArchive.h"		// // //
 #include "Common.h"
 #include <algorithm>
 #include "APU/Mixer.h"
@@ -48,6 +49,7 @@ void C2A03::Reset()
 {
 	m_iFrameSequence	= 0;
 	m_iFrameMode		= 0;
+	m_iTime				= 0;		// // //
 
 	m_Square1.Reset();
 	m_Square2.Reset();
@@ -60,10 +62,12 @@ void C2A03::Process(uint32_t Time)
 {
 	RunAPU1(Time);
 	RunAPU2(Time);
+	m_iTime += Time;		// // //
 }
 
 void C2A03::EndFrame()
 {
+	m_iTime = 0;		// // //
 	m_Square1.EndFrame();
 	m_Square2.EndFrame();
 	m_Triangle.EndFrame();
@@ -206,29 +210,74 @@ inline void C2A03::Clock_60Hz()
 	// IRQ
 }
 
+// // // Channels sharing a non-linear mixer used to be run alternately in steps
+// of Period cycles. Each channel now runs over the whole time span at once,
+// and the queued output changes are mixed in the order of those steps.
+
 inline void C2A03::RunAPU1(uint32_t Time)
 {
 	// APU pin 1
-	while (Time > 0) {
-		uint32_t Period = std::max((uint32_t)std::min(m_Square1.GetPeriod(), m_Square2.GetPeriod()), 7u);
-		Period = std::min(Period, Time);
-		m_Square1.Process(Period);
-		m_Square2.Process(Period);
-		Time -= Period;
-	}
+	if (!Time)
+		return;
+	uint32_t Period = std::max((uint32_t)std::min(m_Square1.GetPeriod(), m_Square2.GetPeriod()), 7u);
+	m_Square1.Process(Time);
+	m_Square2.Process(Time);
+	MixDeltas({&m_Square1, &m_Square2}, Period);
 }
 
 inline void C2A03::RunAPU2(uint32_t Time)
 {
 	// APU pin 2
-	while (Time > 0) {
-		uint32_t Period = std::max((uint32_t)std::min(std::min(m_Triangle.GetPeriod(), m_Noise.GetPeriod()), m_DPCM.GetPeriod()), 7u);
-		Period = std::min(Period, Time);
-		m_Triangle.Process(Period);
-		m_Noise.Process(Period);
-		m_DPCM.Process(Period);
-		Time -= Period;
+	if (!Time)
+		return;
+	uint32_t Period = std::max((uint32_t)std::min(std::min(m_Triangle.GetPeriod(), m_Noise.GetPeriod()), m_DPCM.GetPeriod()), 7u);
+	m_Triangle.Process(Time);
+	m_Noise.Process(Time);
+	m_DPCM.Process(Time);
+	MixDeltas({&m_Triangle, &m_Noise, &m_DPCM}, Period);
+}
+
+template <std::size_t N>
+void C2A03::MixDeltas(C2A03Chan *const (&Chans)[N], uint32_t Period)
+{
+	// A change at Time cycles into the span belongs to step (Time - 1) / Period,
+	// changes in the same step are mixed in channel order
+	const auto GetStep = [&] (const stMixDelta &x) {
+		uint32_t Time = x.Time - m_iTime;
+		return Time ? (Time - 1) / Period : 0u;
+	};
+
+	array_view<const stMixDelta> Deltas[N];
+	for (std::size_t i = 0; i < N; ++i)
+		Deltas[i] = Chans[i]->GetDeltas();
+
+	while (true) {
+		std::size_t Next = N;
+		uint32_t Step = 0;
+		for (std::size_t i = 0; i < N; ++i)
+			if (!Deltas[i].empty())
+				if (uint32_t s = GetStep(Deltas[i].front()); Next == N || s < Step) {
+					Next = i;
+					Step = s;
+				}
+		if (Next == N)
+			break;
+
+		// Mix changes of this channel up to the first step taken by another one
+		uint64_t Limit = UINT64_MAX;
+		for (std::size_t i = 0; i < N; ++i)
+			if (i != Next && !Deltas[i].empty())
+				Limit = std::min(Limit, (uint64_t)GetStep(Deltas[i].front()) + (i > Next ? 1u : 0u));
+		auto &Queue = Deltas[Next];
+		std::size_t Count = 0;
+		while (Count < Queue.size() && GetStep(Queue[Count]) < Limit)
+			++Count;
+		m_pMixer->AddDeltas(Chans[Next]->GetChannelType(), {Queue.data(), Count});
+		Queue.remove_front(Count);
 	}
+
+	for (auto *pChan : Chans)
+		pChan->ClearDeltas();
 }
 
 void C2A03::WriteSample(std::shared_ptr<const ft0cc::doc::dpcm_sample> pSample) {		// // //
@@ -255,3 +304,24 @@ bool C2A03::DPCMPlaying() const
 {
 	return m_DPCM.IsPlaying();
 }
+
+void C2A03::SerializeState(CStateArchive &ar)		// // //
+{
+	m_Square1.SerializeState(ar);
+	m_Square2.SerializeState(ar);
+	m_Triangle.SerializeState(ar);
+	m_Noise.SerializeState(ar);
+	m_DPCM.SerializeState(ar);
+	ar(m_iFrameSequence, m_iFrameMode, m_iTime);
+
+	// The sample memory is stored by value, a loaded copy is owned by the chip
+	array_view<const uint8_t> Mem = m_DPCM.GetSampleMemory().GetMem();
+	std::vector<uint8_t> Samples(Mem.begin(), Mem.end());
+	ar.Vector(Samples);
+	if (ar.IsLoading()) {
+		if (Samples.empty())
+			ClearSample();
+		else
+			WriteSample(std::make_shared<ft0cc::doc::dpcm_sample>(std::move(Samples), ""));
+	}
+}
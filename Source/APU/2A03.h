@@ -37,7 +37,7 @@ class dpcm_sample;
 #include "APU/Noise.h"
 #include "APU/DPCM.h"
 
-class C2A03 : public CSoundChip
+class C2A03 final : public CSoundChip
 {
 public:
 	C2A03(CMixer &Mixer, std::uint8_t nInstance);
@@ -52,6 +52,7 @@ public:
 	uint8_t Read(uint16_t Address, bool &Mapped) override;
 
 	double GetFreq(int Channel) const override;		// // //
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 public:
 	void	ClockSequence();		// // //
@@ -72,6 +73,9 @@ private:
 	inline void RunAPU1(uint32_t Time);
 	inline void RunAPU2(uint32_t Time);
 
+	template <std::size_t N>
+	void MixDeltas(C2A03Chan *const (&Chans)[N], uint32_t Period);		// // //
+
 private:
 	CSquare		m_Square1;		// // //
 	CSquare		m_Square2;
@@ -81,6 +85,7 @@ private:
 
 	uint8_t		m_iFrameSequence = 0;		// Frame sequence
 	uint8_t		m_iFrameMode = 0;			// 4 or 5-steps frame sequence
+	uint32_t	m_iTime = 0;				// // // Cycle counter, resets every new frame
 
 	std::shared_ptr<const ft0cc::doc::dpcm_sample> preview_sample_;		// // //
 };
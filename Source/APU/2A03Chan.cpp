@@ -22,7 +22,27 @@
 
 #include "APU/2A03Chan.h"
 #include "APU/Mixer.h"
+#include "StateArchive.h"		// // //
 
 uint16_t C2A03Chan::GetPeriod() const {
 	return m_iPeriod;
 }
+
+void C2A03Chan::SerializeState(CStateArchive &ar) {		// // //
+	CChannel::SerializeState(ar);
+	ar(m_iControlReg, m_iEnabled, m_iPeriod, m_iLengthCounter, m_iCounter);
+	ar.Vector(m_Deltas);
+}
+
+array_view<const stMixDelta> C2A03Chan::GetDeltas() const {		// // //
+	return m_Deltas;
+}
+
+void C2A03Chan::ClearDeltas() {
+	m_Deltas.clear();
+}
+
+void C2A03Chan::FlushDeltas() {
+	m_pMixer->AddDeltas(m_iChanId, m_Deltas);
+	m_Deltas.clear();
+}
@@ -24,12 +24,20 @@
 #pragma once
 
 #include "APU/Channel.h"
+#include "ft0cc/cpputil/array_view.hpp"		// // //
+#include <vector>		// // //
 
 class C2A03Chan : public CChannel {		// // //
 public:
 	using CChannel::CChannel;		// // //
 
 	uint16_t GetPeriod() const;
+	void SerializeState(CStateArchive &ar) override;		// // //
+
+	// // // Batched synthesis, Process queues output changes instead of mixing them
+	array_view<const stMixDelta> GetDeltas() const;
+	void	ClearDeltas();
+	void	FlushDeltas();
 
 	static constexpr unsigned SEQUENCER_FREQUENCY = 240;
 
@@ -40,6 +48,14 @@ public:
 		0xC0, 0x18, 0x48, 0x1A, 0x10, 0x1C, 0x20, 0x1E,
 	};
 
+protected:
+	void QueueMix(int32_t Value) {		// // //
+		if (Value != m_iLastValue) {
+			m_Deltas.push_back({m_iTime, Value - m_iLastValue});
+			m_iLastValue = Value;
+		}
+	}
+
 protected:
 	// Variables used by channels
 	uint8_t		m_iControlReg;
@@ -47,4 +63,7 @@ protected:
 	uint16_t	m_iPeriod;
 	uint16_t	m_iLengthCounter;
 	uint32_t	m_iCounter;
+
+private:
+	std::vector<stMixDelta> m_Deltas;		// // //
 };
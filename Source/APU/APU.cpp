@@ -25,13 +25,195 @@
 #include <algorithm>		// // //
 #include "APU/Mixer.h"		// // //
 #include "APU/2A03.h"		// // //
+#include "APU/VRC6.h"		// // //
+#include "APU/VRC7.h"
+#include "APU/FDS.h"		// // //
 #include "APU/MMC5.h"
 #include "APU/N163.h"
-#include "APU/VRC7.h"
+#include "APU/S5B.h"		// // //
+#include <array>		// // //
+#include <utility>		// // //
 #include "FamiTrackerEnv.h"		// // //
 #include "SoundChipService.h"		// // //
 #include "RegisterState.h"		// // //
 #include "Assertion.h"		// // //
+#include "StateArchive.h"		// // //
+#include "APU/RegisterCapture.h"		// // //
+
+// // // Runs the active sound chips of the APU
+//
+// Chips that become quiescent after a write or at the end of a frame are put to sleep,
+// the time they skip is processed at once before they are accessed again
+class CAPUChipRunner {
+public:
+	virtual ~CAPUChipRunner() noexcept = default;
+
+	virtual void Process(uint32_t Time) = 0;
+	virtual void EndFrame() = 0;
+	virtual void Write(uint16_t Address, uint8_t Value) = 0;
+	virtual void Wake() = 0;
+};
+
+namespace {
+
+struct stChipSleep {
+	bool Asleep = false;
+	uint32_t Time = 0u;		// Cycles skipped while asleep
+};
+
+template <typename T>
+void ProcessChip(T &Chip, stChipSleep &Sleep, uint32_t Time) {
+	if (Sleep.Asleep)
+		Sleep.Time += Time;
+	else
+		Chip.Process(Time);
+}
+
+template <typename T>
+void CatchUpChip(T &Chip, stChipSleep &Sleep) {
+	if (Sleep.Time)
+		Chip.Process(std::exchange(Sleep.Time, 0u));
+}
+
+template <typename T>
+void WakeChip(T &Chip, stChipSleep &Sleep) {
+	CatchUpChip(Chip, Sleep);
+	Sleep.Asleep = false;
+}
+
+template <typename T>
+void EndChipFrame(T &Chip, stChipSleep &Sleep) {
+	CatchUpChip(Chip, Sleep);
+	Chip.EndFrame();
+	Sleep.Asleep = Chip.IsQuiescent();
+}
+
+template <typename T>
+void WriteChip(T &Chip, stChipSleep &Sleep, uint16_t Address, uint8_t Value) {
+	if (Chip.IsAddressMapped(Address)) {
+		WakeChip(Chip, Sleep);
+		Chip.Write(Address, Value);
+		Sleep.Asleep = Chip.IsQuiescent();
+	}
+}
+
+// Calls any sound chips through the CSoundChip interface
+class CAPUChipRunnerDynamic final : public CAPUChipRunner {
+public:
+	explicit CAPUChipRunnerDynamic(const std::vector<CSoundChip *> &chips) :
+		chips_(chips), sleep_(chips.size())
+	{
+	}
+
+private:
+	void Process(uint32_t Time) override {
+		for (std::size_t i = 0; i < chips_.size(); ++i)
+			ProcessChip(*chips_[i], sleep_[i], Time);
+	}
+	void EndFrame() override {
+		for (std::size_t i = 0; i < chips_.size(); ++i)
+			EndChipFrame(*chips_[i], sleep_[i]);
+	}
+	void Write(uint16_t Address, uint8_t Value) override {
+		for (std::size_t i = 0; i < chips_.size(); ++i)
+			WriteChip(*chips_[i], sleep_[i], Address, Value);
+		for (auto *Chip : chips_)
+			Chip->Log(Address, Value);
+	}
+	void Wake() override {
+		for (std::size_t i = 0; i < chips_.size(); ++i)
+			WakeChip(*chips_[i], sleep_[i]);
+	}
+
+	std::vector<CSoundChip *> chips_;
+	std::vector<stChipSleep> sleep_;
+};
+
+struct stAPUChips {
+	C2A03 *p2A03 = nullptr;
+	CVRC6 *pVRC6 = nullptr;
+	CVRC7 *pVRC7 = nullptr;
+	CFDS  *pFDS  = nullptr;
+	CMMC5 *pMMC5 = nullptr;
+	CN163 *pN163 = nullptr;
+	CS5B  *pS5B  = nullptr;
+};
+
+// Calls a fixed set of the built-in sound chips without virtual dispatch,
+// chips are visited in the same order as CSoundChipService::ForeachType
+template <CSoundChipSet::value_type Flag>
+class CAPUChipRunnerStatic final : public CAPUChipRunner {
+	static constexpr bool Contains(sound_chip_t Chip) noexcept {
+		return (Flag & (1u << value_cast(Chip))) != 0u;
+	}
+
+public:
+	explicit CAPUChipRunnerStatic(const stAPUChips &chips) : chips_(chips) {
+	}
+
+private:
+	template <typename F>
+	void ForeachChip(F f) {
+		if constexpr (Contains(sound_chip_t::APU))
+			f(*chips_.p2A03, sleep_[value_cast(sound_chip_t::APU)]);
+		if constexpr (Contains(sound_chip_t::VRC6))
+			f(*chips_.pVRC6, sleep_[value_cast(sound_chip_t::VRC6)]);
+		if constexpr (Contains(sound_chip_t::VRC7))
+			f(*chips_.pVRC7, sleep_[value_cast(sound_chip_t::VRC7)]);
+		if constexpr (Contains(sound_chip_t::FDS))
+			f(*chips_.pFDS, sleep_[value_cast(sound_chip_t::FDS)]);
+		if constexpr (Contains(sound_chip_t::MMC5))
+			f(*chips_.pMMC5, sleep_[value_cast(sound_chip_t::MMC5)]);
+		if constexpr (Contains(sound_chip_t::N163))
+			f(*chips_.pN163, sleep_[value_cast(sound_chip_t::N163)]);
+		if constexpr (Contains(sound_chip_t::S5B))
+			f(*chips_.pS5B, sleep_[value_cast(sound_chip_t::S5B)]);
+	}
+
+	void Process(uint32_t Time) override {
+		ForeachChip([&] (auto &Chip, stChipSleep &Sleep) { ProcessChip(Chip, Sleep, Time); });
+	}
+	void EndFrame() override {
+		ForeachChip([] (auto &Chip, stChipSleep &Sleep) { EndChipFrame(Chip, Sleep); });
+	}
+	void Write(uint16_t Address, uint8_t Value) override {
+		ForeachChip([&] (auto &Chip, stChipSleep &Sleep) { WriteChip(Chip, Sleep, Address, Value); });
+		ForeachChip([&] (auto &Chip, stChipSleep &) { Chip.Log(Address, Value); });
+	}
+	void Wake() override {
+		ForeachChip([] (auto &Chip, stChipSleep &Sleep) { WakeChip(Chip, Sleep); });
+	}
+
+	stAPUChips chips_;
+	std::array<stChipSleep, SOUND_CHIP_COUNT> sleep_;
+};
+
+using runner_factory_t = std::unique_ptr<CAPUChipRunner> (*)(const stAPUChips &);
+
+template <CSoundChipSet::value_type Flag>
+std::unique_ptr<CAPUChipRunner> MakeStaticRunner(const stAPUChips &chips) {
+	return std::make_unique<CAPUChipRunnerStatic<Flag>>(chips);
+}
+
+template <CSoundChipSet::value_type... Flags>
+constexpr std::array<runner_factory_t, sizeof...(Flags)>
+MakeRunnerFactories(std::integer_sequence<CSoundChipSet::value_type, Flags...>) noexcept {
+	return {{&MakeStaticRunner<Flags>...}};
+}
+
+// One instantiation for every combination of the built-in chips
+constexpr auto STATIC_RUNNERS = MakeRunnerFactories(
+	std::make_integer_sequence<CSoundChipSet::value_type, 1u << SOUND_CHIP_COUNT>());
+
+template <typename T>
+T *GetChipAs(const std::vector<std::unique_ptr<CSoundChip>> &chips, sound_chip_t ID) {
+	for (auto &c : chips)
+		if (c->GetID() == ID)
+			return dynamic_cast<T *>(c.get());
+	return nullptr;
+}
+
+} // namespace
 
 CAPU::CAPU(IAudioCallback *pCallback) :		// // //
 	m_pMixer(std::make_unique<CMixer>()),		// // //
@@ -48,6 +230,12 @@ CAPU::CAPU(IAudioCallback *pCallback) :		// // //
 		m_pSoundChips.push_back(pSCS->MakeSoundChipDriver(c, *m_pMixer, INSTANCE_ID));
 	});
 
+	m_p2A03 = GetChipAs<C2A03>(m_pSoundChips, sound_chip_t::APU);		// // //
+	m_pMMC5 = GetChipAs<CMMC5>(m_pSoundChips, sound_chip_t::MMC5);
+	m_pN163 = GetChipAs<CN163>(m_pSoundChips, sound_chip_t::N163);
+	m_pVRC7 = GetChipAs<CVRC7>(m_pSoundChips, sound_chip_t::VRC7);
+	m_pChipRunner = std::make_unique<CAPUChipRunnerDynamic>(m_pActiveChips);
+
 #ifdef LOGGING
 	m_pLog = std::make_unique<CFile>("apu_log.txt", CFile::modeCreate | CFile::modeWrite);
 	m_iFrame = 0;
@@ -67,12 +255,14 @@ CAPU::~CAPU()
 //
 void CAPU::Process()
 {
+	if (m_pCapture && m_iCyclesToRun > 0)		// // //
+		m_pCapture->Process(m_iFrameCycles + m_iCyclesToRun);
+
 	while (m_iCyclesToRun > 0) {
 
 		uint32_t Time = std::min(m_iCyclesToRun, m_iSequencerNext - m_iSequencerClock);		// // //
 
-		for (auto *Chip : m_pActiveChips)		// // //
-			Chip->Process(Time);
+		m_pChipRunner->Process(Time);		// // //
 
 		m_iFrameCycles	  += Time;
 		m_iSequencerClock += Time;
@@ -89,24 +279,30 @@ void CAPU::StepSequence()		// // //
 		m_iSequencerClock = m_iSequencerCount = 0;
 	m_iSequencerNext = (uint64_t)MASTER_CLOCK_NTSC * (m_iSequencerCount + 1) / C2A03Chan::SEQUENCER_FREQUENCY;
 
-	for (auto &c : m_pSoundChips)		// // //
-		if (auto *p2A03 = dynamic_cast<C2A03 *>(c.get()))
-			p2A03->ClockSequence();
-		else if (auto *pMMC5 = dynamic_cast<CMMC5 *>(c.get()))
-			pMMC5->ClockSequence();
+	if (m_p2A03)		// // //
+		m_p2A03->ClockSequence();
+	if (m_pMMC5)
+		m_pMMC5->ClockSequence();
 }
 
 // End of audio frame, flush the buffer if enough samples has been produced, and start a new frame
 void CAPU::EndFrame()
 {
-	for (auto *Chip : m_pActiveChips)		// // //
-		Chip->EndFrame();
+	if (m_pCapture)		// // //
+		m_pCapture->EndFrame(m_iFrameCycles);
+
+	m_pChipRunner->EndFrame();		// // //
 
 	int SamplesAvail = m_pMixer->FinishBuffer(m_iFrameCycles);
 	Assert(((int)m_iSoundBufferSize << 1) >= SamplesAvail);
 	int ReadSamples	= m_pMixer->ReadBuffer(SamplesAvail, m_pSoundBuffer.get(), m_bStereoEnabled);
 	if (m_pParent)		// // //
 		m_pParent->FlushBuffer({m_pSoundBuffer.get(), (unsigned)ReadSamples});
+	if (m_pStemCallback)		// // //
+		for (stChannelID Chan : m_pMixer->GetStemChannels()) {
+			int StemSamples = m_pMixer->ReadStem(Chan, SamplesAvail, m_pSoundBuffer.get());
+			m_pStemCallback->FlushStemBuffer(Chan, {m_pSoundBuffer.get(), (unsigned)StemSamples});
+		}
 
 	m_iFrameCycles = 0;
 
@@ -123,6 +319,9 @@ void CAPU::Reset()
 	// Reset APU
 	//
 
+	if (m_pCapture)		// // //
+		m_pCapture->Reset(m_iFrameCycles);
+
 	m_iSequencerCount	= 0;		// // //
 	m_iSequencerClock	= 0;		// // //
 	m_iSequencerNext	= MASTER_CLOCK_NTSC / C2A03Chan::SEQUENCER_FREQUENCY;
@@ -130,9 +329,10 @@ void CAPU::Reset()
 	m_iCyclesToRun		= 0;
 	m_iFrameCycles		= 0;
 
-	for (auto &c : m_pSoundChips)		// // //
-		if (auto *p2A03 = dynamic_cast<C2A03 *>(c.get()))
-			p2A03->ClearSample();
+	m_pChipRunner->Wake();		// // //
+
+	if (m_p2A03)		// // //
+		m_p2A03->ClearSample();
 
 	for (auto *Chip : m_pActiveChips) {		// // //
 		Chip->GetRegisterLogger().Reset();
@@ -146,13 +346,28 @@ void CAPU::Reset()
 #endif
 }
 
+void CAPU::SerializeState(CStateArchive &ar)		// // //
+{
+	ar.Check(m_iExternalSoundChip.GetFlag(), "sound chips");
+	ar.Check(m_iSampleRate, "sample rate");
+
+	// Sleeping chips catch up first so that their states are complete
+	m_pChipRunner->Wake();
+
+	ar(m_iCyclesToRun, m_iFrameCycles, m_iSequencerClock, m_iSequencerNext, m_iSequencerCount);
+	for (auto *Chip : m_pActiveChips) {
+		Chip->SerializeState(ar);
+		Chip->GetRegisterLogger().SerializeState(ar);
+	}
+	m_pMixer->SerializeState(ar);
+}
+
 void CAPU::SetupMixer(int LowCut, int HighCut, int HighDamp, int Volume) const
 {
 	// New settings
 	m_pMixer->UpdateSettings(LowCut, HighCut, HighDamp, float(Volume) / 100.0f);
-	for (auto &c : m_pSoundChips)		// // //
-		if (auto *pVRC7 = dynamic_cast<CVRC7 *>(c.get()))
-			pVRC7->SetVolume((float(Volume) / 100.0f) * m_fLevelVRC7);
+	if (m_pVRC7)		// // //
+		m_pVRC7->SetVolume((float(Volume) / 100.0f) * m_fLevelVRC7);
 }
 
 // // //
@@ -162,6 +377,7 @@ void CAPU::SetCallback(IAudioCallback &pCallback) {
 
 void CAPU::SetExternalSound(CSoundChipSet Chip) {
 	// Set expansion chip
+	m_pChipRunner->Wake();		// // //
 	m_iExternalSoundChip = Chip;
 	m_pMixer->ExternalSound(Chip);
 
@@ -171,6 +387,30 @@ void CAPU::SetExternalSound(CSoundChipSet Chip) {
 		if (Chip.ContainsChip(c->GetID()))
 			m_pActiveChips.push_back(c.get());
 
+	// // // Use a statically dispatched runner if only the built-in chips are active
+	stAPUChips Chips;
+	bool BuiltIn = true;
+	CSoundChipSet::value_type Flag = 0u;
+	for (auto *c : m_pActiveChips) {
+		sound_chip_t ID = c->GetID();
+		switch (ID) {
+		case sound_chip_t::APU:  BuiltIn &= !!(Chips.p2A03 = dynamic_cast<C2A03 *>(c)); break;
+		case sound_chip_t::VRC6: BuiltIn &= !!(Chips.pVRC6 = dynamic_cast<CVRC6 *>(c)); break;
+		case sound_chip_t::VRC7: BuiltIn &= !!(Chips.pVRC7 = dynamic_cast<CVRC7 *>(c)); break;
+		case sound_chip_t::FDS:  BuiltIn &= !!(Chips.pFDS  = dynamic_cast<CFDS  *>(c)); break;
+		case sound_chip_t::MMC5: BuiltIn &= !!(Chips.pMMC5 = dynamic_cast<CMMC5 *>(c)); break;
+		case sound_chip_t::N163: BuiltIn &= !!(Chips.pN163 = dynamic_cast<CN163 *>(c)); break;
+		case sound_chip_t::S5B:  BuiltIn &= !!(Chips.pS5B  = dynamic_cast<CS5B  *>(c)); break;
+		default: BuiltIn = false;
+		}
+		if (BuiltIn)
+			Flag |= 1u << value_cast(ID);
+	}
+	if (BuiltIn)
+		m_pChipRunner = STATIC_RUNNERS[Flag](Chips);
+	else
+		m_pChipRunner = std::make_unique<CAPUChipRunnerDynamic>(m_pActiveChips);
+
 	Reset();
 }
 
@@ -180,11 +420,10 @@ void CAPU::ChangeMachineRate(machine_t Machine, int Rate)		// // //
 	//
 
 	uint32_t BaseFreq = (Machine == machine_t::NTSC) ? MASTER_CLOCK_NTSC : MASTER_CLOCK_PAL;
-	for (auto &c : m_pSoundChips)		// // //
-		if (auto *p2A03 = dynamic_cast<C2A03 *>(c.get()))
-			p2A03->ChangeMachine(Machine);
-		else if (auto *pVRC7 = dynamic_cast<CVRC7 *>(c.get()))
-			pVRC7->SetSampleSpeed(m_iSampleRate, BaseFreq, Rate);
+	if (m_p2A03)		// // //
+		m_p2A03->ChangeMachine(Machine);
+	if (m_pVRC7)
+		m_pVRC7->SetSampleSpeed(m_iSampleRate, BaseFreq, Rate);
 }
 
 bool CAPU::SetupSound(int SampleRate, int NrChannels, machine_t Machine)		// // //
@@ -234,10 +473,31 @@ void CAPU::Write(uint16_t Address, uint8_t Value)
 
 	Process();
 
-	for (auto *Chip : m_pActiveChips)		// // //
-		Chip->Write(Address, Value);
+	if (m_pCapture)		// // //
+		m_pCapture->Write(m_iFrameCycles, Address, Value);
+
+	m_pChipRunner->Write(Address, Value);		// // // also logs the write
+}
+
+void CAPU::WriteSample(std::shared_ptr<const ft0cc::doc::dpcm_sample> pSample)		// // //
+{
+	// the sample takes effect after the cycles processed so far, like a register write
+	if (m_p2A03 && pSample) {
+		if (m_pCapture)
+			m_pCapture->WriteSample(m_iFrameCycles, *pSample);
+		m_p2A03->WriteSample(std::move(pSample));
+	}
+}
 
-	LogWrite(Address, Value);
+void CAPU::SetRegisterCapture(CRegisterCapture *pCapture)		// // //
+{
+	m_pCapture = pCapture;
+}
+
+bool CAPU::SetStemOutput(IStemCallback *pCallback, array_view<const stChannelID> Channels)		// // //
+{
+	m_pStemCallback = pCallback;
+	return m_pMixer->SetStemChannels(pCallback ? Channels : array_view<const stChannelID> { });
 }
 
 uint8_t CAPU::Read(uint16_t Address)
@@ -249,6 +509,7 @@ uint8_t CAPU::Read(uint16_t Address)
 	bool Mapped(false);
 
 	Process();
+	m_pChipRunner->Wake();		// // //
 
 	for (auto *Chip : m_pActiveChips)		// // //
 		if (!Mapped)
@@ -334,9 +595,9 @@ void CAPU::SetChipLevel(chip_level_t Chip, float Level)
 void CAPU::SetNamcoMixing(bool bLinear)		// // //
 {
 	m_pMixer->SetNamcoMixing(bLinear);
-	for (auto &c : m_pSoundChips)		// // //
-		if (auto *pN163 = dynamic_cast<CN163 *>(c.get()))
-			pN163->SetMixingMethod(bLinear);
+	m_pChipRunner->Wake();		// // //
+	if (m_pN163)		// // //
+		m_pN163->SetMixingMethod(bLinear);
 }
 
 void CAPU::SetMeterDecayRate(decay_rate_t Type) const		// // // 050B
@@ -349,15 +610,14 @@ decay_rate_t CAPU::GetMeterDecayRate() const		// // // 050B
 	return m_pMixer->GetMeterDecayRate();
 }
 
-void CAPU::LogWrite(uint16_t Address, uint8_t Value)
+void CAPU::EnableMetering(bool Enable) const		// // //
 {
-	for (auto *r : m_pActiveChips)		// // //
-		r->Log(Address, Value);
+	m_pMixer->EnableMetering(Enable);
 }
 
 uint8_t CAPU::GetReg(sound_chip_t Chip, int Reg) const
 {
-	if (auto *r = GetRegState(Chip, Reg))		// // //
+	if (auto r = GetRegState(Chip, Reg))		// // //
 		return r->GetValue();
 	return static_cast<uint8_t>(0);
 }
@@ -368,8 +628,8 @@ double CAPU::GetFreq(sound_chip_t Chip, int Chan) const
 	return pChip ? pChip->GetFreq(Chan) : 0.;
 }
 
-CRegisterState *CAPU::GetRegState(sound_chip_t Chip, int Reg) const		// // //
+std::optional<CRegisterState> CAPU::GetRegState(sound_chip_t Chip, int Reg) const		// // //
 {
 	const CSoundChip *pChip = GetSoundChip(Chip);
-	return pChip ? pChip->GetRegisterLogger().GetRegister(Reg) : nullptr;
+	return pChip ? pChip->GetRegisterLogger().GetRegister(Reg) : std::nullopt;
 }
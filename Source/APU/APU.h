@@ -28,6 +28,7 @@
 #include "Common.h"
 #include <memory>		// // //
 #include <vector>		// // //
+#include <optional>		// // //
 #include "SoundChipSet.h"		// // //
 #include "APUInterface.h"		// // //
 
@@ -36,7 +37,14 @@ class dpcm_sample;
 } // namespace ft0cc::doc
 class CMixer;		// // //
 class CSoundChip;		// // //
+class C2A03;		// // //
+class CMMC5;		// // //
+class CN163;		// // //
+class CVRC7;		// // //
+class CAPUChipRunner;		// // //
 class CRegisterState;		// // //
+class CStateArchive;		// // //
+class CRegisterCapture;		// // //
 enum chip_level_t : unsigned char;		// // //
 
 #ifdef LOGGING
@@ -55,6 +63,7 @@ public:
 
 	void	SetExternalSound(CSoundChipSet Chips);
 	void	Write(uint16_t Address, uint8_t Value) override;		// // //
+	void	WriteSample(std::shared_ptr<const ft0cc::doc::dpcm_sample> pSample) override;		// // //
 	uint8_t	Read(uint16_t Address);
 
 	void	ChangeMachineRate(machine_t Machine, int Rate);		// // //
@@ -65,7 +74,7 @@ public:
 	int32_t	GetVol(stChannelID Chan) const;		// // //
 	uint8_t	GetReg(sound_chip_t Chip, int Reg) const;
 	double	GetFreq(sound_chip_t Chip, int Chan) const;		// // //
-	CRegisterState *GetRegState(sound_chip_t Chip, int Reg) const;		// // //
+	std::optional<CRegisterState> GetRegState(sound_chip_t Chip, int Reg) const;		// // //
 
 	void	SetChipLevel(chip_level_t Chip, float Level);
 
@@ -73,9 +82,23 @@ public:
 
 	void	SetMeterDecayRate(decay_rate_t Type) const;		// // // 050B
 	decay_rate_t GetMeterDecayRate() const;		// // // 050B
+	void	EnableMetering(bool Enable) const;		// // //
 
 	CSoundChip *GetSoundChip(sound_chip_t Chip) const override;		// // //
 
+	// // // Saves or loads the emulation state between two frames, a state can only be loaded
+	// into an APU set up with the same sound chips, sample rate, machine and mixer settings
+	void	SerializeState(CStateArchive &ar);
+
+	// // // Records all writes, sample loads, resets and frame ends into a register log, the
+	// APU does not take ownership of the capture object; pass nullptr to stop recording
+	void	SetRegisterCapture(CRegisterCapture *pCapture);
+
+	// // // Renders each of the given tracker channels into its own buffer in the same pass as the
+	// main mix and sends them to the callback at the end of every frame; takes effect from the
+	// next reset, pass nullptr to disable stems
+	bool	SetStemOutput(IStemCallback *pCallback, array_view<const stChannelID> Channels);
+
 #ifdef LOGGING
 	void	Log();
 #endif
@@ -83,15 +106,22 @@ public:
 private:
 	void StepSequence();		// // //
 
-	void LogWrite(uint16_t Address, uint8_t Value);
-
 private:
 	std::unique_ptr<CMixer> m_pMixer;		// // //
 	IAudioCallback *m_pParent;
+	IStemCallback *m_pStemCallback = nullptr;		// // //
 
 	// Expansion chips
 	std::vector<std::unique_ptr<CSoundChip>> m_pSoundChips;		// // //
 	std::vector<CSoundChip *> m_pActiveChips;		// // //
+	std::unique_ptr<CAPUChipRunner> m_pChipRunner;		// // // Calls the active chips in the time-critical paths
+
+	C2A03		*m_p2A03 = nullptr;		// // //
+	CMMC5		*m_pMMC5 = nullptr;		// // //
+	CN163		*m_pN163 = nullptr;		// // //
+	CVRC7		*m_pVRC7 = nullptr;		// // //
+
+	CRegisterCapture *m_pCapture = nullptr;		// // //
 
 	CSoundChipSet m_iExternalSoundChip;				// // // External sound chip, if used
 
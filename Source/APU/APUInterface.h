@@ -24,9 +24,13 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>		// // //
 #include "APU/Types_fwd.h"
 
 class CSoundChip;
+namespace ft0cc::doc {
+class dpcm_sample;
+} // namespace ft0cc::doc
 
 class CAPUInterface {
 public:
@@ -35,4 +39,6 @@ public:
 	virtual CSoundChip *GetSoundChip(sound_chip_t Chip) const = 0;
 
 	virtual void Write(uint16_t Address, uint8_t Value) = 0;
+	// // // Loads a DPCM sample into the sample memory of the 2A03
+	virtual void WriteSample(std::shared_ptr<const ft0cc::doc::dpcm_sample> pSample) = 0;
 };
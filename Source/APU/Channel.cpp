@@ -22,6 +22,7 @@
 
 #include "APU/Channel.h"
 #include "APU/Mixer.h"
+#include "StateArchive.h"		// // //
 
 CChannel::CChannel(CMixer &Mixer, stChannelID ID) :
 	m_pMixer(&Mixer), m_iChanId(ID)
@@ -32,6 +33,10 @@ void CChannel::EndFrame() {
 	m_iTime = 0;
 }
 
+void CChannel::SerializeState(CStateArchive &ar) {		// // //
+	ar(m_iTime, m_iLastValue);
+}
+
 stChannelID CChannel::GetChannelType() const {		// // //
 	return m_iChanId;
 }
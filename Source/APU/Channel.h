@@ -27,6 +27,13 @@
 #include "APU/Types.h"		// // //
 
 class CMixer;
+class CStateArchive;		// // //
+
+// // // A single change of a channel's output, queued for batched mixing
+struct stMixDelta {
+	uint32_t	Time;		// Cycle count since the start of the frame
+	int32_t		Delta;
+};
 
 //
 // This class is used to derive the audio channels
@@ -38,6 +45,7 @@ public:
 
 	virtual ~CChannel() noexcept = default;
 	virtual void EndFrame();
+	virtual void SerializeState(CStateArchive &ar);		// // //
 
 	stChannelID GetChannelType() const;		// // //
 
@@ -21,6 +21,7 @@
 */
 
 #include "APU/DPCM.h"
+#include "StateArchive.h"		// // //
 #include "APU/Types.h"		// // //
 
 const uint16_t CDPCM::DMC_PERIODS_NTSC[16] = {
@@ -174,7 +175,7 @@ void CDPCM::Process(uint32_t Time)
 		m_iShiftReg >>= 1;
 		--m_iBitDivider;
 
-		Mix(m_iDeltaCounter);
+		QueueMix(m_iDeltaCounter);		// // //
 	}
 
 	m_iCounter -= Time;
@@ -188,3 +189,11 @@ double CDPCM::GetFrequency() const		// // //
 	double Rate = PERIOD_TABLE == DMC_PERIODS_PAL ? MASTER_CLOCK_PAL : MASTER_CLOCK_NTSC;
 	return Rate / m_iPeriod;
 }
+
+void CDPCM::SerializeState(CStateArchive &ar)		// // //
+{
+	C2A03Chan::SerializeState(ar);
+	ar(m_iBitDivider, m_iShiftReg, m_iPlayMode, m_iDeltaCounter, m_iSampleBuffer);
+	ar(m_iDMA_LoadReg, m_iDMA_LengthReg, m_iDMA_Address, m_iDMA_BytesRemaining);
+	ar(m_bTriggeredIRQ, m_bSampleFilled, m_bSilenceFlag);
+}
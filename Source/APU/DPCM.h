@@ -40,6 +40,7 @@ public:
 
 	uint8_t	DidIRQ() const;
 	void	Reload();
+	void	SerializeState(CStateArchive &ar) override;		// // //
 
 	CSampleMem &GetSampleMemory();		// // //
 	uint8_t	GetSamplePos() const { return  (m_iDMA_Address - (m_iDMA_LoadReg << 6 | 0x4000)) >> 6; }
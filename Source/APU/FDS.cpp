@@ -21,6 +21,7 @@
 */
 
 #include "APU/FDS.h"
+#include "StateArchive.h"		// // //
 #include "RegisterState.h"		// // //
 #include "ext/emu/FDSSound_new.h"		// // //
 #include "APU/Types.h"		// // //
@@ -46,6 +47,7 @@ sound_chip_t CFDS::GetID() const {		// // //
 void CFDS::Reset()
 {
 	emu_->Reset();
+	m_bSynced = false;		// // //
 }
 
 void CFDS::Write(uint16_t Address, uint8_t Value)
@@ -73,14 +75,37 @@ void CFDS::Process(uint32_t Time)
 	const uint32_t TIME_STEP = 32u; // ???
 
 	while (Time) {
+		// // // run whole steps at once until the next event if the output stays the same
+		if (m_bSynced && emu_->IsSettled()) {
+			const uint32_t Idle = emu_->NextEvent() - 1;
+			const uint32_t t = Idle >= Time ? Time : Idle / TIME_STEP * TIME_STEP;
+			if (t) {
+				emu_->Tick(t);
+				m_iTime += t;
+				Time -= t;
+				continue;
+			}
+		}
+
 		const uint32_t t = Time < TIME_STEP ? Time : TIME_STEP;
 		emu_->Tick(t);
 		Mix(emu_->Render());
+		m_bSynced = true;		// // //
 		m_iTime += t;
 		Time -= t;
 	}
 }
 
+bool CFDS::IsQuiescent() const		// // //
+{
+	return m_bSynced && emu_->IsSettled() && emu_->NextEvent() == xgm::NES_FDS::NO_EVENT;
+}
+
+bool CFDS::IsAddressMapped(uint16_t Address) const		// // //
+{
+	return Address == 0x4023 || (Address >= 0x4040 && Address <= 0x408A);
+}
+
 double CFDS::GetFreq(int Channel) const		// // //
 {
 	if (Channel) return 0.;
@@ -91,3 +116,10 @@ double CFDS::GetFreq(int Channel) const		// // //
 	Lo |= (Hi << 8) & 0xF00;
 	return MASTER_CLOCK_NTSC * (Lo / 4194304.);
 }
+
+void CFDS::SerializeState(CStateArchive &ar)		// // //
+{
+	static_assert(std::is_trivially_copyable_v<xgm::NES_FDS>);
+	CChannel::SerializeState(ar);
+	ar(m_bSynced, *emu_);
+}
@@ -30,7 +30,7 @@ namespace xgm {		// // //
 class NES_FDS;
 } // namespace xgm
 
-class CFDS : public CSoundChip, public CChannel {
+class CFDS final : public CSoundChip, public CChannel {
 public:
 	CFDS(CMixer &Mixer, std::uint8_t nInstance);		// // //
 	virtual ~CFDS();
@@ -47,6 +47,11 @@ public:
 	double	GetFreq(int Channel) const override;		// // //
 	double	GetFrequency() const { return GetFreq(0); }		// // //
 
+	bool	IsQuiescent() const override;		// // //
+	bool	IsAddressMapped(uint16_t Address) const override;		// // //
+	void	SerializeState(CStateArchive &ar) override;		// // //
+
 private:
 	std::unique_ptr<xgm::NES_FDS> emu_;		// // //
+	bool	m_bSynced = false;		// // // whether the last mixed value is the current emulator output
 };
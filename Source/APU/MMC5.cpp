@@ -21,6 +21,7 @@
 */
 
 #include "APU/MMC5.h"
+#include "StateArchive.h"		// // //
 #include "APU/Types.h"
 #include "RegisterState.h"		// // //
 
@@ -122,7 +123,9 @@ void CMMC5::EndFrame()
 void CMMC5::Process(uint32_t Time)
 {
 	m_Square1.Process(Time);
+	m_Square1.FlushDeltas();		// // //
 	m_Square2.Process(Time);
+	m_Square2.FlushDeltas();
 }
 
 double CMMC5::GetFreq(int Channel) const		// // //
@@ -151,3 +154,10 @@ void CMMC5::ClockSequence()
 	EnvelopeUpdate();		// // //
 	LengthCounterUpdate();		// // //
 }
+
+void CMMC5::SerializeState(CStateArchive &ar)		// // //
+{
+	m_Square1.SerializeState(ar);
+	m_Square2.SerializeState(ar);
+	ar(m_iEXRAM, m_iMulLow, m_iMulHigh);
+}
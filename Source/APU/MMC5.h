@@ -26,7 +26,7 @@
 #include "APU/SoundChip.h"
 #include "APU/Square.h"		// // //
 
-class CMMC5 : public CSoundChip {
+class CMMC5 final : public CSoundChip {
 public:
 	CMMC5(CMixer &Mixer, std::uint8_t nInstance);		// // //
 
@@ -40,6 +40,7 @@ public:
 	uint8_t Read(uint16_t Address, bool &Mapped) override;
 
 	double GetFreq(int Channel) const override;		// // //
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 	void LengthCounterUpdate();
 	void EnvelopeUpdate();
@@ -53,16 +53,83 @@
 */
 
 #include "APU/Mixer.h"
+#include "StateArchive.h"		// // //
 #include <algorithm>		// // //
 #include <memory>
 #include <cmath>
-#include "ext/emu/emu2413.h"		// // //
 
 namespace {
 
 const float LEVEL_FALL_OFF_RATE = 0.6f;
 const int   LEVEL_FALL_OFF_DELAY = 3;
 
+// // // Channel level table, channels are stored contiguously by sound chip
+constexpr std::size_t CHIP_CHANNEL_COUNT[] = {
+	MAX_CHANNELS_2A03,
+	MAX_CHANNELS_VRC6,
+	MAX_CHANNELS_VRC7,
+	MAX_CHANNELS_FDS,
+	MAX_CHANNELS_MMC5,
+	MAX_CHANNELS_N163,
+	MAX_CHANNELS_S5B,
+};
+
+static_assert(std::size(CHIP_CHANNEL_COUNT) == SOUND_CHIP_COUNT);
+
+constexpr auto MakeLevelIDs() noexcept {
+	std::array<stChannelID, CHANID_COUNT> ids = { };
+	std::size_t i = 0;
+	for (std::size_t c = 0; c < SOUND_CHIP_COUNT; ++c)
+		for (std::size_t s = 0; s < CHIP_CHANNEL_COUNT[c]; ++s)
+			ids[i++] = stChannelID {enum_cast<sound_chip_t>(static_cast<std::uint8_t>(c)), static_cast<std::uint8_t>(s)};
+	return ids;
+}
+
+constexpr auto LEVEL_IDS = MakeLevelIDs();
+
+constexpr std::size_t GetLevelIndex(stChannelID ch) noexcept {
+	std::size_t c = value_cast(ch.Chip);
+	if (c >= SOUND_CHIP_COUNT || ch.Subindex >= CHIP_CHANNEL_COUNT[c])
+		return CHANID_COUNT;
+	std::size_t Index = ch.Subindex;
+	for (std::size_t i = 0; i < c; ++i)
+		Index += CHIP_CHANNEL_COUNT[i];
+	return Index;
+}
+
+// // // Meters and stems use tracker channel order, in which N163 channels are reversed
+constexpr std::size_t GetTrackIndex(stChannelID ch) noexcept {
+	if (ch.Chip == sound_chip_t::N163)
+		ch.Subindex = static_cast<std::uint8_t>(MAX_CHANNELS_N163 - 1 - ch.Subindex);
+	return GetLevelIndex(ch);
+}
+
+// Converts the peak output of a channel to the scale of the channel meters
+double ConvertLevel(stChannelID Channel, int Peak) {
+	double AbsVol = Peak;
+
+	// Adjust channel levels for some channels
+	if (IsDPCM(Channel))
+		AbsVol /= 8.;
+
+	if (IsVRC6Sawtooth(Channel))
+		AbsVol = AbsVol * .75;
+
+	if (Channel.Chip == sound_chip_t::FDS)
+		AbsVol /= 188.;
+
+	if (Channel.Chip == sound_chip_t::N163)		// // //
+		AbsVol /= 15.;
+
+	if (Channel.Chip == sound_chip_t::VRC7)		// // //
+		AbsVol = std::log(AbsVol) * 3.;
+
+	if (Channel.Chip == sound_chip_t::S5B)		// // //
+		AbsVol = std::log(AbsVol) * 2.8;
+
+	return AbsVol;
+}
+
 constexpr chip_level_t GetMixerFromChannel(stChannelID ch) noexcept {		// // //
 	switch (ch.Chip) {
 	case sound_chip_t::APU:
@@ -171,6 +238,9 @@ void CMixer::UpdateSettings(int LowCut,	int HighCut, int HighDamp, float Overall
 
 	// Blip-buffer filtering
 	BlipBuffer.bass_freq(m_iLowCut);
+	for (auto &pStem : m_pStemBuffers)		// // //
+		if (pStem)
+			pStem->bass_freq(m_iLowCut);
 
 	blip_eq_t eq(-m_iHighDamp, m_iHighCut, m_iSampleRate);
 
@@ -200,8 +270,21 @@ void CMixer::SetNamcoVolume(float fVol)
 }
 
 void CMixer::UpdateMeters() {		// // //
-	for (auto &x : m_ChannelLevels) {
-		auto &lv = x.second;
+	if (!m_bMetering)
+		return;
+
+	for (std::size_t i = 0; i < CHANID_COUNT; ++i) {
+		auto &lv = m_ChannelLevels[i];
+		if (lv.Peak >= 0) {
+			// The conversions are monotonic, so only the peak of each frame matters
+			double AbsVol = ConvertLevel(LEVEL_IDS[i], lv.Peak);
+			if (AbsVol >= lv.Level) {
+				lv.Level = (float)AbsVol;
+				lv.FallOff = LEVEL_FALL_OFF_DELAY;
+			}
+			lv.Peak = -1;
+		}
+
 		lv.LastLevel = lv.Level;		// // //
 		if (m_iMeterDecayRate == decay_rate_t::Fast)		// // // 050B
 			lv.Level = 0;
@@ -213,7 +296,22 @@ void CMixer::UpdateMeters() {		// // //
 				lv.Level = 0.f;
 		}
 	}
+}
+
+void CMixer::ResetMeters() {		// // //
+	m_ChannelLevels.fill(stTrackLevel { });
+}
+
+void CMixer::EnableMetering(bool Enable)		// // //
+{
+	if (m_bMetering != Enable)
+		ResetMeters();
+	m_bMetering = Enable;
+}
 
+bool CMixer::IsMeteringEnabled() const		// // //
+{
+	return m_bMetering;
 }
 
 decay_rate_t CMixer::GetMeterDecayRate() const		// // // 050B
@@ -232,6 +330,65 @@ void CMixer::MixSamples(blip_sample_t *pBuffer, uint32_t Count)
 	BlipBuffer.mix_samples(pBuffer, Count);
 }
 
+bool CMixer::SetStemChannels(array_view<const stChannelID> Channels)		// // //
+{
+	for (auto &pStem : m_pStemBuffers)
+		pStem.reset();
+	m_StemChannels.clear();
+
+	for (stChannelID ch : Channels) {
+		std::size_t Index = GetLevelIndex(ch);
+		if (Index >= CHANID_COUNT || m_pStemBuffers[Index])
+			continue;
+		auto pStem = std::make_unique<Blip_Buffer>();
+		if (pStem->set_sample_rate(m_iSampleRate, (m_iBufferLength * 1000 * 4) / m_iSampleRate)) {
+			// roll back to no stems at all
+			for (auto &pBuffer : m_pStemBuffers)
+				pBuffer.reset();
+			m_StemChannels.clear();
+			return false;
+		}
+		pStem->clock_rate(m_iClockRate);
+		pStem->bass_freq(m_iLowCut);
+		m_pStemBuffers[Index] = std::move(pStem);
+		m_StemChannels.push_back(ch);
+	}
+
+	return true;
+}
+
+const std::vector<stChannelID> &CMixer::GetStemChannels() const		// // //
+{
+	return m_StemChannels;
+}
+
+bool CMixer::HasStem(stChannelID ChanID) const		// // //
+{
+	return GetStemBuffer(ChanID) != nullptr;
+}
+
+void CMixer::MixStemSamples(stChannelID ChanID, const blip_sample_t *pBuffer, uint32_t Count)		// // //
+{
+	if (Blip_Buffer *pStem = GetStemBuffer(ChanID))
+		pStem->mix_samples(pBuffer, Count);
+}
+
+int CMixer::ReadStem(stChannelID Chan, int Size, blip_sample_t *Buffer)		// // //
+{
+	std::size_t Index = GetLevelIndex(Chan);
+	if (Index < CHANID_COUNT && m_pStemBuffers[Index])
+		return m_pStemBuffers[Index]->read_samples(Buffer, Size);
+	return 0;
+}
+
+Blip_Buffer *CMixer::GetStemBuffer(stChannelID ChanID) const		// // //
+{
+	if (m_StemChannels.empty())
+		return nullptr;
+	std::size_t Index = GetTrackIndex(ChanID);
+	return Index < CHANID_COUNT ? m_pStemBuffers[Index].get() : nullptr;
+}
+
 uint32_t CMixer::GetMixSampleCount(int t) const
 {
 	return BlipBuffer.count_samples(t);
@@ -240,23 +397,52 @@ uint32_t CMixer::GetMixSampleCount(int t) const
 bool CMixer::AllocateBuffer(unsigned int BufferLength, uint32_t SampleRate, uint8_t NrChannels)
 {
 	m_iSampleRate = SampleRate;
+	m_iBufferLength = BufferLength;		// // //
+	for (auto &pStem : m_pStemBuffers)
+		if (pStem && pStem->set_sample_rate(SampleRate, (BufferLength * 1000 * 4) / SampleRate))
+			return false;
 	return !BlipBuffer.set_sample_rate(SampleRate, (BufferLength * 1000 * 4) / SampleRate);		// // //
 }
 
 void CMixer::SetClockRate(uint32_t Rate)
 {
 	// Change the clockrate
+	m_iClockRate = Rate;		// // //
 	BlipBuffer.clock_rate(Rate);
+	for (auto &pStem : m_pStemBuffers)
+		if (pStem)
+			pStem->clock_rate(Rate);
 }
 
 void CMixer::ClearBuffer()
 {
 	BlipBuffer.clear();
+	for (auto &pStem : m_pStemBuffers)		// // //
+		if (pStem)
+			pStem->clear();
 	VisitMixers([] (auto &levels) {
 		levels.ResetDelta();
 	});
 }
 
+void CMixer::SerializeState(CStateArchive &ar)		// // //
+{
+	ar.Check(m_iSampleRate, "sample rate");
+	ar.Check(m_bNamcoMixing, "N163 mixing method");
+
+	std::vector<long> Buffer(BlipBuffer.state_size());
+	if (!ar.IsLoading())
+		BlipBuffer.save_state(Buffer.data());
+	ar.Vector(Buffer);
+	if (ar.IsLoading() && BlipBuffer.load_state(Buffer.data(), static_cast<long>(Buffer.size())))
+		throw CStateArchiveException {"Invalid mixer state"};
+
+	VisitMixers([&] (auto &levels) {
+		levels.SerializeState(ar);
+	});
+	ar(m_ChannelLevels);
+}
+
 int CMixer::SamplesAvail() const
 {
 	return (int)BlipBuffer.samples_avail();
@@ -265,10 +451,9 @@ int CMixer::SamplesAvail() const
 int CMixer::FinishBuffer(int t)
 {
 	BlipBuffer.end_frame(t);
-
-	// Get channel levels for VRC7
-	for (std::size_t i = 0; i < MAX_CHANNELS_VRC7; ++i)
-		StoreChannelLevel(stChannelID {sound_chip_t::VRC7, static_cast<std::uint8_t>(i)}, OPLL_getchanvol(i));
+	for (auto &pStem : m_pStemBuffers)		// // //
+		if (pStem)
+			pStem->end_frame(t);
 
 	UpdateMeters();		// // //
 
@@ -282,7 +467,15 @@ int CMixer::FinishBuffer(int t)
 
 void CMixer::AddValue(stChannelID ChanID, int Value, int FrameCycles) {		// // //
 	WithMixer(GetMixerFromChannel(ChanID), [&] (auto &mixer) {
-		StoreChannelLevel(ChanID, mixer.AddValue(ChanID, Value, FrameCycles, BlipBuffer));
+		StoreChannelLevel(ChanID, mixer.AddValue(ChanID, Value, FrameCycles, BlipBuffer, GetStemBuffer(ChanID)));
+	});
+}
+
+void CMixer::AddDeltas(stChannelID ChanID, array_view<const stMixDelta> Deltas) {		// // //
+	if (Deltas.empty())
+		return;
+	WithMixer(GetMixerFromChannel(ChanID), [&] (auto &mixer) {
+		StoreChannelLevel(ChanID, mixer.AddDeltas(ChanID, Deltas, BlipBuffer, GetStemBuffer(ChanID)));
 	});
 }
 
@@ -292,39 +485,19 @@ int CMixer::ReadBuffer(int Size, blip_sample_t *Buffer, bool Stereo) {		// // //
 
 int32_t CMixer::GetChanOutput(stChannelID Chan) const		// // //
 {
-	auto it = m_ChannelLevels.find(Chan);
-	return it != m_ChannelLevels.end() ? it->second.LastLevel : 0;
+	std::size_t Index = GetLevelIndex(Chan);
+	return Index < CHANID_COUNT ? m_ChannelLevels[Index].LastLevel : 0;
 }
 
 void CMixer::StoreChannelLevel(stChannelID Channel, int Level)		// // //
 {
-	double AbsVol = std::abs(Level);
-
-	// Adjust channel levels for some channels
-	if (IsDPCM(Channel))
-		AbsVol /= 8.;
-
-	if (IsVRC6Sawtooth(Channel))
-		AbsVol = AbsVol * .75;
-
-	if (Channel.Chip == sound_chip_t::FDS)
-		AbsVol /= 188.;
-
-	if (Channel.Chip == sound_chip_t::N163) {		// // //
-		AbsVol /= 15.;
-		Channel.Subindex = static_cast<uint8_t>(enum_count<n163_subindex_t>() - 1 - Channel.Subindex);
-	}
-
-	if (Channel.Chip == sound_chip_t::VRC7)		// // //
-		AbsVol = std::log(AbsVol) * 3.;
-
-	if (Channel.Chip == sound_chip_t::S5B)		// // //
-		AbsVol = std::log(AbsVol) * 2.8;
+	if (!m_bMetering)
+		return;
 
-	auto &lv = m_ChannelLevels[Channel];
-	if (AbsVol >= lv.Level) {
-		lv.Level = (float)AbsVol;
-		lv.FallOff = LEVEL_FALL_OFF_DELAY;
+	std::size_t Index = GetTrackIndex(Channel);		// // //
+	if (Index < CHANID_COUNT) {
+		auto &lv = m_ChannelLevels[Index];
+		lv.Peak = std::max(lv.Peak, std::abs(Level));
 	}
 }
 
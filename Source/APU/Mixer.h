@@ -28,7 +28,8 @@
 #include "Common.h"
 #include "ext/Blip_Buffer/Blip_Buffer.h"
 #include <array>		// // //
-#include <map>		// // //
+#include <memory>		// // //
+#include <vector>		// // //
 #include "SoundChipSet.h"		// // //
 
 enum chip_level_t : unsigned char {
@@ -47,6 +48,7 @@ class CMixer
 {
 public:
 	void	AddValue(stChannelID ChanID, int Value, int FrameCycles);		// // //
+	void	AddDeltas(stChannelID ChanID, array_view<const stMixDelta> Deltas);		// // //
 
 	void	ExternalSound(CSoundChipSet Chip);		// // //
 	void	UpdateSettings(int LowCut, int HighCut, int HighDamp, float OverallVol);
@@ -54,6 +56,7 @@ public:
 	bool	AllocateBuffer(unsigned int Size, uint32_t SampleRate, uint8_t NrChannels);
 	void	SetClockRate(uint32_t Rate);
 	void	ClearBuffer();
+	void	SerializeState(CStateArchive &ar);		// // //
 	int		FinishBuffer(int t);
 	int		SamplesAvail() const;
 	void	MixSamples(blip_sample_t *pBuffer, uint32_t Count);
@@ -61,6 +64,14 @@ public:
 
 	int		ReadBuffer(int Size, blip_sample_t *Buffer, bool Stereo);		// // //
 
+	// // // Per-channel stem output, enabled before an APU reset; stems use tracker channel IDs
+	// and are not part of the saved state
+	bool	SetStemChannels(array_view<const stChannelID> Channels);
+	const std::vector<stChannelID> &GetStemChannels() const;
+	bool	HasStem(stChannelID ChanID) const;
+	void	MixStemSamples(stChannelID ChanID, const blip_sample_t *pBuffer, uint32_t Count);
+	int		ReadStem(stChannelID Chan, int Size, blip_sample_t *Buffer);
+
 	int32_t	GetChanOutput(stChannelID Chan) const;		// // //
 	void	SetChipLevel(chip_level_t Chip, float Level);
 	uint32_t	ResampleDuration(uint32_t Time) const;
@@ -70,9 +81,14 @@ public:
 	decay_rate_t GetMeterDecayRate() const;		// // // 050B
 	void	SetMeterDecayRate(decay_rate_t Rate);		// // // 050B
 
+	void	StoreChannelLevel(stChannelID Channel, int Level);		// // //
+	void	EnableMetering(bool Enable);		// // //
+	bool	IsMeteringEnabled() const;		// // //
+
 private:
 	void UpdateMeters();		// // //
-	void StoreChannelLevel(stChannelID Channel, int Level);		// // //
+	Blip_Buffer *GetStemBuffer(stChannelID ChanID) const;		// // //
+	void ResetMeters();		// // //
 
 	float GetAttenuation() const;
 
@@ -88,6 +104,9 @@ private:
 	// Blip buffer object
 	Blip_Buffer	BlipBuffer;
 
+	std::array<std::unique_ptr<Blip_Buffer>, CHANID_COUNT> m_pStemBuffers;		// // //
+	std::vector<stChannelID> m_StemChannels;		// // //
+
 	CMixerChannel<stLevels2A03SS>  levels2A03SS_  { 500.00};		// // //
 	CMixerChannel<stLevels2A03TND> levels2A03TND_ { 500.00};
 	CMixerChannel<stLevelsVRC6>    levelsVRC6_    { 125.52};
@@ -98,14 +117,18 @@ private:
 
 	CSoundChipSet m_iExternalChip;
 	uint32_t	m_iSampleRate = 0;
+	unsigned	m_iBufferLength = 0;		// // //
+	uint32_t	m_iClockRate = 0;		// // //
 
 	struct stTrackLevel {		// // //
+		int Peak = -1;			// Largest absolute output since the last frame, -1 if none
 		float Level = 0.f;
 		float LastLevel = 0.f;
 		uint32_t FallOff = 0u;
 	};
 
-	std::map<stChannelID, stTrackLevel> m_ChannelLevels;		// // //
+	std::array<stTrackLevel, CHANID_COUNT> m_ChannelLevels = { };		// // //
+	bool		m_bMetering = true;		// // //
 
 	decay_rate_t m_iMeterDecayRate = decay_rate_t::Slow;		// // // 050B
 	int			m_iLowCut = 0;
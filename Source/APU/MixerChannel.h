@@ -24,7 +24,12 @@
 #pragma once
 
 #include "APU/Types.h"
+#include "APU/Channel.h"		// // //
 #include "ext/Blip_Buffer/Blip_Buffer.h"
+#include "ft0cc/cpputil/array_view.hpp"		// // //
+#include "StateArchive.h"		// // //
+#include <cstdlib>		// // //
+#include <array>		// // //
 
 class CMixerChannelBase {
 public:
@@ -46,20 +51,78 @@ class CMixerChannel : public CMixerChannelBase {
 public:
 	using CMixerChannelBase::CMixerChannelBase;
 
-	int AddValue(stChannelID ChanID, int Value, int FrameCycles, Blip_Buffer &bb) {
-		const int level = levels_.Offset(enum_cast<typename LevelsT::subindex_t>(ChanID.Subindex), Value);
+	// // // stem receives the output of the channel as if all other channels were silent
+	int AddValue(stChannelID ChanID, int Value, int FrameCycles, Blip_Buffer &bb, Blip_Buffer *stem = nullptr) {
+		const auto subindex = enum_cast<typename LevelsT::subindex_t>(ChanID.Subindex);
+		const int level = levels_.Offset(subindex, Value);
 		const double prev = lastSum_;
 		lastSum_ = levels_.CalcPin();
 		const double Delta = lastSum_ - prev;
 		synth_.offset(FrameCycles, static_cast<int>(Delta), &bb);
+		if (stem)		// // //
+			synth_.offset(FrameCycles, StemOffset(subindex, Value), stem);
 		return level;
 	}
 
+	// // // Same as calling AddValue for each delta, returns the level farthest from zero
+	int AddDeltas(stChannelID ChanID, array_view<const stMixDelta> Deltas, Blip_Buffer &bb, Blip_Buffer *stem = nullptr) {
+		constexpr std::size_t BATCH_SIZE = 64u;
+		blip_time_t times[BATCH_SIZE];
+		int offsets[BATCH_SIZE];
+		int stemOffsets[BATCH_SIZE];
+		std::size_t count = 0u;
+
+		const auto subindex = enum_cast<typename LevelsT::subindex_t>(ChanID.Subindex);
+		int peak = 0;
+		for (const auto &x : Deltas) {
+			const int level = levels_.Offset(subindex, x.Delta);
+			if (std::abs(level) > std::abs(peak))
+				peak = level;
+			const double prev = lastSum_;
+			lastSum_ = levels_.CalcPin();
+			times[count] = x.Time;
+			offsets[count] = static_cast<int>(lastSum_ - prev);
+			if (stem)
+				stemOffsets[count] = StemOffset(subindex, x.Delta);
+			if (++count == BATCH_SIZE) {
+				synth_.offset_batch(times, offsets, static_cast<int>(count), &bb);
+				if (stem)
+					synth_.offset_batch(times, stemOffsets, static_cast<int>(count), stem);
+				count = 0u;
+			}
+		}
+		synth_.offset_batch(times, offsets, static_cast<int>(count), &bb);
+		if (stem)
+			synth_.offset_batch(times, stemOffsets, static_cast<int>(count), stem);
+		return peak;
+	}
+
 	void ResetDelta() {
 		lastSum_ = 0;
 		levels_ = LevelsT { };
+		stems_.fill(stStemLevels { });		// // //
+	}
+
+	void SerializeState(CStateArchive &ar) {		// // //
+		ar(lastSum_, levels_);
+	}
+
+private:
+	int StemOffset(typename LevelsT::subindex_t subindex, int Value) {		// // //
+		auto &stem = stems_[value_cast(subindex)];
+		stem.levels.Offset(subindex, Value);
+		const double prev = stem.lastSum;
+		stem.lastSum = stem.levels.CalcPin();
+		return static_cast<int>(stem.lastSum - prev);
 	}
 
 private:
 	LevelsT levels_;
+
+	// // // levels of each channel on its own, used for stem output
+	struct stStemLevels {
+		LevelsT levels;
+		double lastSum = 0.;
+	};
+	std::array<stStemLevels, enum_count<typename LevelsT::subindex_t>()> stems_ = { };
 };
@@ -21,6 +21,7 @@
 */
 
 #include "APU/N163.h"
+#include "StateArchive.h"		// // //
 #include "APU/Mixer.h"		// // //
 #include "RegisterState.h"		// // //
 #include <algorithm>		// // //
@@ -91,6 +92,11 @@ void CN163::Process(uint32_t Time)
 
 	m_pMixer->SetNamcoVolume((m_iChansInUse == 0) ? 1.3f : (1.5f + float(m_iChansInUse - 1) / 1.5f));
 
+	if (IsQuiescent()) {		// // //
+		ProcessIdle(Time);
+		return;
+	}
+
 	while (Time > 0) {
 		uint32_t TimeToRun = std::min(Time, CHAN_PERIOD - m_iChannelCntr);		// // //
 
@@ -111,6 +117,68 @@ void CN163::Process(uint32_t Time)
 	}
 }
 
+void CN163::ProcessIdle(uint32_t Time)		// // //
+{
+	// Same as Process while all channels are silent, but runs whole rounds of channel slots at once
+	const uint32_t CHAN_PERIOD = 15;
+
+	const auto NextChan = [&] (uint32_t Chan) {
+		return Chan + m_iChansInUse < MAX_CHANNELS_N163 ? MAX_CHANNELS_N163 - 1 : Chan - 1;
+	};
+
+	if (!Time)
+		return;
+	m_iGlobalTime += Time;
+
+	// Finish the current slot
+	const uint32_t TimeToRun = std::min(Time, CHAN_PERIOD - m_iChannelCntr);
+	m_Channels[m_iActiveChan].ProcessIdle(TimeToRun);
+	m_iLastChan = m_iActiveChan;
+	m_iChannelCntr += TimeToRun;
+	Time -= TimeToRun;
+	if (m_iChannelCntr < CHAN_PERIOD)
+		return;
+	m_iActiveChan = NextChan(m_iActiveChan);
+	m_iChannelCntr = 0;
+
+	const uint32_t Slots = Time / CHAN_PERIOD;
+	const uint32_t Count = m_iChansInUse + 1;
+
+	// Whole rounds end on the channel before the active one
+	if (const uint32_t Rounds = Slots / Count) {
+		for (uint32_t i = MAX_CHANNELS_N163 - Count; i < MAX_CHANNELS_N163; ++i)
+			m_Channels[i].ProcessIdle(Rounds * CHAN_PERIOD);
+		m_iLastChan = m_iActiveChan == MAX_CHANNELS_N163 - 1 ? MAX_CHANNELS_N163 - Count : m_iActiveChan + 1;
+	}
+
+	for (uint32_t i = Slots % Count; i > 0; --i) {
+		m_Channels[m_iActiveChan].ProcessIdle(CHAN_PERIOD);
+		m_iLastChan = m_iActiveChan;
+		m_iActiveChan = NextChan(m_iActiveChan);
+	}
+
+	if (const uint32_t Rest = Time % CHAN_PERIOD) {
+		m_Channels[m_iActiveChan].ProcessIdle(Rest);
+		m_iLastChan = m_iActiveChan;
+		m_iChannelCntr = Rest;
+	}
+}
+
+bool CN163::IsQuiescent() const		// // //
+{
+	if (m_bOldMixing || m_iLastValue || !m_Channels[m_iActiveChan].IsIdle())
+		return false;
+	for (int i = MAX_CHANNELS_N163 - 1 - m_iChansInUse; i < MAX_CHANNELS_N163; ++i)
+		if (!m_Channels[i].IsIdle())
+			return false;
+	return true;
+}
+
+bool CN163::IsAddressMapped(uint16_t Address) const		// // //
+{
+	return Address == 0x4800 || Address == 0xF800;
+}
+
 void CN163::ProcessOld(uint32_t Time)		// // //
 {
 	m_pMixer->SetNamcoVolume((m_iChansInUse == 0) ? 1.0f : 0.75f);
@@ -225,6 +293,15 @@ uint8_t CN163::ReadMem(uint8_t Reg)
 	return m_Channels[Chan].ReadMem(Reg);
 }
 
+void CN163::SerializeState(CStateArchive &ar)		// // //
+{
+	ar.Check(m_bOldMixing, "N163 mixing method");
+	for (auto &Chan : m_Channels)
+		Chan.SerializeState(ar);
+	ar(m_iWaveData, m_iExpandAddr, m_iChansInUse, m_iLastValue);
+	ar(m_iGlobalTime, m_iChannelCntr, m_iActiveChan, m_iLastChan, m_iCycle);
+}
+
 //
 // N163 channels
 //
@@ -348,6 +425,26 @@ void CN163Chan::ProcessClean(uint32_t Time, uint8_t ChannelsActive)
 	m_iTime += Time;
 }
 
+void CN163Chan::ProcessIdle(uint32_t Time)		// // //
+{
+	// Same as Process while the channel is silent
+	if (m_iFrequency && m_iWaveLength) {
+		if (Time >= m_iCounter) {
+			const uint32_t Steps = (Time - m_iCounter) / 15 + 1;
+			m_iCounter = 15 - (Time - m_iCounter) % 15;
+			m_iPhase = static_cast<uint32_t>((m_iPhase + static_cast<uint64_t>(m_iFrequency) * Steps) % m_iWaveLength);
+		}
+		else
+			m_iCounter -= Time;
+	}
+	m_iTime += Time;
+}
+
+bool CN163Chan::IsIdle() const		// // //
+{
+	return !m_iLastSample && (!m_iFrequency || !m_iWaveLength || !m_iVolume);
+}
+
 uint8_t CN163Chan::ReadMem(uint8_t Reg)
 {
 	switch (Reg & 7) {
@@ -381,3 +478,9 @@ double CN163Chan::GetFrequency() const		// // //
 {
 	return MASTER_CLOCK_NTSC / 983040. * m_iFrequency / (m_iWaveLength >> 16);
 }
+
+void CN163Chan::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannel::SerializeState(ar);
+	ar(m_iCounter, m_iFrequency, m_iPhase, m_iWaveLength, m_iVolume, m_iWaveOffset, m_iLastSample);
+}
@@ -40,10 +40,13 @@ public:
 
 	void Process(uint32_t Time, uint8_t ChannelsActive);		// // //
 	void ProcessClean(uint32_t Time, uint8_t ChannelsActive);		// // //
+	void ProcessIdle(uint32_t Time);		// // //
+	bool IsIdle() const;		// // //
 
 	uint8_t ReadMem(uint8_t Reg);
 	void ResetCounter();
 	double GetFrequency() const;		// // //
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 private:
 	uint32_t	m_iCounter, m_iFrequency;
@@ -59,7 +62,7 @@ private:
 	CN163		&parent_;
 };
 
-class CN163 : public CSoundChip {
+class CN163 final : public CSoundChip {
 public:
 	CN163(CMixer &Mixer, std::uint8_t nInstance);		// // //
 
@@ -80,8 +83,13 @@ public:
 	void Mix(int32_t Value, uint32_t Time, stChannelID ChanID);		// // //
 	void SetMixingMethod(bool bLinear);		// // //
 
+	bool IsQuiescent() const override;		// // //
+	bool IsAddressMapped(uint16_t Address) const override;		// // //
+	void SerializeState(CStateArchive &ar) override;		// // //
+
 protected:
 	void ProcessOld(uint32_t Time);		// // //
+	void ProcessIdle(uint32_t Time);		// // //
 
 private:
 	CN163Chan	m_Channels[MAX_CHANNELS_N163];		// // //
@@ -21,6 +21,7 @@
 */
 
 #include "APU/Noise.h"
+#include "StateArchive.h"		// // //
 #include "APU/Types.h"		// // //
 
 const uint16_t CNoise::NOISE_PERIODS_NTSC[16] = {
@@ -111,7 +112,7 @@ void CNoise::Process(uint32_t Time)
 		m_iTime	  += m_iCounter;
 		m_iCounter = m_iPeriod;
 		uint8_t Volume = m_iEnvelopeFix ? m_iFixedVolume : m_iEnvelopeVolume;
-		Mix(Valid && (m_iShiftReg & 1) ? Volume : 0);
+		QueueMix(Valid && (m_iShiftReg & 1) ? Volume : 0);		// // //
 		m_iShiftReg = (((m_iShiftReg << 14) ^ (m_iShiftReg << m_iSampleRate)) & 0x4000) | (m_iShiftReg >> 1);
 	}
 
@@ -145,3 +146,9 @@ void CNoise::EnvelopeUpdate()
 		}
 	}
 }
+
+void CNoise::SerializeState(CStateArchive &ar)		// // //
+{
+	C2A03Chan::SerializeState(ar);
+	ar(m_iLooping, m_iEnvelopeFix, m_iEnvelopeSpeed, m_iEnvelopeVolume, m_iFixedVolume, m_iEnvelopeCounter, m_iSampleRate, m_iShiftReg);
+}
@@ -44,6 +44,7 @@ public:
 
 	void	LengthCounterUpdate();
 	void	EnvelopeUpdate();
+	void	SerializeState(CStateArchive &ar) override;		// // //
 
 public:
 	static const uint16_t	NOISE_PERIODS_NTSC[16];
@@ -0,0 +1,218 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "APU/RegisterCapture.h"
+#include "APU/APU.h"
+#include "APU/Types.h"
+#include "ft0cc/doc/dpcm_sample.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+const std::uint8_t LOG_HEADER[] = {'0', 'C', 'C', 'R', 'E', 'G', 0x01u};
+const unsigned EVENT_BITS = 3u;
+
+enum log_event_t : unsigned {
+	EVENT_WRITE,		// address (2 bytes), value
+	EVENT_END_FRAME,
+	EVENT_RESET,
+	EVENT_SAMPLE,		// sample index, followed by its size and contents if not seen before
+	EVENT_PROCESS,
+};
+
+} // namespace
+
+CRegisterCapture::CRegisterCapture(CSoundChipSet Chips, machine_t Machine, int FrameRate) :
+	log_(std::begin(LOG_HEADER), std::end(LOG_HEADER))
+{
+	PutNumber(Chips.GetFlag());
+	log_.push_back(value_cast(Machine));
+	PutNumber(FrameRate);
+}
+
+void CRegisterCapture::Process(uint32_t Cycle) {
+	// deferred until the next event, which may make it redundant
+	FlushProcess(Cycle);
+	process_cycle_ = Cycle;
+	process_pending_ = true;
+}
+
+void CRegisterCapture::Write(uint32_t Cycle, uint16_t Address, uint8_t Value) {
+	PutEvent(Cycle, EVENT_WRITE);
+	log_.push_back(static_cast<std::uint8_t>(Address & 0xFF));
+	log_.push_back(static_cast<std::uint8_t>(Address >> 8));
+	log_.push_back(Value);
+}
+
+void CRegisterCapture::WriteSample(uint32_t Cycle, const ft0cc::doc::dpcm_sample &Sample) {
+	PutEvent(Cycle, EVENT_SAMPLE);
+	const std::uint8_t *b = Sample.data();
+	const std::uint8_t *e = b + Sample.size();
+	auto it = std::find_if(samples_.begin(), samples_.end(), [&] (const std::vector<std::uint8_t> &x) {
+		return std::equal(x.begin(), x.end(), b, e);
+	});
+	PutNumber(static_cast<uint32_t>(it - samples_.begin()));
+	if (it == samples_.end()) {
+		samples_.emplace_back(b, e);
+		PutNumber(static_cast<uint32_t>(Sample.size()));
+		log_.insert(log_.end(), b, e);
+	}
+}
+
+void CRegisterCapture::Reset(uint32_t Cycle) {
+	PutEvent(Cycle, EVENT_RESET);
+	last_cycle_ = 0u;
+}
+
+void CRegisterCapture::EndFrame(uint32_t Cycle) {
+	PutEvent(Cycle, EVENT_END_FRAME);
+	last_cycle_ = 0u;
+	++frames_;
+}
+
+array_view<const std::uint8_t> CRegisterCapture::GetLog() const {
+	return log_;
+}
+
+unsigned CRegisterCapture::GetFrameCount() const {
+	return frames_;
+}
+
+void CRegisterCapture::FlushProcess(uint32_t Cycle) {
+	if (std::exchange(process_pending_, false) && process_cycle_ != Cycle) {
+		PutNumber(((process_cycle_ - last_cycle_) << EVENT_BITS) | EVENT_PROCESS);
+		last_cycle_ = process_cycle_;
+	}
+}
+
+void CRegisterCapture::PutEvent(uint32_t Cycle, unsigned Type) {
+	FlushProcess(Cycle);
+	PutNumber(((Cycle - last_cycle_) << EVENT_BITS) | Type);
+	last_cycle_ = Cycle;
+}
+
+void CRegisterCapture::PutNumber(uint32_t x) {
+	while (x >= 0x80u) {
+		log_.push_back(static_cast<std::uint8_t>(x | 0x80u));
+		x >>= 7;
+	}
+	log_.push_back(static_cast<std::uint8_t>(x));
+}
+
+
+
+CRegisterReplayer::CRegisterReplayer(array_view<const std::uint8_t> Log) : log_(Log) {
+	if (log_.size() < std::size(LOG_HEADER) || !std::equal(std::begin(LOG_HEADER), std::end(LOG_HEADER), log_.begin()))
+		throw CRegisterLogException {"Not a register log"};
+	pos_ = std::size(LOG_HEADER);
+	chips_ = CSoundChipSet::FromFlag(GetNumber());
+	machine_ = enum_cast<machine_t>(GetByte());
+	rate_ = static_cast<int>(GetNumber());
+	if (!chips_.HasChips() || machine_ == machine_t::none || rate_ <= 0)
+		throw CRegisterLogException {"Invalid register log header"};
+	start_ = pos_;
+}
+
+CSoundChipSet CRegisterReplayer::GetSoundChipSet() const {
+	return chips_;
+}
+
+machine_t CRegisterReplayer::GetMachine() const {
+	return machine_;
+}
+
+int CRegisterReplayer::GetFrameRate() const {
+	return rate_;
+}
+
+void CRegisterReplayer::ConfigureAPU(CAPU &apu) const {
+	apu.SetExternalSound(chips_);
+	apu.ChangeMachineRate(machine_, rate_);
+}
+
+bool CRegisterReplayer::ReplayFrame(CAPU &apu) {
+	// all cycles before an event are processed first, so that the APU is split into the same
+	// time slices wherever the state can change
+	while (pos_ < log_.size()) {
+		uint32_t x = GetNumber();
+		apu.AddTime(x >> EVENT_BITS);
+		switch (x & ((1u << EVENT_BITS) - 1)) {
+		case EVENT_WRITE: {
+			uint16_t Address = GetByte();
+			Address |= GetByte() << 8;
+			apu.Write(Address, GetByte());
+		} break;
+		case EVENT_END_FRAME:
+			apu.Process();
+			apu.EndFrame();
+			return true;
+		case EVENT_RESET:
+			apu.Process();
+			apu.Reset();
+			break;
+		case EVENT_SAMPLE: {
+			std::size_t Index = GetNumber();
+			if (Index == samples_.size()) {
+				std::size_t Size = GetNumber();
+				if (Size > ft0cc::doc::dpcm_sample::max_size || log_.size() - pos_ < Size)
+					throw CRegisterLogException {"Invalid DPCM sample in register log"};
+				samples_.push_back(std::make_shared<ft0cc::doc::dpcm_sample>(
+					std::vector<std::uint8_t>(log_.begin() + pos_, log_.begin() + pos_ + Size), ""));
+				pos_ += Size;
+			}
+			else if (Index > samples_.size())
+				throw CRegisterLogException {"Invalid DPCM sample in register log"};
+			apu.Process();
+			apu.WriteSample(samples_[Index]);
+		} break;
+		case EVENT_PROCESS:
+			apu.Process();
+			break;
+		default:
+			throw CRegisterLogException {"Invalid event in register log"};
+		}
+	}
+	return false;
+}
+
+void CRegisterReplayer::Rewind() {
+	pos_ = start_;
+}
+
+uint8_t CRegisterReplayer::GetByte() {
+	if (pos_ >= log_.size())
+		throw CRegisterLogException {"Unexpected end of register log"};
+	return log_[pos_++];
+}
+
+uint32_t CRegisterReplayer::GetNumber() {
+	uint32_t x = 0u;
+	for (unsigned Shift = 0u; Shift < 32u; Shift += 7u) {
+		uint8_t b = GetByte();
+		x |= static_cast<uint32_t>(b & 0x7Fu) << Shift;
+		if (!(b & 0x80u))
+			return x;
+	}
+	throw CRegisterLogException {"Invalid number in register log"};
+}
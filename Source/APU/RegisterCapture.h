@@ -0,0 +1,113 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include "ft0cc/cpputil/array_view.hpp"
+#include "SoundChipSet.h"
+
+namespace ft0cc::doc {
+class dpcm_sample;
+} // namespace ft0cc::doc
+class CAPU;
+
+class CRegisterLogException : public std::runtime_error {
+	using std::runtime_error::runtime_error;
+};
+
+// // // Records the stream of writes made to an APU into a compact binary log
+//
+// The log begins with the sound chips, machine type and frame rate of the APU. Each following
+// event is a variable-length integer holding the number of cycles since the previous event of
+// the same frame, shifted left by 3 and combined with the event type, followed by its payload.
+// DPCM samples are stored once and referred to by index afterwards.
+//
+// The emulation output depends on how the elapsed time is divided between calls to
+// CAPU::Process, so these calls are recorded as well unless another event follows at the
+// same cycle.
+class CRegisterCapture {
+public:
+	CRegisterCapture(CSoundChipSet Chips, machine_t Machine, int FrameRate);
+
+	// All cycle counts are relative to the start of the current APU frame
+	void Process(uint32_t Cycle);
+	void Write(uint32_t Cycle, uint16_t Address, uint8_t Value);
+	void WriteSample(uint32_t Cycle, const ft0cc::doc::dpcm_sample &Sample);
+	void Reset(uint32_t Cycle);
+	void EndFrame(uint32_t Cycle);
+
+	array_view<const std::uint8_t> GetLog() const;
+	unsigned GetFrameCount() const;
+
+private:
+	void FlushProcess(uint32_t Cycle);
+	void PutEvent(uint32_t Cycle, unsigned Type);
+	void PutNumber(uint32_t x);
+
+private:
+	std::vector<std::uint8_t> log_;
+	std::vector<std::vector<std::uint8_t>> samples_;
+	uint32_t last_cycle_ = 0u;
+	uint32_t process_cycle_ = 0u;
+	bool process_pending_ = false;
+	unsigned frames_ = 0u;
+};
+
+// // // Drives an APU directly from a register log, without a sound driver
+class CRegisterReplayer {
+public:
+	// Throws CRegisterLogException if the log header is invalid
+	explicit CRegisterReplayer(array_view<const std::uint8_t> Log);
+
+	CSoundChipSet GetSoundChipSet() const;
+	machine_t GetMachine() const;
+	int GetFrameRate() const;
+
+	// Selects the sound chips and machine type of the log, the APU must already be set up
+	// with SetupSound and SetupMixer
+	void ConfigureAPU(CAPU &apu) const;
+	// Replays the events up to and including the end of the next frame, returns false at the
+	// end of the log
+	bool ReplayFrame(CAPU &apu);
+	void Rewind();
+
+private:
+	uint8_t GetByte();
+	uint32_t GetNumber();
+
+private:
+	array_view<const std::uint8_t> log_;
+	std::size_t start_ = 0u;
+	std::size_t pos_ = 0u;
+	std::vector<std::shared_ptr<const ft0cc::doc::dpcm_sample>> samples_;
+
+	CSoundChipSet chips_;
+	machine_t machine_;
+	int rate_ = 0;
+};
@@ -21,6 +21,7 @@
 */
 
 #include "APU/S5B.h"
+#include "StateArchive.h"		// // //
 #include <algorithm>
 #include "APU/Types.h"		// // //
 #include "RegisterState.h"
@@ -95,6 +96,12 @@ double CS5BChannel::GetFrequency() const		// // //
 	return MASTER_CLOCK_NTSC / 2. / m_iPeriod;
 }
 
+void CS5BChannel::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannel::SerializeState(ar);
+	ar(m_iVolume, m_iPeriod, m_iPeriodClock, m_bSquareHigh, m_bSquareDisable, m_bNoiseDisable);
+}
+
 
 
 // Sunsoft 5B chip class
@@ -284,3 +291,11 @@ void CS5B::RunNoise(uint32_t Time)
 		m_iNoiseState >>= 1;
 	}
 }
+
+void CS5B::SerializeState(CStateArchive &ar)		// // //
+{
+	for (auto &Chan : m_Channel)
+		Chan.SerializeState(ar);
+	ar(m_cPort, m_iCounter, m_iNoisePeriod, m_iNoiseClock, m_iNoiseState);
+	ar(m_iEnvelopePeriod, m_iEnvelopeClock, m_iEnvelopeLevel, m_iEnvelopeShape, m_bEnvelopeHold);
+}
@@ -42,6 +42,7 @@ public:
 	void Output(uint32_t Noise, uint32_t Envelope);
 
 	double GetFrequency() const;
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 private:
 	uint8_t m_iVolume;
@@ -53,7 +54,7 @@ private:
 	bool m_bNoiseDisable;
 };
 
-class CS5B : public CSoundChip
+class CS5B final : public CSoundChip
 {
 public:
 	CS5B(CMixer &Mixer, std::uint8_t nInstance);
@@ -70,6 +71,7 @@ public:
 	void	Log(uint16_t Address, uint8_t Value) override;		// // //
 
 	double	GetFreq(int Channel) const override;		// // //
+	void	SerializeState(CStateArchive &ar) override;		// // //
 
 private:
 	void	WriteReg(uint8_t Port, uint8_t Value);
@@ -33,6 +33,10 @@ void CSampleMem::SetMem(array_view<const uint8_t> Memory) {
 	m_pMemory = Memory;
 }
 
+array_view<const uint8_t> CSampleMem::GetMem() const {		// // //
+	return m_pMemory;
+}
+
 void CSampleMem::Clear() {
 	m_pMemory.clear();
 }
@@ -32,6 +32,7 @@ class CSampleMem		// // //
 public:
 	uint8_t ReadMem(uint16_t Address) const;
 	void SetMem(array_view<const uint8_t> Buffer);
+	array_view<const uint8_t> GetMem() const;		// // //
 	void Clear();
 
 private:
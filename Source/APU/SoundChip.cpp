@@ -38,6 +38,16 @@ double CSoundChip::GetFreq(int Channel) const		// // //
 	return 0.0;
 }
 
+bool CSoundChip::IsQuiescent() const		// // //
+{
+	return false;
+}
+
+bool CSoundChip::IsAddressMapped(uint16_t Address) const		// // //
+{
+	return true;
+}
+
 void CSoundChip::Log(uint16_t Address, uint8_t Value)		// // //
 {
 	// default logger operation
@@ -29,6 +29,7 @@
 
 class CMixer;
 class CRegisterLogger;		// // //
+class CStateArchive;		// // //
 
 class CSoundChip {
 public:
@@ -46,6 +47,15 @@ public:
 
 	virtual double	GetFreq(int Channel) const;		// // //
 
+	// // // A quiescent chip keeps its output level until it is written to, so that the
+	// APU may put it to sleep and catch up on the skipped time with a single Process call
+	virtual bool	IsQuiescent() const;
+	// // // Returns false if writing to the given address has no effect on the chip
+	virtual bool	IsAddressMapped(uint16_t Address) const;
+
+	// // // Saves or loads the emulation state of the chip, excluding its configuration
+	virtual void	SerializeState(CStateArchive &ar) = 0;
+
 	virtual void	Log(uint16_t Address, uint8_t Value);		// // //
 	CRegisterLogger &GetRegisterLogger() const;		// // //
 
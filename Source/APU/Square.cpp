@@ -21,6 +21,7 @@
 */
 
 #include "APU/Square.h"
+#include "StateArchive.h"		// // //
 #include "APU/Mixer.h"		// // //
 
 // This is also shared with MMC5
@@ -135,14 +136,30 @@ void CSquare::Process(uint32_t Time)
 
 	bool Valid = (m_iPeriod > 7 || (m_iPeriod > 0 && GetChannelType().Chip == sound_chip_t::MMC5))		// // //
 		&& (m_iEnabled != 0) && (m_iLengthCounter > 0) && (m_iSweepResult < 0x800);
-
-	while (Time >= m_iCounter) {
-		Time		-= m_iCounter;
-		m_iTime		+= m_iCounter;
-		m_iCounter	 = m_iPeriod + 1;
-		uint8_t Volume = m_iEnvelopeFix ? m_iFixedVolume : m_iEnvelopeVolume;
-		Mix(Valid && DUTY_TABLE[m_iDutyLength][m_iDutyCycle] ? Volume : 0);
-		m_iDutyCycle = (m_iDutyCycle + 1) & 0x0F;
+	uint8_t Volume = m_iEnvelopeFix ? m_iFixedVolume : m_iEnvelopeVolume;
+	const uint32_t Period = m_iPeriod + 1u;
+
+	if (!Valid || !Volume) {		// // // output stays at zero, skip to the last step
+		if (Time >= m_iCounter) {
+			uint32_t Steps = (Time - m_iCounter) / Period;
+			Time		-= m_iCounter;
+			m_iTime		+= m_iCounter;
+			QueueMix(0);
+			Time		-= Steps * Period;
+			m_iTime		+= Steps * Period;
+			m_iCounter	 = Period;
+			m_iDutyCycle = (m_iDutyCycle + Steps + 1) & 0x0F;
+		}
+	}
+	else {
+		const uint8_t *Duty = DUTY_TABLE[m_iDutyLength];
+		while (Time >= m_iCounter) {
+			Time		-= m_iCounter;
+			m_iTime		+= m_iCounter;
+			m_iCounter	 = Period;
+			QueueMix(Duty[m_iDutyCycle] ? Volume : 0);		// // //
+			m_iDutyCycle = (m_iDutyCycle + 1) & 0x0F;
+		}
 	}
 
 	m_iCounter -= Time;
@@ -197,3 +214,10 @@ void CSquare::EnvelopeUpdate()
 		}
 	}
 }
+
+void CSquare::SerializeState(CStateArchive &ar)		// // //
+{
+	C2A03Chan::SerializeState(ar);
+	ar(m_iDutyLength, m_iDutyCycle, m_iLooping, m_iEnvelopeFix, m_iEnvelopeSpeed, m_iEnvelopeVolume, m_iFixedVolume, m_iEnvelopeCounter);
+	ar(m_iSweepEnabled, m_iSweepPeriod, m_iSweepMode, m_iSweepShift, m_iSweepCounter, m_iSweepResult, m_bSweepWritten);
+}
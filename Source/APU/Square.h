@@ -45,6 +45,7 @@ public:
 	void	LengthCounterUpdate();
 	void	SweepUpdate(int Diff);
 	void	EnvelopeUpdate();
+	void	SerializeState(CStateArchive &ar) override;		// // //
 
 public:
 	static const uint8_t DUTY_TABLE[4][16];
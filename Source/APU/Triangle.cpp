@@ -21,6 +21,7 @@
 */
 
 #include "APU/Triangle.h"
+#include "StateArchive.h"		// // //
 #include "APU/Types.h"		// // //
 
 const uint8_t CTriangle::TRIANGLE_WAVE[] = {
@@ -113,7 +114,7 @@ void CTriangle::Process(uint32_t Time)
 		Time	  -= m_iCounter;
 		m_iTime   += m_iCounter;
 		m_iCounter = m_iPeriod + 1;
-		Mix(TRIANGLE_WAVE[m_iStepGen]);
+		QueueMix(TRIANGLE_WAVE[m_iStepGen]);		// // //
 		m_iStepGen = (m_iStepGen + 1) & 0x1F;
 	}
 
@@ -152,3 +153,9 @@ void CTriangle::LinearCounterUpdate()
 	if (m_iLoop == 0)
 		m_iHalt = 0;
 }
+
+void CTriangle::SerializeState(CStateArchive &ar)		// // //
+{
+	C2A03Chan::SerializeState(ar);
+	ar(m_iLoop, m_iLinearLoad, m_iHalt, m_iLinearCounter, m_iStepGen);
+}
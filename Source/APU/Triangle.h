@@ -44,6 +44,7 @@ public:
 
 	void	LengthCounterUpdate();
 	void	LinearCounterUpdate();
+	void	SerializeState(CStateArchive &ar) override;		// // //
 
 public:
 	uint32_t CPU_RATE;		// // //
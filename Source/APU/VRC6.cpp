@@ -21,6 +21,7 @@
 */
 
 #include "APU/VRC6.h"
+#include "StateArchive.h"		// // //
 #include "APU/Types.h"		// // //
 #include "RegisterState.h"		// // //
 
@@ -72,6 +73,19 @@ void CVRC6_Pulse::Process(int Time)
 		return;
 	}
 
+	if (!m_iVolume && !m_iLastValue) {		// // // silent, only the duty cycle counter moves
+		if (Time >= m_iCounter) {
+			const int Period = m_iPeriod + 1;
+			const int Steps = (Time - m_iCounter) / Period + 1;
+			m_iCounter = Period - (Time - m_iCounter) % Period;
+			m_iDutyCycleCounter = (m_iDutyCycleCounter + Steps) & 0x0F;
+		}
+		else
+			m_iCounter -= Time;
+		m_iTime += Time;
+		return;
+	}
+
 	while (Time >= m_iCounter) {
 		Time      -= m_iCounter;
 		m_iTime	  += m_iCounter;
@@ -92,6 +106,17 @@ double CVRC6_Pulse::GetFrequency() const		// // //
 	return MASTER_CLOCK_NTSC / 16. / (m_iPeriod + 1.);
 }
 
+bool CVRC6_Pulse::IsIdle() const		// // //
+{
+	return !m_iEnabled || !m_iPeriod || (!m_iVolume && !m_iLastValue);
+}
+
+void CVRC6_Pulse::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannel::SerializeState(ar);
+	ar(m_iDutyCycle, m_iVolume, m_iGate, m_iEnabled, m_iPeriod, m_iPeriodLow, m_iPeriodHigh, m_iCounter, m_iDutyCycleCounter);
+}
+
 CVRC6_Sawtooth::CVRC6_Sawtooth(CMixer &Mixer, std::uint8_t nInstance) :
 	CChannel(Mixer, {nInstance, sound_chip_t::VRC6, value_cast(vrc6_subindex_t::sawtooth)})		// // //
 {
@@ -134,6 +159,19 @@ void CVRC6_Sawtooth::Process(int Time)
 		return;
 	}
 
+	if (!m_iPhaseAccumulator && !m_iPhaseInput && !m_iLastValue) {		// // // silent, only the reset counter moves
+		if (Time >= m_iCounter) {
+			const int Period = m_iPeriod + 1;
+			const int Steps = (Time - m_iCounter) / Period + 1;
+			m_iCounter = Period - (Time - m_iCounter) % Period;
+			m_iResetReg = (m_iResetReg + Steps) % 14;
+		}
+		else
+			m_iCounter -= Time;
+		m_iTime += Time;
+		return;
+	}
+
 	while (Time >= m_iCounter) {
 		Time 	  -= m_iCounter;
 		m_iTime	  += m_iCounter;
@@ -164,6 +202,17 @@ double CVRC6_Sawtooth::GetFrequency() const		// // //
 	return MASTER_CLOCK_NTSC / 14. / (m_iPeriod + 1.);
 }
 
+bool CVRC6_Sawtooth::IsIdle() const		// // //
+{
+	return !m_iEnabled || !m_iPeriod || (!m_iPhaseAccumulator && !m_iPhaseInput && !m_iLastValue);
+}
+
+void CVRC6_Sawtooth::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannel::SerializeState(ar);
+	ar(m_iPhaseAccumulator, m_iPhaseInput, m_iEnabled, m_iResetReg, m_iPeriod, m_iPeriodLow, m_iPeriodHigh, m_iCounter);
+}
+
 CVRC6::CVRC6(CMixer &Mixer, std::uint8_t nInstance) :
 	CSoundChip(Mixer, nInstance),		// // //
 	m_Pulse1(Mixer, nInstance, vrc6_subindex_t::pulse1),
@@ -227,6 +276,22 @@ void CVRC6::Process(uint32_t Time)
 	m_Sawtooth.Process(Time);
 }
 
+bool CVRC6::IsQuiescent() const		// // //
+{
+	return m_Pulse1.IsIdle() && m_Pulse2.IsIdle() && m_Sawtooth.IsIdle();
+}
+
+bool CVRC6::IsAddressMapped(uint16_t Address) const		// // //
+{
+	switch (Address) {
+	case 0x9000: case 0x9001: case 0x9002:
+	case 0xA000: case 0xA001: case 0xA002:
+	case 0xB000: case 0xB001: case 0xB002:
+		return true;
+	}
+	return false;
+}
+
 double CVRC6::GetFreq(int Channel) const		// // //
 {
 	switch (Channel) {
@@ -236,3 +301,10 @@ double CVRC6::GetFreq(int Channel) const		// // //
 	}
 	return 0.;
 }
+
+void CVRC6::SerializeState(CStateArchive &ar)		// // //
+{
+	m_Pulse1.SerializeState(ar);
+	m_Pulse2.SerializeState(ar);
+	m_Sawtooth.SerializeState(ar);
+}
@@ -33,6 +33,8 @@ public:
 	void Write(uint16_t Address, uint8_t Value);
 	void Process(int Time);
 	double GetFrequency() const;		// // //
+	bool IsIdle() const;		// // //
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 private:
 	uint8_t	m_iDutyCycle,
@@ -53,6 +55,8 @@ public:
 	void Write(uint16_t Address, uint8_t Value);
 	void Process(int Time);
 	double GetFrequency() const;		// // //
+	bool IsIdle() const;		// // //
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 private:
 	uint8_t	m_iPhaseAccumulator,
@@ -65,7 +69,7 @@ private:
 	int32_t	m_iCounter;
 };
 
-class CVRC6 : public CSoundChip {
+class CVRC6 final : public CSoundChip {
 public:
 	explicit CVRC6(CMixer &Mixer, std::uint8_t nInstance);
 
@@ -80,6 +84,10 @@ public:
 
 	double GetFreq(int Channel) const override;		// // //
 
+	bool IsQuiescent() const override;		// // //
+	bool IsAddressMapped(uint16_t Address) const override;		// // //
+	void SerializeState(CStateArchive &ar) override;		// // //
+
 private:
 	CVRC6_Pulse	m_Pulse1;		// // //
 	CVRC6_Pulse	m_Pulse2;
@@ -21,8 +21,10 @@
 */
 
 #include "APU/VRC7.h"
+#include "StateArchive.h"		// // //
 #include "APU/Mixer.h"		// // //
 #include "RegisterState.h"		// // //
+#include <algorithm>		// // //
 
 const float  CVRC7::AMPLIFY	  = 4.6f;		// Mixing amplification, VRC7 patch 14 is 4,88 times stronger than a 50% square @ v=15
 const uint32_t CVRC7::OPL_CLOCK = 3579545;	// Clock frequency
@@ -42,12 +44,23 @@ sound_chip_t CVRC7::GetID() const {		// // //
 
 void CVRC7::Reset()
 {
-	m_iBufferPtr = 0;
 	m_iTime = 0;
+	m_iLastStemSample.fill(0);		// // //
 }
 
+namespace {
+
+// // // built once so that several APUs may create OPLL objects concurrently
+void InitOPLLTables() {
+	static const bool TablesReady = (OPLL_init(), true);
+	(void)TablesReady;
+}
+
+} // namespace
+
 void CVRC7::SetSampleSpeed(uint32_t SampleRate, double ClockRate, uint32_t FrameRate)
 {
+	InitOPLLTables();		// // //
 	m_pOPLLInt.reset(OPLL_new(OPL_CLOCK, SampleRate));		// // //
 
 	OPLL_reset(m_pOPLLInt.get());
@@ -55,7 +68,9 @@ void CVRC7::SetSampleSpeed(uint32_t SampleRate, double ClockRate, uint32_t Frame
 
 	m_iMaxSamples = (SampleRate / FrameRate) * 2;	// Allow some overflow
 
-	m_iBuffer = std::vector<int16_t>(m_iMaxSamples);		// // //
+	m_iRawBuffer = std::vector<int16_t>(m_iMaxSamples);		// // //
+	m_iScaled = std::vector<int32_t>(m_iMaxSamples + 1);
+	m_iBuffer = std::vector<int16_t>(m_iMaxSamples);
 }
 
 void CVRC7::SetVolume(float Volume)
@@ -92,34 +107,56 @@ void CVRC7::EndFrame()
 {
 	uint32_t WantSamples = m_pMixer->GetMixSampleCount(m_iTime);
 
-	static int32_t LastSample = 0;
+	// // // Channels with stem output also need their own samples
+	std::array<int16_t *, MAX_CHANNELS_VRC7> pStems = { };
+	bool HasStems = false;
+	for (std::size_t i = 0; i < MAX_CHANNELS_VRC7; ++i)
+		if (m_pMixer->HasStem(stChannelID {sound_chip_t::VRC7, static_cast<std::uint8_t>(i)})) {
+			m_iStemRaw[i].resize(m_iMaxSamples);
+			pStems[i] = m_iStemRaw[i].data();
+			HasStems = true;
+		}
+
+	// // // Generate VRC7 samples
+	if (HasStems)
+		OPLL_calc_block_split(m_pOPLLInt.get(), m_iRawBuffer.data(), pStems.data(), MAX_CHANNELS_VRC7, WantSamples);
+	else
+		OPLL_calc_block(m_pOPLLInt.get(), m_iRawBuffer.data(), WantSamples);
+
+	m_iLastSample = ScaleSamples(m_iRawBuffer.data(), m_iBuffer.data(), WantSamples, m_iLastSample);		// // //
+	m_pMixer->MixSamples((blip_sample_t*)m_iBuffer.data(), WantSamples);		// // //
 
-	// Generate VRC7 samples
-	while (m_iBufferPtr < WantSamples) {
-		int32_t RawSample = OPLL_calc(m_pOPLLInt.get());
+	for (std::size_t i = 0; i < MAX_CHANNELS_VRC7; ++i)		// // //
+		if (pStems[i]) {
+			m_iLastStemSample[i] = ScaleSamples(pStems[i], m_iBuffer.data(), WantSamples, m_iLastStemSample[i]);
+			m_pMixer->MixStemSamples(stChannelID {sound_chip_t::VRC7, static_cast<std::uint8_t>(i)}, m_iBuffer.data(), WantSamples);
+		}
 
-		// Clipping is slightly asymmetric
-		if (RawSample > 3600)
-			RawSample = 3600;
-		if (RawSample < -3200)
-			RawSample = -3200;
+	// Get channel levels for VRC7
+	for (std::size_t i = 0; i < MAX_CHANNELS_VRC7; ++i)		// // //
+		m_pMixer->StoreChannelLevel(stChannelID {sound_chip_t::VRC7, static_cast<std::uint8_t>(i)}, OPLL_getchanvol(m_pOPLLInt.get(), i));
 
-		// Apply volume
-		int32_t Sample = int(float(RawSample) * m_fVolume);
+	m_iTime = 0;
+}
 
-		if (Sample > 32767)
-			Sample = 32767;
-		if (Sample < -32768)
-			Sample = -32768;
+int32_t CVRC7::ScaleSamples(const int16_t *pRaw, int16_t *pOut, uint32_t Count, int32_t LastSample)		// // //
+{
+	// The loops below have no dependencies between iterations so that they can be vectorized
+	int32_t *pScaled = m_iScaled.data();
+	const float Volume = m_fVolume;
 
-		m_iBuffer[m_iBufferPtr++] = int16_t((Sample + LastSample) >> 1);
-		LastSample = Sample;
-	}
+	pScaled[0] = LastSample;
+	for (uint32_t i = 0; i < Count; ++i) {
+		// Clipping is slightly asymmetric
+		int32_t RawSample = std::clamp<int32_t>(pRaw[i], -3200, 3600);
 
-	m_pMixer->MixSamples((blip_sample_t*)m_iBuffer.data(), WantSamples);		// // //
+		// Apply volume
+		pScaled[i + 1] = std::clamp(int32_t(float(RawSample) * Volume), -32768, 32767);
+	}
 
-	m_iBufferPtr -= WantSamples;
-	m_iTime = 0;
+	for (uint32_t i = 0; i < Count; ++i)
+		pOut[i] = int16_t((pScaled[i] + pScaled[i + 1]) >> 1);
+	return pScaled[Count];
 }
 
 void CVRC7::Process(uint32_t Time)
@@ -137,3 +174,20 @@ double CVRC7::GetFreq(int Channel) const		// // //
 	Hi >>= 1;
 	return 49716. * Lo / (1 << (19 - Hi));
 }
+
+void CVRC7::SerializeState(CStateArchive &ar)		// // //
+{
+	ar.Check(m_pOPLLInt->rate, "VRC7 sample rate");
+
+	std::vector<uint8_t> State(OPLL_getStateSize());
+	if (!ar.IsLoading())
+		OPLL_saveState(m_pOPLLInt.get(), State.data());
+	ar.Vector(State);
+	if (ar.IsLoading()) {
+		if (State.size() != OPLL_getStateSize())
+			throw CStateArchiveException {"Invalid VRC7 state"};
+		OPLL_loadState(m_pOPLLInt.get(), State.data());
+	}
+
+	ar(m_iTime, m_iLastSample, m_iSoundReg);
+}
@@ -24,8 +24,10 @@
 #pragma once
 
 #include "APU/SoundChip.h"
+#include "APU/Types.h"		// // //
 #include "ext/emu/emu2413.h"		// // //
 #include <vector>		// // //
+#include <array>		// // //
 
 struct OPLL_deleter {
 	void operator()(void *ptr) {
@@ -33,7 +35,7 @@ struct OPLL_deleter {
 	}
 };
 
-class CVRC7 : public CSoundChip {
+class CVRC7 final : public CSoundChip {
 public:
 	CVRC7(CMixer &Mixer, std::uint8_t nInstance);		// // //
 
@@ -52,6 +54,10 @@ public:
 	void Log(uint16_t Address, uint8_t Value) override;		// // //
 
 	double GetFreq(int Channel) const override;		// // //
+	void SerializeState(CStateArchive &ar) override;		// // //
+
+private:
+	int32_t ScaleSamples(const int16_t *pRaw, int16_t *pOut, uint32_t Count, int32_t LastSample);		// // //
 
 protected:
 	static const float  AMPLIFY;
@@ -62,8 +68,12 @@ private:
 	uint32_t	m_iTime;
 
 	uint32_t	m_iMaxSamples = 0;
+	std::vector<int16_t> m_iRawBuffer;		// // // OPLL output
+	std::vector<int32_t> m_iScaled;		// // // scaled samples, preceded by the last sample of the previous frame
 	std::vector<int16_t> m_iBuffer;		// // //
-	uint32_t	m_iBufferPtr;
+	int32_t		m_iLastSample = 0;		// // //
+	std::array<std::vector<int16_t>, MAX_CHANNELS_VRC7> m_iStemRaw;		// // // output of each channel for stems
+	std::array<int32_t, MAX_CHANNELS_VRC7> m_iLastStemSample = { };		// // //
 
 	float		m_fVolume = 1.f;
 
@@ -49,6 +49,7 @@ CChannelHandler::CChannelHandler(stChannelID ch, int MaxPeriod, int MaxVolume) :
 	m_iChannelID(ch),		// // //
 	m_iVibratoMode(CFamiTrackerModule::DEFAULT_VIBRATO_STYLE),		// // //
 	m_iInstTypeCurrent(INST_NONE),		// // //
+	m_iInstTypeHandler(INST_NONE),		// // //
 	m_iMaxPeriod(MaxPeriod),
 	m_iMaxVolume(MaxVolume)
 {
@@ -430,8 +431,8 @@ bool CChannelHandler::HandleInstrument(bool Trigger, bool NewInstrument)		// //
 
 	// load instrument here
 	inst_type_t instType = pInstrument->GetType();
-	if (NewInstrument)
-		CreateInstHandler(instType);
+	if (NewInstrument && CreateInstHandler(instType))		// // //
+		m_iInstTypeHandler = instType;
 	m_iInstTypeCurrent = instType;
 
 	if (!m_pInstHandler)
@@ -449,6 +450,50 @@ bool CChannelHandler::CreateInstHandler(inst_type_t Type)
 	return false;
 }
 
+void CChannelHandler::SerializeState(CStateArchive &ar)		// // //
+{
+	// the instrument handler is recreated from its instrument without calling LoadInstrument
+	auto pManager = m_pSoundGen->GetInstrumentManager();
+	bool HasHandler = m_pInstHandler != nullptr;
+	int Index = -1;
+	if (HasHandler && !ar.IsLoading() && pManager) {
+		auto pInst = m_pInstHandler->GetInstrument();
+		for (int i = 0; i < MAX_INSTRUMENTS; ++i)
+			if (pInst && pManager->GetInstrument(i) == pInst) {
+				Index = i;
+				break;
+			}
+		if (Index == -1)
+			throw CStateArchiveException {"Instrument handler does not use an instrument from the current module"};
+	}
+	ar(HasHandler, Index, m_iInstTypeHandler);
+
+	if (ar.IsLoading()) {
+		m_pInstHandler.reset();
+		if (HasHandler) {
+			std::shared_ptr<const CInstrument> pInst = pManager ? pManager->GetInstrument(Index) : nullptr;
+			if (!pInst)
+				throw CStateArchiveException {"State snapshot does not match the current instrument"};
+			m_iInstTypeCurrent = INST_NONE;
+			CreateInstHandler(m_iInstTypeHandler);
+			if (!m_pInstHandler)
+				throw CStateArchiveException {"State snapshot does not match the current channel"};
+			m_pInstHandler->SerializeState(ar, std::move(pInst));
+		}
+	}
+	else if (HasHandler)
+		m_pInstHandler->SerializeState(ar, m_pInstHandler->GetInstrument());
+
+	ar(m_bTrigger, m_bRelease, m_bGate, m_iInstrument, m_bForceReload, m_iNote, m_iActiveNote,
+		m_iPeriod, m_iInstVolume, m_iVolume, m_iDutyPeriod, m_iEchoBuffer, m_iVibratoMode, m_bLinearPitch);
+	ar(m_bDelayEnabled, m_cDelayCounter, m_cnDelayed);
+	ar(m_iVibratoDepth, m_iVibratoSpeed, m_iVibratoPhase, m_iTremoloDepth, m_iTremoloSpeed, m_iTremoloPhase);
+	ar(m_iEffect, m_iEffectParam, m_iArpState, m_iPortaTo, m_iPortaSpeed);
+	ar(m_iNoteCut, m_iNoteRelease, m_iNoteVolume, m_iDefaultVolume, m_iNewVolume,
+		m_iTranspose, m_bTransposeDown, m_iTransposeTarget, m_iFinePitch, m_iDefaultDuty, m_iVolSlide);
+	ar(m_iPitch, m_iInstTypeCurrent);
+}
+
 void CChannelHandler::SetNoteTable(array_view<const unsigned> NoteLookupTable)		// // //
 {
 	// Installs the note lookup table
@@ -44,6 +44,7 @@ class CAPUInterface;		// // //
 class stChannelState;
 class CSoundGenBase;		// // //
 class CFamiTrackerModule;		// // //
+class CStateArchive;		// // //
 
 enum inst_type_t : unsigned;		// // //
 enum class vibrato_t : std::uint8_t;		// // //
@@ -116,6 +117,11 @@ public:
 		\param A channel state object.
 		\sa CSoundGen::ApplyGlobalState */
 	virtual void	ApplyChannelState(const stChannelState &State);	// // //
+	/*!	\brief Saves or loads the runtime state of the channel handler, including its instrument
+		handler.
+		\details Subclasses holding additional state should call the base method first.
+		\param ar The state archive. */
+	virtual void	SerializeState(CStateArchive &ar);		// // //
 
 	/*!	\brief Sets the channel handler's note lookup table.
 		\param pNoteLookupTable View into the note lookup table. */
@@ -512,6 +518,8 @@ protected:
 		instruments not native to the current sound channel.
 		\sa CChannelHandler::ConvertDuty */
 	inst_type_t		m_iInstTypeCurrent;
+	/*!	\brief The instrument type which created the current instrument handler. */
+	inst_type_t		m_iInstTypeHandler;		// // //
 	/*!	\brief A pointer to the currently installed instrument handler. */
 	std::unique_ptr<CInstHandler>	m_pInstHandler;				// // //
 
@@ -32,6 +32,7 @@
 #include "SeqInstHandler.h"		// // //
 #include "InstHandlerDPCM.h"		// // //
 #include "SongState.h"		// // //
+#include "StateArchive.h"		// // //
 #ifndef FT0CC_EXT_BUILD
 #include "FamiTrackerEnv.h"		// // //
 #include "Settings.h"
@@ -134,6 +135,12 @@ void CChannelHandler2A03::ResetChannel()
 	m_iLengthCounter = 1;
 }
 
+void CChannelHandler2A03::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandler::SerializeState(ar);
+	ar(m_bHardwareEnvelope, m_bEnvelopeLoop, m_bResetEnvelope, m_iLengthCounter);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 // // // 2A03 Square
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -189,6 +196,12 @@ void C2A03Square::RefreshChannel()
 	m_bResetEnvelope = false;		// // //
 }
 
+void C2A03Square::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandler2A03::SerializeState(ar);
+	ar(m_cSweep, m_bSweeping, m_iSweep, m_iLastPeriod);
+}
+
 int C2A03Square::ConvertDuty(int Duty) const		// // //
 {
 	switch (m_iInstTypeCurrent) {
@@ -302,6 +315,12 @@ void CTriangleChan::ResetChannel()
 	m_iLinearCounter = -1;
 }
 
+void CTriangleChan::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandler2A03::SerializeState(ar);
+	ar(m_iLinearCounter);
+}
+
 int CTriangleChan::GetChannelVolume() const
 {
 	return m_iVolume ? VOL_COLUMN_MAX : 0;
@@ -652,6 +671,13 @@ void CDPCMChan::RefreshChannel()
 	}
 }
 
+void CDPCMChan::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandler::SerializeState(ar);
+	ar(m_cDAC, m_iLoop, m_iOffset, m_iSampleLength, m_iLoopOffset, m_iLoopLength,
+		m_iRetrigger, m_iRetriggerCntr, m_iCustomPitch, m_bRetrigger, m_bEnabled);
+}
+
 int CDPCMChan::GetChannelVolume() const
 {
 	return VOL_COLUMN_MAX;
@@ -672,8 +698,7 @@ void CDPCMChan::SetLoopOffset(unsigned char Loop)		// // //
 void CDPCMChan::PlaySample(std::shared_ptr<const ft0cc::doc::dpcm_sample> pSamp, int Pitch)		// // //
 {
 	int SampleSize = pSamp->size();
-	if (auto *p2A03 = dynamic_cast<C2A03 *>(m_pAPU->GetSoundChip(sound_chip_t::APU)))
-		p2A03->WriteSample(std::move(pSamp));		// // //
+	m_pAPU->WriteSample(std::move(pSamp));		// // //
 	m_iPeriod = m_iCustomPitch != -1 ? m_iCustomPitch : Pitch;
 	m_iSampleLength = (SampleSize >> 4) - (m_iOffset << 2);
 	m_iLoopLength = SampleSize - m_iLoopOffset;
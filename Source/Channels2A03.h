@@ -33,6 +33,7 @@ class CChannelHandler2A03 : public CChannelHandler {
 public:
 	explicit CChannelHandler2A03(stChannelID ch);		// // //
 	virtual void ResetChannel();
+	void	SerializeState(CStateArchive &ar) override;		// // //
 
 protected:
 	void	HandleNoteData(ft0cc::doc::pattern_note &pNoteData) override;		// // //
@@ -55,6 +56,7 @@ class C2A03Square : public CChannelHandler2A03 {
 public:
 	explicit C2A03Square(stChannelID ch);		// // //
 	void	RefreshChannel() override;
+	void	SerializeState(CStateArchive &ar) override;		// // //
 protected:
 	int		ConvertDuty(int Duty) const override;		// // //
 	void	ClearRegisters() override;
@@ -77,6 +79,7 @@ public:
 	explicit CTriangleChan(stChannelID ch);		// // //
 	void	RefreshChannel() override;
 	void	ResetChannel() override;		// // //
+	void	SerializeState(CStateArchive &ar) override;		// // //
 	int		GetChannelVolume() const override;		// // //
 protected:
 	bool	HandleEffect(ft0cc::doc::effect_command cmd) override;		// // //
@@ -112,6 +115,7 @@ class CDPCMChan : public CChannelHandler, public CChannelHandlerInterfaceDPCM {
 public:
 	explicit CDPCMChan(stChannelID ch);		// // //
 	void	RefreshChannel() override;
+	void	SerializeState(CStateArchive &ar) override;		// // //
 	int		GetChannelVolume() const override;		// // //
 
 	void	WriteDCOffset(unsigned char Delta) override;		// // //
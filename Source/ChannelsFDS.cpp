@@ -32,6 +32,7 @@
 #include "FamiTrackerEnv.h"		// // //
 #include "Settings.h"		// // //
 #include "SongState.h"		// // //
+#include "StateArchive.h"		// // //
 
 CChannelHandlerFDS::CChannelHandlerFDS(stChannelID ch) :		// // //
 	CChannelHandlerInverted(ch, 0xFFF, 32)
@@ -211,6 +212,14 @@ void CChannelHandlerFDS::RefreshChannel()
 
 }
 
+void CChannelHandlerFDS::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandler::SerializeState(ar);
+	ar(m_iModulationSpeed, m_iModulationDepth, m_iModulationDelay, m_iWaveTable, m_iModTable);
+	ar(m_iVolModMode, m_iVolModRate, m_bVolModTrigger, m_bAutoModulation, m_iModulationOffset);
+	ar(m_iEffModDepth, m_iEffModSpeedHi, m_iEffModSpeedLo);
+}
+
 void CChannelHandlerFDS::ClearRegisters()
 {
 	// Clear volume
@@ -30,6 +30,7 @@ class CChannelHandlerFDS : public CChannelHandlerInverted, public CChannelHandle
 public:
 	explicit CChannelHandlerFDS(stChannelID ch);		// // //
 	void	RefreshChannel() override;
+	void	SerializeState(CStateArchive &ar) override;		// // //
 protected:
 	void	HandleNoteData(ft0cc::doc::pattern_note &pNoteData) override;		// // //
 	bool	HandleEffect(ft0cc::doc::effect_command cmd) override;		// // //
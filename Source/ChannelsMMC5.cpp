@@ -29,6 +29,7 @@
 #include "InstHandler.h"		// // //
 #include "SeqInstHandler.h"		// // //
 #include "SongState.h"		// // //
+#include "StateArchive.h"		// // //
 
 CChannelHandlerMMC5::CChannelHandlerMMC5(stChannelID ch) : CChannelHandler(ch, 0x7FF, 0x0F)		// // //
 {
@@ -111,6 +112,12 @@ void CChannelHandlerMMC5::ResetChannel()
 	m_iLengthCounter = 1;
 }
 
+void CChannelHandlerMMC5::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandler::SerializeState(ar);
+	ar(m_bHardwareEnvelope, m_bEnvelopeLoop, m_bResetEnvelope, m_iLengthCounter, m_iLastPeriod);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 // // // MMC5 Channels
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
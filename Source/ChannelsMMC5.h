@@ -34,6 +34,7 @@ public:
 	explicit CChannelHandlerMMC5(stChannelID ch);		// // //
 	void	ResetChannel() override;
 	void	RefreshChannel() override;
+	void	SerializeState(CStateArchive &ar) override;		// // //
 
 protected:
 	void	HandleNoteData(ft0cc::doc::pattern_note &pNoteData) override;		// // //
@@ -29,6 +29,7 @@
 #include "SeqInstHandler.h"		// // //
 #include "SeqInstHandlerN163.h"		// // //
 #include "SongState.h"		// // //
+#include "StateArchive.h"		// // //
 #include "FamiTrackerModule.h"		// // //
 #include "Assertion.h"		// // //
 
@@ -53,6 +54,12 @@ void CChannelHandlerN163::ResetChannel()
 	m_bLoadWave = false;
 }
 
+void CChannelHandlerN163::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandler::SerializeState(ar);
+	ar(m_bLoadWave, m_bDisableLoad, m_iChannels, m_iWaveLen, m_iWavePos, m_iWavePosOld, m_iWaveCount, m_bResetPhase);
+}
+
 void CChannelHandlerN163::ConfigureDocument(const CFamiTrackerModule &modfile) {		// // //
 	CChannelHandler::ConfigureDocument(modfile);
 	SetChannelCount(modfile.GetNamcoChannels());
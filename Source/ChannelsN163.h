@@ -34,6 +34,7 @@ public:
 	explicit CChannelHandlerN163(stChannelID ch);		// // //
 	void	RefreshChannel() override;
 	void	ResetChannel() override;
+	void	SerializeState(CStateArchive &ar) override;		// // //
 
 	void	SetWaveLength(int Length) override;		// // //
 	void	SetWavePosition(int Pos) override;
@@ -30,6 +30,7 @@
 #include "InstHandler.h"		// // //
 #include "SeqInstHandlerS5B.h"		// // //
 #include "SongState.h"		// // //
+#include "StateArchive.h"		// // //
 
 // Class functions
 
@@ -139,6 +140,12 @@ void CChannelHandlerS5B::ResetChannel()
 	m_iAutoEnvelopeShift = 0;
 }
 
+void CChannelHandlerS5B::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandler::SerializeState(ar);
+	ar(m_bEnvelopeEnabled, m_iAutoEnvelopeShift, m_bUpdate);
+}
+
 int CChannelHandlerS5B::CalculateVolume() const		// // //
 {
 	return LimitVolume((m_iVolume >> VOL_COLUMN_SHIFT) + m_iInstVolume - 15 - GetTremolo());
@@ -36,6 +36,7 @@ public:
 	CChannelHandlerS5B(stChannelID ch, CChipHandlerS5B &parent);		// / //
 	void	ResetChannel() override;
 	void	RefreshChannel() override;
+	void	SerializeState(CStateArchive &ar) override;		// // //
 
 	void	SetNoiseFreq(int Pitch) override final;		// // //
 
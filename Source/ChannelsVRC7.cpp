@@ -29,6 +29,7 @@
 #include "InstHandler.h"		// // //
 #include "InstHandlerVRC7.h"		// // //
 #include "ChipHandlerVRC7.h"		// // //
+#include "StateArchive.h"		// // //
 
 namespace {
 
@@ -297,6 +298,12 @@ void CChannelHandlerVRC7::RefreshChannel()
 	RegWrite(0x20 + subindex, ((Fnum >> 8) & 1) | (Bnum << 1) | Cmd);
 }
 
+void CChannelHandlerVRC7::SerializeState(CStateArchive &ar)		// // //
+{
+	CChannelHandlerInverted::SerializeState(ar);
+	ar(m_iTriggeredNote, m_iOctave, m_iOldOctave, m_iCustomPort, m_iCommand, m_iPatch, m_bHold);
+}
+
 void CChannelHandlerVRC7::ClearRegisters()
 {
 	unsigned subindex = GetChannelID().Subindex;		// // //
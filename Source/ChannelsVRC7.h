@@ -43,6 +43,7 @@ class CChipHandlerVRC7;		// // //
 class CChannelHandlerVRC7 : public CChannelHandlerInverted, public CChannelHandlerInterfaceVRC7 {		// // //
 public:
 	CChannelHandlerVRC7(stChannelID ch, CChipHandlerVRC7 &parent);		// // //
+	void	SerializeState(CStateArchive &ar) override;		// // //
 
 	void	SetPatch(unsigned char Patch);		// // //
 	void	SetCustomReg(size_t Index, unsigned char Val);		// // //
@@ -22,6 +22,7 @@
 
 #include "ChipHandler.h"
 #include "ChannelHandler.h"
+#include "StateArchive.h"
 
 CChipHandler::~CChipHandler() noexcept {
 }
@@ -35,6 +36,11 @@ void CChipHandler::RefreshBefore(CAPUInterface &) {
 void CChipHandler::RefreshAfter(CAPUInterface &) {
 }
 
+void CChipHandler::SerializeState(CStateArchive &ar) {
+	for (auto &ch : channels_)
+		ch->SerializeState(ar);
+}
+
 void CChipHandler::AddChannelHandler(std::unique_ptr<CChannelHandler> ch) {
 	channels_.push_back(std::move(ch));
 }
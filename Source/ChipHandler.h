@@ -25,9 +25,11 @@
 
 #include <vector>
 #include <memory>
+#include <utility>
 
 class CChannelHandler;
 class CAPUInterface;
+class CStateArchive;
 
 // // // handler for sound chip instance
 
@@ -45,6 +47,8 @@ public:
 	virtual void ResetChip(CAPUInterface &apu);
 	virtual void RefreshBefore(CAPUInterface &apu);
 	virtual void RefreshAfter(CAPUInterface &apu);
+	// Saves or loads the runtime state of the chip handler and its channel handlers
+	virtual void SerializeState(CStateArchive &ar);
 
 	void AddChannelHandler(std::unique_ptr<CChannelHandler> ch);
 
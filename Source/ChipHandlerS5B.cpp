@@ -23,6 +23,7 @@
 #include "ChipHandlerS5B.h"
 #include "APU/APUInterface.h"
 #include "SongState.h"
+#include "StateArchive.h"
 #include "ft0cc/doc/pattern_note.hpp" // ft0cc::doc::effect_command
 
 void CChipHandlerS5B::SetChannelOutput(unsigned Subindex, int Square, int Noise) {
@@ -108,6 +109,11 @@ void CChipHandlerS5B::RefreshAfter(CAPUInterface &apu) {
 	m_bEnvTrigger = false;
 }
 
+void CChipHandlerS5B::SerializeState(CStateArchive &ar) {
+	CChipHandler::SerializeState(ar);
+	ar(m_iNoiseFreq, m_iNoisePrev, m_iDefaultNoise, m_iEnvFreq, m_iModes, m_bEnvTrigger, m_iEnvType, m_i5808B4);
+}
+
 void CChipHandlerS5B::WriteReg(CAPUInterface &apu, uint8_t adr, uint8_t val) const {
 	apu.Write(0xC000, adr);
 	apu.Write(0xE000, val);
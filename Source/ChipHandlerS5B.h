@@ -45,6 +45,7 @@ public:
 private:
 	void ResetChip(CAPUInterface &apu) override;
 	void RefreshAfter(CAPUInterface &apu) override;
+	void SerializeState(CStateArchive &ar) override;
 
 	void WriteReg(CAPUInterface &apu, uint8_t adr, uint8_t val) const;
 
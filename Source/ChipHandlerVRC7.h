@@ -36,6 +36,7 @@ public:
 private:
 	void ResetChip(CAPUInterface &apu) override;
 	void RefreshAfter(CAPUInterface &apu) override;
+	void SerializeState(CStateArchive &ar) override;
 
 	// Custom instrument patch
 	std::array<uint8_t, 8> patch_ = { };		// // // 050B
@@ -28,13 +28,16 @@
  *
  */
 
-CChunk::CChunk(const stChunkLabel &label) : m_stChunkLabel(label)		// // //
+CChunk::CChunk(const stChunkLabel &label, std::pmr::memory_resource *pArena) :		// // //
+	m_vBytes(pArena), m_vItems(pArena), m_vReferences(pArena), m_stChunkLabel(label)
 {
 }
 
 void CChunk::Clear()
 {
-	m_vChunkData.clear();
+	m_vBytes.clear();		// // //
+	m_vItems.clear();
+	m_vReferences.clear();
 }
 
 chunk_type_t CChunk::GetType() const
@@ -60,116 +63,128 @@ unsigned char CChunk::GetBank() const
 int CChunk::GetLength() const
 {
 	// Return number of data items in the collection
-	return m_vChunkData.size();
+	return m_vItems.size();		// // //
 }
 
 unsigned short CChunk::GetData(int index) const
 {
-	return m_vChunkData[index]->GetData();
+	const auto &item = m_vItems[index];		// // //
+	switch (item.Type) {
+	case chunk_data_t::Byte: case chunk_data_t::Bank:
+		return m_vBytes[item.Offset];
+	case chunk_data_t::Word: case chunk_data_t::Pointer:
+		return m_vBytes[item.Offset] | (m_vBytes[item.Offset + 1] << 8);
+	case chunk_data_t::String:
+		break;
+	}
+	return 0;	// Invalid for strings
 }
 
 unsigned short CChunk::GetDataSize(int index) const
 {
-	return m_vChunkData[index]->GetSize();
+	std::size_t next = index + 1 < GetLength() ? m_vItems[index + 1].Offset : m_vBytes.size();		// // //
+	return static_cast<unsigned short>(next - m_vItems[index].Offset);
+}
+
+array_view<const unsigned char> CChunk::GetBytes() const		// // //
+{
+	return m_vBytes;
 }
 
 void CChunk::StoreByte(unsigned char data)
 {
-	DoAddChunk<CChunkDataByte>(data);		// // //
+	AddItem(chunk_data_t::Byte, 1);		// // //
+	m_vBytes.back() = data;
 }
 
 void CChunk::StoreWord(unsigned short data)
 {
-	DoAddChunk<CChunkDataWord>(data);		// // //
+	AddItem(chunk_data_t::Word, 2);		// // //
+	PutWord(m_vItems.back().Offset, data);
 }
 
 void CChunk::StorePointer(const stChunkLabel &label)		// // //
 {
-	DoAddChunk<CChunkDataPointer>(label);
+	AddItem(chunk_data_t::Pointer, 2, m_vReferences.size());
+	PutWord(m_vItems.back().Offset, 0xFFFF);
+	m_vReferences.push_back(label);
 }
 
 void CChunk::StoreBankReference(const stChunkLabel &label, int bank)		// // //
 {
-	DoAddChunk<CChunkDataBank>(label, bank);
+	AddItem(chunk_data_t::Bank, 1, m_vReferences.size());
+	m_vBytes.back() = static_cast<unsigned char>(bank);
+	m_vReferences.push_back(label);
 }
 
-void CChunk::StoreString(const std::vector<unsigned char> &data)		// // //
+void CChunk::StoreString(array_view<const unsigned char> data)		// // //
 {
-	DoAddChunk<CChunkDataString>(data);		// // //
+	m_vItems.push_back({static_cast<unsigned>(m_vBytes.size()), 0u, chunk_data_t::String});
+	m_vBytes.insert(m_vBytes.end(), data.begin(), data.end());
 }
 
 void CChunk::ChangeByte(int index, unsigned char data)
 {
-	GetChunkData<CChunkDataByte>(index).m_data = data;		// // //
+	Assert(m_vItems[index].Type == chunk_data_t::Byte);		// // //
+	m_vBytes[m_vItems[index].Offset] = data;
 }
 
 void CChunk::SetupBankData(int index, unsigned char bank)
 {
-	GetChunkData<CChunkDataBank>(index).m_bank = bank;
-}
-
-unsigned char CChunk::GetStringData(int index, int pos) const
-{
-	return GetChunkData<const CChunkDataString>(index).m_vData[pos];
+	Assert(m_vItems[index].Type == chunk_data_t::Bank);		// // //
+	m_vBytes[m_vItems[index].Offset] = bank;
 }
 
-const std::vector<unsigned char> &CChunk::GetStringData(int index) const
+array_view<const unsigned char> CChunk::GetStringData(int index) const		// // //
 {
-	return GetChunkData<const CChunkDataString>(index).m_vData;
+	Assert(m_vItems[index].Type == chunk_data_t::String);
+	return {m_vBytes.data() + m_vItems[index].Offset, GetDataSize(index)};
 }
 
 stChunkLabel CChunk::GetDataPointerTarget(int index) const		// // //
 {
-	auto pChunkData = dynamic_cast<CChunkDataPointer *>(m_vChunkData[index].get());
-	return pChunkData ? pChunkData->m_Label : stChunkLabel { };
+	return IsDataPointer(index) ? m_vReferences[m_vItems[index].Reference] : stChunkLabel { };
 }
 
 void CChunk::SetDataPointerTarget(int index, const stChunkLabel &label)		// // //
 {
-	if (auto pChunkData = dynamic_cast<CChunkDataPointer *>(m_vChunkData[index].get()))
-		pChunkData->m_Label = label;
+	if (IsDataPointer(index))
+		m_vReferences[m_vItems[index].Reference] = label;
 }
 
 bool CChunk::IsDataPointer(int index) const
 {
-	return dynamic_cast<CChunkDataPointer *>(m_vChunkData[index].get()) != nullptr;
+	return m_vItems[index].Type == chunk_data_t::Pointer;		// // //
 }
 
 bool CChunk::IsDataBank(int index) const
 {
-	return dynamic_cast<CChunkDataBank *>(m_vChunkData[index].get()) != nullptr;
+	return m_vItems[index].Type == chunk_data_t::Bank;		// // //
 }
 
 unsigned int CChunk::CountDataSize() const
 {
-	return m_iTotalSize;		// // //
+	return m_vBytes.size();		// // //
 }
 
-void CChunk::AssignLabels(std::map<stChunkLabel, int> &labelMap)		// // //
+void CChunk::AssignLabels(const std::map<stChunkLabel, int> &labelMap)		// // //
 {
-	for (auto &x : m_vChunkData)
-		if (auto pChunkData = dynamic_cast<CChunkDataPointer *>(x.get())) {
-			if (auto it = labelMap.find(pChunkData->m_Label); it != labelMap.end())		// // //
-				pChunkData->ref = it->second;
+	for (const auto &item : m_vItems)
+		if (item.Type == chunk_data_t::Pointer) {
+			if (auto it = labelMap.find(m_vReferences[item.Reference]); it != labelMap.end())		// // //
+				PutWord(item.Offset, static_cast<unsigned short>(it->second));
 			else
 				DEBUG_BREAK();
 		}
 }
 
 // // //
-template <typename T>
-T &CChunk::GetChunkData(std::size_t index) const {
-#ifdef _DEBUG		// // //
-	return dynamic_cast<T &>(*m_vChunkData.at(index));
-#else
-	return static_cast<T &>(*m_vChunkData[index]);
-#endif
-}
-
-template <typename T, typename... Args>
-void CChunk::DoAddChunk(Args&&... args) {
-	if (auto ptr = std::make_unique<T>(std::forward<Args>(args)...)) {
-		m_iTotalSize += ptr->GetSize();
-		m_vChunkData.push_back(std::move(ptr));
-	}
+void CChunk::AddItem(chunk_data_t Type, std::size_t Size, unsigned Reference) {
+	m_vItems.push_back({static_cast<unsigned>(m_vBytes.size()), Reference, Type});
+	m_vBytes.resize(m_vBytes.size() + Size);
+}
+
+void CChunk::PutWord(unsigned Offset, unsigned short data) {
+	m_vBytes[Offset] = data & 0xFF;
+	m_vBytes[Offset + 1] = data >> 8;
 }
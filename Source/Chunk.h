@@ -24,8 +24,10 @@
 #pragma once
 
 #include <vector>		// // //
-#include <memory>		// // //
+#include <memory_resource>		// // //
 #include <map>		// // //
+#include <cstdint>		// // //
+#include "ft0cc/cpputil/array_view.hpp"		// // //
 
 // Helper classes/objects for NSF compiling
 
@@ -72,77 +74,28 @@ struct stChunkLabel {
 	}
 };
 
-class CChunkData
-{
-protected:		// // //
-	CChunkData() = default;
-
-public:
-	virtual ~CChunkData() = default;
-	virtual int GetSize() const = 0;
-	virtual unsigned short GetData() const = 0;
-};
-
-class CChunkDataByte : public CChunkData
-{
-public:
-	CChunkDataByte(unsigned char data) : CChunkData(), m_data(data) { }
-	int GetSize() const override { return 1; }
-
-	unsigned short GetData() const override { return m_data; }
-	unsigned char m_data;
-};
-
-class CChunkDataWord : public CChunkData
-{
-public:
-	CChunkDataWord(unsigned short data) : CChunkData(), m_data(data) { }
-	int GetSize() const override { return 2; }
-
-	unsigned short GetData() const override { return m_data; }
-	unsigned short m_data;
-};
-
-class CChunkDataPointer : public CChunkData
-{
-public:
-	CChunkDataPointer(const stChunkLabel &label) : CChunkData(), m_Label(label) { }		// // //
-	int GetSize() const override { return 2; }
-	unsigned short GetData() const override { return ref; }
-
-	stChunkLabel m_Label;
-	unsigned short ref = 0xFFFF;
-};
-
-class CChunkDataBank : public CChunkData
-{
-public:
-	CChunkDataBank(const stChunkLabel &label, int bank) : CChunkData(), m_Label(label), m_bank(bank) { }		// // //
-	int GetSize() const override { return 1; }
-	unsigned short GetData() const override { return m_bank; }
-
-	stChunkLabel m_Label;		// // // Reference to a label which belongs to the bank this data should point to
-	unsigned int m_bank;
-};
-
-class CChunkDataString : public CChunkData
-{
-public:
-	CChunkDataString(const std::vector<unsigned char> &data) : CChunkData(), m_vData(data) { }
-	int GetSize() const override { return m_vData.size(); }
-	unsigned short GetData() const override { return 0; }	// Invalid for this type
-
-	std::vector<unsigned char> m_vData;		// // //
+// // // Kinds of data items stored in a chunk
+enum class chunk_data_t : std::uint8_t {
+	Byte,
+	Word,
+	Pointer,		// word address of a label, resolved by CChunk::AssignLabels
+	Bank,		// byte bank number of a label, resolved by CChunk::SetupBankData
+	String,
 };
 
 //
 // Chunk class
 //
 
+// // // Data items are packed into a single little-endian byte buffer; labels
+// referenced by pointers and bank numbers are kept in a side table and patched
+// into the buffer in place. All storage comes from the given memory resource,
+// which the compiler provides as a per-export arena.
 class CChunk
 {
 public:
-	explicit CChunk(const stChunkLabel &label);		// // //
+	explicit CChunk(const stChunkLabel &label,
+		std::pmr::memory_resource *pArena = std::pmr::get_default_resource());		// // //
 
 	void			Clear();
 
@@ -155,12 +108,13 @@ public:
 	unsigned short	GetData(int index) const;
 	unsigned short	GetDataSize(int index) const;
 	unsigned int	CountDataSize() const;
+	array_view<const unsigned char> GetBytes() const;		// // //
 
 	void			StoreByte(unsigned char data);
 	void			StoreWord(unsigned short data);
 	void			StorePointer(const stChunkLabel &label);		// // //
 	void			StoreBankReference(const stChunkLabel &label, int bank);		// // //
-	void			StoreString(const std::vector<unsigned char> &data);		// // //
+	void			StoreString(array_view<const unsigned char> data);		// // //
 
 	void			ChangeByte(int index, unsigned char data);
 	void			SetupBankData(int index, unsigned char bank);
@@ -171,20 +125,24 @@ public:
 	bool			IsDataPointer(int index) const;
 	bool			IsDataBank(int index) const;
 
-	unsigned char	GetStringData(int index, int pos) const;
-	const std::vector<unsigned char> &GetStringData(int index) const;
+	array_view<const unsigned char> GetStringData(int index) const;		// // //
 
-	void			AssignLabels(std::map<stChunkLabel, int> &labelMap);		// // //
+	void			AssignLabels(const std::map<stChunkLabel, int> &labelMap);		// // //
 
 private:
-	template <typename T>		// // //
-	T &GetChunkData(std::size_t index) const;
-	template <typename T, typename... Args>
-	void DoAddChunk(Args&&... args);
+	struct stChunkItem {		// // //
+		unsigned Offset;		// Position in the byte buffer
+		unsigned Reference;		// Index into the label reference table
+		chunk_data_t Type;
+	};
+
+	void AddItem(chunk_data_t Type, std::size_t Size, unsigned Reference = 0u);		// // //
+	void PutWord(unsigned Offset, unsigned short data);
 
-	std::vector<std::unique_ptr<CChunkData>> m_vChunkData;		// // // List of data stored in this chunk
+	std::pmr::vector<unsigned char> m_vBytes;		// // // Flat chunk data
+	std::pmr::vector<stChunkItem> m_vItems;		// // // Item boundaries within m_vBytes
+	std::pmr::vector<stChunkLabel> m_vReferences;		// // // Labels referenced by pointer and bank items
 
 	stChunkLabel m_stChunkLabel;		// // // Label of this chunk
 	unsigned char m_iBank = 0;		// The bank this chunk will be stored in
-	unsigned m_iTotalSize = 0;		// // // cache
 };
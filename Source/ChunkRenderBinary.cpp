@@ -72,15 +72,7 @@ void CChunkRenderBinary::StoreSamples(const std::vector<std::shared_ptr<const ft
 
 void CChunkRenderBinary::StoreChunk(const CChunk &Chunk)		// // //
 {
-	for (int i = 0, n = Chunk.GetLength(); i < n; ++i) {
-		if (Chunk.GetType() == CHUNK_PATTERN)
-			Store(Chunk.GetStringData(CCompiler::PATTERN_CHUNK_INDEX));
-		else {
-			unsigned short data = Chunk.GetData(i);
-			unsigned short size = Chunk.GetDataSize(i);
-			Store({reinterpret_cast<const std::uint8_t *>(&data), size});
-		}
-	}
+	Store(Chunk.GetBytes());		// // //
 }
 
 void CChunkRenderBinary::StoreSample(const ft0cc::doc::dpcm_sample &DSample)
@@ -200,15 +192,7 @@ void CChunkRenderNSF::StoreChunkBankswitched(const CChunk &Chunk)		// // //
 
 void CChunkRenderNSF::StoreChunk(const CChunk &Chunk)		// // //
 {
-	for (int i = 0, n = Chunk.GetLength(); i < n; ++i) {
-		if (Chunk.GetType() == CHUNK_PATTERN)
-			Store(Chunk.GetStringData(CCompiler::PATTERN_CHUNK_INDEX));
-		else {
-			unsigned short data = Chunk.GetData(i);
-			unsigned short size = Chunk.GetDataSize(i);
-			Store({reinterpret_cast<const std::uint8_t *>(&data), size});
-		}
-	}
+	Store(Chunk.GetBytes());		// // //
 }
 
 int CChunkRenderNSF::GetRemainingSize() const
@@ -386,7 +386,7 @@ void CChunkRenderText::StorePatternChunk(const CChunk *pChunk)
 	std::string str = "; Bank " + conv::from_uint(pChunk->GetBank()) + "\n";
 	str += GetLabelString(pChunk->GetLabel()) + ":\n";
 
-	const std::vector<unsigned char> &vec = pChunk->GetStringData(0);		// // //
+	auto vec = pChunk->GetStringData(0);		// // //
 	str += GetByteString(vec, DEFAULT_LINE_BREAK).data();
 /*
 	len = vec.size();
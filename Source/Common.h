@@ -25,6 +25,7 @@
 
 #include <cstdint>
 #include "ft0cc/cpputil/array_view.hpp"		// // //
+#include "APU/Types_fwd.h"		// // //
 
 enum class decay_rate_t {		// // // 050B
 	Slow,
@@ -43,3 +44,9 @@ public:
 	virtual void FlushBuffer(array_view<const int16_t> Buffer) = 0;		// // //
 	virtual bool PlayBuffer() = 0;		// // // return true if succeeded
 };
+
+// // // Receives the output of individual channels rendered alongside the main mix
+class IStemCallback {
+public:
+	virtual void FlushStemBuffer(stChannelID Channel, array_view<const int16_t> Buffer) = 0;
+};
@@ -49,6 +49,10 @@
 #include "SoundChipService.h"		// // //
 #include "BinaryStream.h"		// // //
 #include "Assertion.h"		// // //
+#include <thread>		// // //
+#include <atomic>		// // //
+#include <mutex>		// // //
+#include <exception>		// // //
 
 //
 // This is the new NSF data compiler, music is compiled to an object list instead of a binary chunk
@@ -58,11 +62,9 @@
 
 /*
  * TODO:
- *  - Remove duplicated FDS waves
  *  - Remove the bank value in CHUNK_SONG??
  *  - Derive classes for each output format instead of separate functions
  *  - Create a config file for NSF driver optimizations
- *  - Pattern hash collisions prevents detecting similar patterns, fix that
  *  - Add bankswitching schemes for other memory mappers
  *
  */
@@ -208,6 +210,23 @@ std::size_t NSFEWriteBlocks(CBinaryWriter &file, const CFamiTrackerModule &modfi
 	return iDataSizePos;
 }
 
+// // // collects messages from one pattern compiler so that they can be printed in pattern order
+class CPatternCompilerLog : public CCompilerLog {
+public:
+	void WriteLog(std::string_view text) override {
+		log_ += text;
+	}
+	void Clear() override {
+		log_.clear();
+	}
+	std::string Release() {
+		return std::exchange(log_, std::string { });
+	}
+
+private:
+	std::string log_;
+};
+
 } // namespace
 
 void CCompiler::ExportNSF_NSFE(CBinaryWriter &file, int MachineType, bool isNSFE) {
@@ -450,6 +469,10 @@ void CCompiler::SetMetadata(std::string_view title, std::string_view artist, std
 	copyright_ = conv::utf8_trim(copyright.substr(0, CFamiTrackerModule::METADATA_FIELD_LENGTH - 1));
 }
 
+void CCompiler::SetThreadCount(unsigned count) {		// // //
+	m_iThreadCount = count;
+}
+
 std::vector<unsigned char> CCompiler::LoadDriver(const driver_t &Driver, unsigned short Origin) const {		// // //
 	// Copy embedded driver
 	std::vector<unsigned char> Data(Driver.driver.begin(), Driver.driver.end());
@@ -612,7 +635,7 @@ void CCompiler::UpdateSamplePointers(unsigned int Origin)
 {
 	// Rewrite sample pointer list with valid addresses
 	//
-	// TODO: rewrite this to utilize the CChunkDataBank to resolve bank numbers automatically
+	// TODO: rewrite this to utilize bank references to resolve bank numbers automatically
 	//
 
 	Assert(m_pSamplePointersChunk != NULL);
@@ -805,7 +828,7 @@ bool CCompiler::CollectLabelsBankswitched(std::map<stChunkLabel, int> &labelMap)
 	return true;
 }
 
-void CCompiler::AssignLabels(std::map<stChunkLabel, int> &labelMap)		// // //
+void CCompiler::AssignLabels(const std::map<stChunkLabel, int> &labelMap)		// // //
 {
 	// Pass 2: assign addresses to labels
 	for (auto &pChunk : m_vChunks)
@@ -1056,19 +1079,21 @@ void CCompiler::CreateSequenceList()
 	// Create sequence lists
 	//
 
-	unsigned int Size = 0, StoredCount = 0;
+	unsigned int Size = 0, StoredCount = 0, UniqueCount = 0;		// // //
 	const inst_type_t inst[] = {INST_2A03, INST_VRC6, INST_N163, INST_S5B};
 	decltype(m_bSequencesUsed2A03) *used[] = {&m_bSequencesUsed2A03, &m_bSequencesUsedVRC6, &m_bSequencesUsedN163, &m_bSequencesUsedS5B};
 
 	auto &Im = *m_pModule->GetInstrumentManager();
 
 	// TODO: use the CSeqInstrument::GetSequence
-	// TODO: merge identical sequences from all chips
 	for (size_t c = 0; c < std::size(inst); ++c) {
 		for (int i = 0; i < MAX_SEQUENCES; ++i) for (auto j : enum_values<sequence_t>()) {
 			const auto pSeq = Im.GetSequence(inst[c], j, i);
 			if ((*used[c])[i][(unsigned)j] && pSeq->GetItemCount() > 0) {
-				Size += StoreSequence(*pSeq, {CHUNK_SEQUENCE, i * SEQ_COUNT + (unsigned)j, (unsigned)inst[c]});
+				if (int SeqSize = StoreSequence(*pSeq, {CHUNK_SEQUENCE, i * SEQ_COUNT + (unsigned)j, (unsigned)inst[c]})) {		// // //
+					Size += SeqSize;
+					++UniqueCount;
+				}
 				++StoredCount;
 			}
 		}
@@ -1080,7 +1105,10 @@ void CCompiler::CreateSequenceList()
 				const auto pSeq = pInstrument->GetSequence(j);		// // //
 				if (pSeq && pSeq->GetItemCount() > 0) {
 					unsigned Index = i * SEQ_COUNT + (unsigned)j;
-					Size += StoreSequence(*pSeq, {CHUNK_SEQUENCE, Index, INST_FDS});		// // //
+					if (int SeqSize = StoreSequence(*pSeq, {CHUNK_SEQUENCE, Index, INST_FDS})) {		// // //
+						Size += SeqSize;
+						++UniqueCount;
+					}
 					++StoredCount;
 				}
 			}
@@ -1088,11 +1116,13 @@ void CCompiler::CreateSequenceList()
 	}
 
 	Print(" * Sequences used: " + conv::from_int(StoredCount) + " (" + conv::from_int(Size) + " bytes)\n");
+	if (StoredCount > UniqueCount)		// // //
+		Print(" * " + conv::from_int(StoredCount - UniqueCount) + " duplicated sequence(s) removed\n");
 }
 
 int CCompiler::StoreSequence(const CSequence &Seq, const stChunkLabel &label)		// // //
 {
-	CChunk &Chunk = CreateChunk(label);		// // //
+	CChunk Chunk {label, &m_ChunkArena};		// // //
 
 	// Store the sequence
 	int iItemCount	  = Seq.GetItemCount();
@@ -1117,6 +1147,10 @@ int CCompiler::StoreSequence(const CSequence &Seq, const stChunkLabel &label)		/
 		Chunk.StoreByte(Seq.GetItem(i));
 	}
 
+	// // // Identical sequences from all chips are stored only once
+	if (!AddUniqueChunk(std::move(Chunk)))
+		return 0;
+
 	// Return size of this chunk
 	return iItemCount + 4;
 }
@@ -1134,7 +1168,6 @@ void CCompiler::CreateInstrumentList()
 
 	unsigned int iTotalSize = 0;
 	CChunk *pWavetableChunk = NULL;	// FDS
-	CChunk *pWavesChunk = NULL;		// N163
 	int iWaveSize = 0;				// N163 waves size
 
 	CChunk &InstListChunk = CreateChunk({CHUNK_INSTRUMENT_LIST});		// // //
@@ -1144,29 +1177,17 @@ void CCompiler::CreateInstrumentList()
 	if (m_pModule->HasExpansionChip(sound_chip_t::FDS) || m_pModule->GetSoundChipSet().IsMultiChip())
 		pWavetableChunk = &CreateChunk({CHUNK_WAVETABLE});		// // //
 
-	m_iWaveBanks.fill(-1);		// // //
-
 	// Collect N163 waves
 	const CInstCompilerN163 n163_c;		// // //
-	for (unsigned int i = 0; i < m_iAssignedInstruments.size(); ++i) {
-		unsigned iIndex = m_iAssignedInstruments[i];
-		if (Im.GetInstrumentType(iIndex) == INST_N163 && m_iWaveBanks[i] == (unsigned)-1) {
+	for (unsigned iIndex : m_iAssignedInstruments)
+		if (Im.GetInstrumentType(iIndex) == INST_N163) {
+			// // // Instruments with identical wave data share one chunk
 			auto pInstrument = std::static_pointer_cast<CInstrumentN163>(Im.GetInstrument(iIndex));
-			for (unsigned int j = i + 1; j < m_iAssignedInstruments.size(); ++j) {
-				unsigned inst = m_iAssignedInstruments[j];
-				if (Im.GetInstrumentType(inst) == INST_N163 && m_iWaveBanks[j] == (unsigned)-1) {
-					auto pNewInst = std::static_pointer_cast<CInstrumentN163>(Im.GetInstrument(inst));
-					if (pInstrument->IsWaveEqual(*pNewInst))
-						m_iWaveBanks[j] = iIndex;
-				}
-			}
-			if (m_iWaveBanks[i] == (unsigned)-1) {
-				m_iWaveBanks[i] = iIndex;
-				pWavesChunk = &CreateChunk({CHUNK_WAVES, iIndex});		// // //
-				n163_c.StoreWaves(*pInstrument, *pWavesChunk);		// // //
-			}
+			CChunk WavesChunk {{CHUNK_WAVES, iIndex}, &m_ChunkArena};
+			int Size = n163_c.StoreWaves(*pInstrument, WavesChunk);
+			if (AddUniqueChunk(std::move(WavesChunk)))
+				iWaveSize += Size;
 		}
-	}
 
 	// Store instruments
 	for (unsigned int i = 0; i < m_iAssignedInstruments.size(); ++i) {
@@ -1183,20 +1204,17 @@ void CCompiler::CreateInstrumentList()
 		}
 */
 
-		if (pInstrument->GetType() == INST_N163) {
-			// Translate wave index
-			iIndex = m_iWaveBanks[i];
-		}
-
 		// Returns number of bytes
 		const auto &compiler = FTEnv.GetInstrumentService()->GetChunkCompiler(pInstrument->GetType());		// // //
 		iTotalSize += compiler.CompileChunk(*pInstrument, Chunk, iIndex);
 
+		// // // Point to shared sequences and waves
+		RedirectDuplicates(Chunk);
+
 		// // // Check if FDS
 		if (pInstrument->GetType() == INST_FDS && pWavetableChunk != NULL) {
 			// Store wave
-			AddWavetable(std::static_pointer_cast<CInstrumentFDS>(pInstrument).get(), pWavetableChunk);
-			Chunk.StoreByte(m_iWaveTables - 1);
+			Chunk.StoreByte(AddWavetable(static_cast<const CInstrumentFDS &>(*pInstrument), *pWavetableChunk));
 		}
 	}
 
@@ -1481,72 +1499,113 @@ void CCompiler::StorePatterns(unsigned int Track)
 	 *
 	 */
 
-	CPatternCompiler PatternCompiler(*m_pModule, m_iAssignedInstruments, (const DPCM_List_t *)m_iSamplesLookUp.data(), m_pLogger);		// // //
+	struct stCompiledPattern {		// // //
+		unsigned Pattern;
+		stChannelID Channel;
+		std::uint64_t Hash = 0u;
+		std::vector<unsigned char> Data;
+		std::string Log;
+	};
+
+	// Find all used patterns
+	std::vector<stCompiledPattern> Patterns;		// // //
+	for (unsigned i = 0; i < MAX_PATTERN; ++i)
+		m_ChannelOrder.ForeachChannel([&] (stChannelID j) {
+			if (IsPatternAddressed(Track, i, j))
+				Patterns.push_back({i, j, 0u, { }, { }});
+		});
+
+	// // // Compile pattern data on all hardware threads unless limited, patterns are independent of each other
+	std::atomic<std::size_t> NextPattern {0u};
+	std::exception_ptr pException;
+	std::mutex ExceptionLock;
+
+	const auto CompilePatterns = [&] {
+		try {
+			auto pLog = std::make_shared<CPatternCompilerLog>();
+			CPatternCompiler PatternCompiler(*m_pModule, m_iAssignedInstruments, (const DPCM_List_t *)m_iSamplesLookUp.data(), m_pLogger ? pLog : nullptr);
+			for (std::size_t i; (i = NextPattern++) < Patterns.size(); ) {
+				auto &pattern = Patterns[i];
+				PatternCompiler.CompileData(Track, pattern.Pattern, pattern.Channel);
+				pattern.Hash = PatternCompiler.GetHash();
+				pattern.Data = PatternCompiler.GetData();
+				pattern.Log = pLog->Release();
+			}
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock {ExceptionLock};
+			if (!pException)
+				pException = std::current_exception();
+			NextPattern = Patterns.size();
+		}
+	};
+
+	std::vector<std::thread> Workers;
+	const unsigned MaxThreads = m_iThreadCount ? m_iThreadCount : std::max(std::thread::hardware_concurrency(), 1u);
+	const std::size_t ThreadCount = std::min<std::size_t>(MaxThreads, Patterns.size());
+	for (std::size_t i = 1; i < ThreadCount; ++i)
+		Workers.emplace_back(CompilePatterns);
+	CompilePatterns();
+	for (auto &th : Workers)
+		th.join();
+	if (pException)
+		std::rethrow_exception(pException);
 
 	int PatternCount = 0;
 	int PatternSize = 0;
 
-	// Iterate through all patterns
-	for (unsigned i = 0; i < MAX_PATTERN; ++i) {
-		m_ChannelOrder.ForeachChannel([&] (stChannelID j) {		// // //
-			// And store only used ones
-			if (IsPatternAddressed(Track, i, j)) {
+	// Store patterns in the same order as they were found
+	for (const auto &pattern : Patterns) {		// // //
+		if (!pattern.Log.empty())
+			Print(pattern.Log);
 
-				// Compile pattern data
-				PatternCompiler.CompileData(Track, i, j);
+		auto label = stChunkLabel {CHUNK_PATTERN, Track, pattern.Pattern, pattern.Channel.ToInteger()};		// // //
 
-				auto label = stChunkLabel {CHUNK_PATTERN, Track, i, j.ToInteger()};		// // //
-
-				bool StoreNew = true;
+		bool StoreNew = true;
 
 #ifdef REMOVE_DUPLICATE_PATTERNS
-				unsigned int Hash = PatternCompiler.GetHash();
-
-				// Check for duplicate patterns
-				if (auto it = m_PatternMap.find(Hash); it != m_PatternMap.end()) {
-					const CChunk *pDuplicate = it->second;
-					// Hash only indicates that patterns may be equal, check exact data
-					if (PatternCompiler.CompareData(pDuplicate->GetStringData(PATTERN_CHUNK_INDEX))) {
-						// Duplicate was found, store a reference to existing pattern
-						m_DuplicateMap.try_emplace(label, pDuplicate->GetLabel());		// // //
-						++m_iDuplicatePatterns;
-						StoreNew = false;
-					}
-				}
+		// // // Check for duplicate patterns, every pattern with the same hash is kept
+		auto &Bucket = m_PatternMap[pattern.Hash];
+		for (const CChunk *pDuplicate : Bucket)
+			// Hash only indicates that patterns may be equal, check exact data
+			if (pattern.Data == pDuplicate->GetStringData(PATTERN_CHUNK_INDEX)) {
+				// Duplicate was found, store a reference to existing pattern
+				m_DuplicateMap.try_emplace(label, pDuplicate->GetLabel());		// // //
+				++m_iDuplicatePatterns;
+				StoreNew = false;
+				break;
+			}
 #endif /* REMOVE_DUPLICATE_PATTERNS */
 
-				if (StoreNew) {
-					// Store new pattern
-					CChunk &Chunk = CreateChunk(label);		// // //
+		if (StoreNew) {
+			// Store new pattern
+			CChunk &Chunk = CreateChunk(label);		// // //
 
 #ifdef REMOVE_DUPLICATE_PATTERNS
-					if (m_PatternMap.count(Hash))
-						++m_iHashCollisions;
-					m_PatternMap[Hash] = &Chunk;
+			if (!Bucket.empty())
+				++m_iHashCollisions;
+			Bucket.push_back(&Chunk);		// // //
 #endif /* REMOVE_DUPLICATE_PATTERNS */
 
-					// Store pattern data as string
-					Chunk.StoreString(PatternCompiler.GetData());
+			// Store pattern data as string
+			Chunk.StoreString(pattern.Data);
 
-					PatternSize += PatternCompiler.GetDataSize();
-					++PatternCount;
-				}
-			}
-		});
+			PatternSize += pattern.Data.size();
+			++PatternCount;
+		}
 	}
 
 #ifdef REMOVE_DUPLICATE_PATTERNS
 	// Update references to duplicates
 	for (const auto pChunk : m_vFrameChunks)
-		for (int j = 0, n = pChunk->GetLength(); j < n; ++j)
-			if (auto it = m_DuplicateMap.find(pChunk->GetDataPointerTarget(j)); it != m_DuplicateMap.cend())		// // //
-				pChunk->SetDataPointerTarget(j, it->second);
+		if (pChunk->GetLabel().Param1 == Track)		// // // earlier songs are already updated
+			RedirectDuplicates(*pChunk);
 #endif /* REMOVE_DUPLICATE_PATTERNS */
 
 #ifdef LOCAL_DUPLICATE_PATTERN_REMOVAL
 	// Forget patterns when one whole track is stored
-	m_PatternMap.RemoveAll();
-	m_DuplicateMap.RemoveAll();
+	m_PatternMap.clear();		// // //
+	m_DuplicateMap.clear();
 #endif /* LOCAL_DUPLICATE_PATTERN_REMOVAL */
 
 	Print(conv::from_int(PatternCount) + " patterns (" + conv::from_int(PatternSize) + " bytes)\r\n");
@@ -1554,31 +1613,36 @@ void CCompiler::StorePatterns(unsigned int Track)
 
 bool CCompiler::IsPatternAddressed(unsigned int Track, int Pattern, stChannelID Channel) const
 {
-	// Scan the frame list to see if a pattern is accessed for that frame
+	// Check if a pattern is accessed by any frame
 	if (const auto *pSong = m_pModule->GetSong(Track))		// // //
-		if (const auto *pTrack = pSong->GetTrack(Channel))
-			for (int i = 0, n = pSong->GetFrameCount(); i < n; ++i)
-				if (pTrack->GetFramePattern(i) == Pattern)
-					return true;
+		return pSong->IsPatternInUse(Channel, Pattern);
 
 	return false;
 }
 
-void CCompiler::AddWavetable(CInstrumentFDS *pInstrument, CChunk *pChunk)
+unsigned CCompiler::AddWavetable(const CInstrumentFDS &Instrument, CChunk &Chunk)		// // //
 {
-	// TODO Find equal existing waves
+	std::array<unsigned char, 64> Wave;
+	for (int i = 0; i < 64; ++i)
+		Wave[i] = Instrument.GetSample(i);
+
+	// // // Find equal existing waves
+	auto Tables = Chunk.GetBytes();
+	for (unsigned i = 0; i < m_iWaveTables; ++i)
+		if (std::equal(Wave.begin(), Wave.end(), Tables.begin() + i * Wave.size()))
+			return i;
 
 	// Allocate new wave
-	for (int i = 0; i < 64; ++i)
-		pChunk->StoreByte(pInstrument->GetSample(i));
+	for (unsigned char x : Wave)
+		Chunk.StoreByte(x);
 
-	++m_iWaveTables;
+	return m_iWaveTables++;
 }
 
 // Object list functions
 
 CChunk &CCompiler::CreateChunk(const stChunkLabel &Label) {		// // //
-	return *m_vChunks.emplace_back(std::make_shared<CChunk>(Label));
+	return *m_vChunks.emplace_back(std::make_shared<CChunk>(Label, &m_ChunkArena));
 }
 
 CChunk &CCompiler::AddChunkToList(CChunk &Chunk, const stChunkLabel &Label) {		// // //
@@ -1604,3 +1668,24 @@ CChunk *CCompiler::GetObjectByLabel(const stChunkLabel &Label) const		// // //
 			return pChunk.get();
 	return nullptr;
 }
+
+bool CCompiler::AddUniqueChunk(CChunk &&Chunk)		// // //
+{
+	// Chunks of the same type with identical data are emitted once, references
+	// to the others are redirected through the duplicate map
+	if (auto it = m_ChunkContents.find({Chunk.GetType(), Chunk.GetBytes()}); it != m_ChunkContents.end()) {
+		m_DuplicateMap.try_emplace(Chunk.GetLabel(), it->second->GetLabel());
+		return false;
+	}
+
+	const CChunk &NewChunk = *m_vChunks.emplace_back(std::make_shared<CChunk>(std::move(Chunk)));
+	m_ChunkContents.try_emplace({NewChunk.GetType(), NewChunk.GetBytes()}, &NewChunk);
+	return true;
+}
+
+void CCompiler::RedirectDuplicates(CChunk &Chunk) const		// // //
+{
+	for (int j = 0, n = Chunk.GetLength(); j < n; ++j)
+		if (auto it = m_DuplicateMap.find(Chunk.GetDataPointerTarget(j)); it != m_DuplicateMap.cend())
+			Chunk.SetDataPointerTarget(j, it->second);
+}
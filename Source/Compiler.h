@@ -26,12 +26,15 @@
 #include <vector>		// // //
 #include <array>		// // //
 #include <memory>
+#include <memory_resource>		// // //
 #include <string>		// // //
 #include <map>		// // //
+#include <unordered_map>		// // //
 #include <cstdint>		// // //
 #include "SoundChipSet.h"		// // //
 #include "ChannelOrder.h"		// // //
 #include "Sequence.h"		// // // TODO: remove
+#include "ft0cc/cpputil/array_view.hpp"		// // //
 
 // NSF file header
 struct stNSFHeader {
@@ -111,6 +114,7 @@ public:
 	void	ExportASM(CBinaryWriter &file);
 
 	void	SetMetadata(std::string_view title, std::string_view artist, std::string_view copyright);		// // //
+	void	SetThreadCount(unsigned count);		// // // threads compiling patterns, 0 uses all hardware threads
 
 private:
 	void	ExportNSF_NSFE(CBinaryWriter &file, int MachineType, bool isNSFE);		// // //
@@ -128,7 +132,7 @@ private:
 	bool	ResolveLabelsBankswitched();
 	void	CollectLabels(std::map<stChunkLabel, int> &labelMap) const;		// // //
 	bool	CollectLabelsBankswitched(std::map<stChunkLabel, int> &labelMap);
-	void	AssignLabels(std::map<stChunkLabel, int> &labelMap);
+	void	AssignLabels(const std::map<stChunkLabel, int> &labelMap);		// // //
 	void	AddBankswitching();
 
 	void	ScanSong();
@@ -155,12 +159,14 @@ private:
 	void	EnableBankswitching();
 
 	// FDS
-	void	AddWavetable(CInstrumentFDS *pInstrument, CChunk *pChunk);
+	unsigned AddWavetable(const CInstrumentFDS &Instrument, CChunk &Chunk);		// // //
 
 	// Object list functions
 	CChunk	&CreateChunk(const stChunkLabel &Label);		// // //
 	CChunk	&AddChunkToList(CChunk &Chunk, const stChunkLabel &Label);		// // //
 	CChunk	*GetObjectByLabel(const stChunkLabel &Label) const;		// // //
+	bool	AddUniqueChunk(CChunk &&Chunk);		// // //
+	void	RedirectDuplicates(CChunk &Chunk) const;		// // //
 	int		CountData() const;
 
 	// Debugging
@@ -197,6 +203,7 @@ private:
 	std::string		title_, artist_, copyright_;		// // //
 
 	// Object lists
+	std::pmr::monotonic_buffer_resource m_ChunkArena;		// // // Backing storage of all chunk data
 	std::vector<std::shared_ptr<CChunk>> m_vChunks;		// // //
 	std::vector<CChunk*> m_vSongChunks;
 	std::vector<CChunk*> m_vFrameChunks;
@@ -211,6 +218,7 @@ private:
 
 	// Flags
 	bool			m_bBankSwitched = false;
+	unsigned int	m_iThreadCount = 0u;		// // //
 
 	// Driver
 	const driver_t	*m_pDriverData = nullptr;
@@ -223,7 +231,6 @@ private:
 	std::array<std::array<bool, SEQ_COUNT>, MAX_SEQUENCES> m_bSequencesUsedN163 = { };
 	std::array<std::array<bool, SEQ_COUNT>, MAX_SEQUENCES> m_bSequencesUsedS5B  = { };		// // //
 
-	std::array<unsigned, MAX_INSTRUMENTS> m_iWaveBanks = { };		// // // N163 waves
 
 	// Sample variables
 	std::array<std::array<unsigned char, NOTE_COUNT>, MAX_INSTRUMENTS> m_iSamplesLookUp = { };
@@ -259,8 +266,9 @@ private:
 	unsigned int	m_iWaveTables = 0;
 
 	// Optimization
-	std::map<unsigned, const CChunk *> m_PatternMap;		// // //
+	std::unordered_map<std::uint64_t, std::vector<const CChunk *>> m_PatternMap;		// // // Compiled patterns of all songs by content hash
 	std::map<stChunkLabel, stChunkLabel> m_DuplicateMap;		// // //
+	std::map<std::pair<chunk_type_t, array_view<const unsigned char>>, const CChunk *> m_ChunkContents;		// // // Shared sequences and waves
 
 	// Debugging
 	std::shared_ptr<CCompilerLog> m_pLogger;		// // //
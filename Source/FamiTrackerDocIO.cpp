@@ -171,12 +171,13 @@ void CFamiTrackerDocReader::PostLoad(CFamiTrackerModule &modfile) {
 			modfile.VisitSongs([&] (CSongData &song) {
 				if (CTrackData *pFDS = song.GetTrack(fds_subindex_t::wave)) {
 					pFDS->VisitPatterns([&] (CPatternData &pattern, std::size_t p) {
-						for (ft0cc::doc::pattern_note &Note : pattern.Rows())
-							if (is_note(Note.note())) {
+						for (unsigned row = 0, n = pattern.GetCapacity(); row < n; ++row)		// // //
+							if (auto Note = pattern.GetNoteOn(row); is_note(Note.note())) {
 								int Trsp = Note.midi_note() + NOTE_RANGE * 2;
 								Trsp = Trsp >= NOTE_COUNT ? NOTE_COUNT - 1 : Trsp;
 								Note.set_note(ft0cc::doc::pitch_from_midi(Trsp));
 								Note.set_oct(ft0cc::doc::oct_from_midi(Trsp));
+								pattern.SetNoteOn(row, Note);
 							}
 					});
 				}
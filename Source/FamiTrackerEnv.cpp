@@ -23,6 +23,7 @@
 #include "FamiTrackerEnv.h"
 #include "InstrumentService.h"		// // //
 #include "SoundChipService.h"		// // //
+#include "Settings.h"		// // //
 #ifndef FT0CC_EXT_BUILD
 #include "stdafx.h"
 #include "FamiTracker.h"
@@ -72,7 +73,7 @@ CMIDI *CFamiTrackerEnv::GetMIDI() {
 
 CSettings *CFamiTrackerEnv::GetSettings() {
 #ifdef FT0CC_EXT_BUILD
-	return nullptr;
+	return &CSettings::GetInstance();		// // // default-initialized, for the channel handlers
 #else
 	return theApp.GetSettings();
 #endif
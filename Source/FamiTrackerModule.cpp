@@ -311,11 +311,14 @@ void CFamiTrackerModule::SwapInstruments(unsigned first, unsigned second) {
 	// Scan patterns
 	VisitSongs([&] (CSongData &song) {
 		song.VisitPatterns([&] (CPatternData &pat) {
-			for (ft0cc::doc::pattern_note &note : pat.Rows())
+			for (unsigned row = 0, n = pat.GetCapacity(); row < n; ++row) {		// // //
+				auto note = pat.GetNoteOn(row);
 				if (note.inst() == first)
 					note.set_inst(second);
 				else if (note.inst() == second)
 					note.set_inst(first);
+				pat.SetNoteOn(row, note);
+			}
 		});
 	});
 }
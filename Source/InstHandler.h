@@ -24,6 +24,7 @@
 #pragma once
 
 #include <memory>
+#include "StateArchive.h"		// // //
 
 class CChannelHandlerInterface;
 class CInstrument;
@@ -71,6 +72,20 @@ public:
 		\details The method does not specify whether a note can be released for multiple times until
 		another new note is triggered. */
 	virtual void ReleaseInstrument() = 0;
+	/*!	\brief Saves or loads the runtime state of the instrument handler.
+		\details Unlike CInstHandler::LoadInstrument, this method must not have any side effects on
+		the associated channel.
+		\param ar The state archive.
+		\param pInst Pointer to the instrument used by this handler. */
+	virtual void SerializeState(CStateArchive &ar, std::shared_ptr<const CInstrument> pInst) {		// // //
+		if (ar.IsLoading())
+			m_pInstrument = std::move(pInst);
+		ar(m_iVolume, m_iNoteOffset, m_iPitchOffset);
+	}
+	/*!	\brief Returns the instrument currently used by this handler. */
+	std::shared_ptr<const CInstrument> GetInstrument() const {		// // //
+		return m_pInstrument;
+	}
 
 protected:
 	/*!	\brief An interface to the underlying channel handler.
@@ -34,6 +34,7 @@ public:
 	void TriggerInstrument() override;
 	void ReleaseInstrument() override;
 	void UpdateInstrument() override;
+	void SerializeState(CStateArchive &ar, std::shared_ptr<const CInstrument> pInst) override;		// // //
 private:
 	void UpdateRegs();
 	bool m_bUpdate = false;
@@ -115,7 +115,8 @@ void Kraid::makePattern(CSongData &song, stChannelID ch, unsigned pat, std::stri
 	auto &pattern = song.GetPattern(ch, pat);
 
 	for (auto c : mml) {
-		auto &note = pattern.GetNoteOn(row);
+		const int current = row;		// // //
+		auto note = pattern.GetNoteOn(current);
 		switch (c) {
 		case '<': --octave; break;
 		case '>': ++octave; break;
@@ -136,5 +137,6 @@ void Kraid::makePattern(CSongData &song, stChannelID ch, unsigned pat, std::stri
 		case 'b': ++row; note.set_note(ft0cc::doc::pitch::B ); note.set_oct(octave); note.set_inst(INST); break;
 		case '@': note.set_fx_cmd(0, {ft0cc::doc::effect_type::DUTY_CYCLE, 2u}); break;
 		}
+		pattern.SetNoteOn(current, note);		// // //
 	}
 }
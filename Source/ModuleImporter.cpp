@@ -229,7 +229,8 @@ void CModuleImporter::ImportSongs() {
 			if (auto it = groove_index_.find(song.GetSongSpeed()); it != groove_index_.end())
 				song.SetSongSpeed(it->second);
 		song.VisitPatterns([this] (CPatternData &pat) {
-			for (ft0cc::doc::pattern_note &note : pat.Rows()) {
+			for (unsigned row = 0, n = pat.GetCapacity(); row < n; ++row) {		// // //
+				auto note = pat.GetNoteOn(row);
 				// Translate instrument number
 				if (note.inst() < MAX_INSTRUMENTS)
 					if (auto it = inst_index_.find(note.inst()); it != inst_index_.end())
@@ -239,6 +240,7 @@ void CModuleImporter::ImportSongs() {
 					if (fx == ft0cc::doc::effect_type::GROOVE && param < MAX_GROOVE)
 						if (auto it = groove_index_.find(param); it != groove_index_.end())
 							param = it->second;
+				pat.SetNoteOn(row, note);
 			}
 		});
 	});
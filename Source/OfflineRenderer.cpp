@@ -0,0 +1,293 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+//
+// Offline module renderer, mirrors the parts of CSoundGen used by RenderToFile
+//
+
+#include "OfflineRenderer.h"
+#include "FamiTrackerModule.h"
+#include "SongData.h"
+#include "ChannelOrder.h"
+#include "SoundChipSet.h"
+#include "APU/APU.h"
+#include "SoundDriver.h"
+#include "TempoCounter.h"
+#include "PlayerCursor.h"
+#include "WaveRenderer.h"
+#include "StateArchive.h"		// // //
+#include "APU/RegisterCapture.h"		// // //
+#include <stdexcept>
+
+COfflineRenderer::COfflineRenderer(const CFamiTrackerModule &modfile, const stOfflineRenderSettings &settings) :
+	modfile_(modfile),
+	m_pAPU(std::make_unique<CAPU>(this)),
+	m_pTempoCounter(std::make_shared<CTempoCounter>(modfile)),
+	m_pSoundDriver(std::make_unique<CSoundDriver>(this))
+{
+	m_pSoundDriver->SetupTracks();
+	m_pSoundDriver->AssignModule(modfile_);
+	m_pSoundDriver->LoadAPU(*m_pAPU);
+	m_pSoundDriver->SetTempoCounter(m_pTempoCounter);
+
+	const machine_t Machine = modfile_.GetMachine();
+	if (!m_pAPU->SetupSound(settings.SampleRate, 1, Machine))
+		throw std::runtime_error {"Could not allocate sound buffer"};
+	m_pAPU->SetupMixer(settings.BassFilter, settings.TrebleFilter, settings.TrebleDamping, settings.MixVolume);
+	m_pAPU->EnableMetering(settings.ChannelMeters);		// // //
+
+	// Select expansion chips
+	CSoundChipSet Chips = modfile_.GetSoundChipSet();
+	m_pAPU->SetExternalSound(Chips);
+	if (Chips.ContainsChip(sound_chip_t::APU)) {
+		m_pAPU->Write(0x4015, 0x0F);
+		m_pAPU->Write(0x4017, 0x00);
+	}
+	if (Chips.ContainsChip(sound_chip_t::MMC5))
+		m_pAPU->Write(0x5015, 0x03);
+
+	// Setup machine type and speed
+	int BaseFreq = (Machine == machine_t::NTSC) ? MASTER_CLOCK_NTSC : MASTER_CLOCK_PAL;
+	int Rate = modfile_.GetFrameRate();
+	m_iUpdateCycles = BaseFreq / Rate;
+	m_pAPU->ChangeMachineRate(Machine, Rate);
+
+	m_pSoundDriver->ConfigureDocument();
+
+	// Channel handlers are only initialized by a reset, CSoundGen does this in MakeSilent
+	m_pAPU->Reset();
+	m_pSoundDriver->ResetTracks();
+}
+
+COfflineRenderer::~COfflineRenderer() {
+	m_pAPU->SetRegisterCapture(nullptr);		// // //
+}
+
+void COfflineRenderer::Render(std::shared_ptr<CWaveRenderer> pRender) {
+	StartRender(std::move(pRender));		// // //
+	while (RenderFrame()) {
+	}
+}
+
+void COfflineRenderer::StartRender(std::shared_ptr<CWaveRenderer> pRender) {		// // //
+	if (!pRender)
+		return;
+
+	m_pWaveRenderer = std::move(pRender);
+	auto Stems = m_pWaveRenderer->GetStemChannels();		// // //
+	if (!m_pAPU->SetStemOutput(Stems.empty() ? nullptr : this, Stems))
+		throw std::runtime_error {"Could not allocate stem buffers"};
+	m_pAPU->Reset();
+	m_pWaveRenderer->Start();
+}
+
+bool COfflineRenderer::RenderFrame() {
+	if (!m_pWaveRenderer)
+		return false;
+
+	++m_iFrameCount;
+
+	m_pSoundDriver->Tick();
+
+	// Rendering
+	if (m_pWaveRenderer->ShouldStopRender()) {
+		StopRendering();
+		return false;
+	}
+	bool StartPlayer = m_pWaveRenderer->ShouldStartPlayer();
+
+	// Update APU registers
+	UpdateAPU();
+
+	if (m_pSoundDriver->ShouldHalt() || m_bHaltRequest)
+		HaltPlayer();
+
+	// CSoundGen starts the player through a thread message, which is handled after the current frame
+	if (StartPlayer)
+		BeginPlayer(m_pWaveRenderer->GetRenderTrack());
+
+	return true;
+}
+
+std::vector<std::byte> COfflineRenderer::SaveState() {		// // //
+	CStateArchive ar;
+	unsigned FrameCount = m_iFrameCount;
+	bool HaltRequest = m_bHaltRequest;
+	bool HasRenderer = m_pWaveRenderer != nullptr;
+	ar(FrameCount, HaltRequest, HasRenderer);
+	if (m_pWaveRenderer)
+		m_pWaveRenderer->SerializeState(ar);
+
+	// the sound driver is serialized first, as loading it may write to the APU
+	m_pSoundDriver->SerializeState(ar);
+	m_pAPU->SerializeState(ar);
+	return ar.Release();
+}
+
+void COfflineRenderer::LoadState(array_view<const std::byte> snapshot, std::shared_ptr<CWaveRenderer> pRender) {		// // //
+	CStateArchive ar {snapshot};
+	bool HasRenderer = false;
+	ar(m_iFrameCount, m_bHaltRequest, HasRenderer);
+	if (HasRenderer) {
+		if (pRender)
+			m_pWaveRenderer = std::move(pRender);
+		if (!m_pWaveRenderer)
+			throw CStateArchiveException {"State snapshot requires a wave renderer"};
+		m_pWaveRenderer->SerializeState(ar);
+	}
+	else
+		m_pWaveRenderer.reset();
+
+	m_pSoundDriver->SerializeState(ar);
+	m_pAPU->SerializeState(ar);
+	ar.Finish();
+}
+
+const CRegisterCapture &COfflineRenderer::StartRegisterCapture() {		// // //
+	m_pRegisterCapture = std::make_unique<CRegisterCapture>(modfile_.GetSoundChipSet(), modfile_.GetMachine(), modfile_.GetFrameRate());
+	m_pAPU->SetRegisterCapture(m_pRegisterCapture.get());
+	return *m_pRegisterCapture;
+}
+
+unsigned COfflineRenderer::GetFrameCount() const {
+	return m_iFrameCount;
+}
+
+unsigned COfflineRenderer::GetFrameRate() const {
+	return modfile_.GetFrameRate();
+}
+
+void COfflineRenderer::ResetAPU() {
+	m_pAPU->Reset();
+
+	// Enable all channels
+	m_pAPU->Write(0x4015, 0x0F);
+	m_pAPU->Write(0x4017, 0x00);
+	m_pAPU->Write(0x4023, 0x02);		// FDS enable
+
+	// MMC5
+	m_pAPU->Write(0x5015, 0x03);
+}
+
+void COfflineRenderer::BeginPlayer(unsigned track) {
+	const CSongData &song = *modfile_.GetSong(track);
+	m_pSoundDriver->StartPlayer(std::make_unique<CPlayerCursor>(song, track));
+	m_bHaltRequest = false;
+
+	m_pTempoCounter->LoadTempo(song);
+	ResetAPU();
+
+	m_pAPU->Reset();
+	m_pSoundDriver->ResetTracks();
+}
+
+void COfflineRenderer::HaltPlayer() {
+	m_pAPU->Reset();
+	m_pSoundDriver->ResetTracks();
+
+	m_pSoundDriver->StopPlayer();
+	m_bHaltRequest = false;
+}
+
+void COfflineRenderer::StopRendering() {
+	if (!is_rendering_impl())
+		return;
+
+	m_pWaveRenderer.reset();
+	m_pAPU->Reset();
+	HaltPlayer();
+	ResetAPU();
+}
+
+void COfflineRenderer::UpdateAPU() {
+	// Update APU channel registers
+	int cycles = m_iUpdateCycles;
+	sound_chip_t LastChip = sound_chip_t::none;
+
+	m_pSoundDriver->ForeachTrack([&] (CChannelHandler &, CTrackerChannel &, stChannelID ID) {
+		if (modfile_.GetChannelOrder().HasChannel(ID)) {
+			int Delay = (ID.Chip == LastChip) ? 150 : 250;
+			if (Delay < cycles) {
+				// Add APU cycles
+				cycles -= Delay;
+				m_pAPU->AddTime(Delay);
+			}
+			LastChip = ID.Chip;
+		}
+		m_pAPU->Process();
+	});
+
+	// Finish the audio frame
+	m_pAPU->AddTime(cycles);
+	m_pAPU->Process();
+	m_pAPU->EndFrame();
+}
+
+bool COfflineRenderer::is_rendering_impl() const {
+	return m_pWaveRenderer && m_pWaveRenderer->Started() && !m_pWaveRenderer->Finished();
+}
+
+void COfflineRenderer::FlushBuffer(array_view<const int16_t> Buffer) {
+	if (is_rendering_impl())
+		m_pWaveRenderer->FlushBuffer(Buffer);
+}
+
+void COfflineRenderer::FlushStemBuffer(stChannelID Channel, array_view<const int16_t> Buffer) {		// // //
+	if (is_rendering_impl())
+		m_pWaveRenderer->FlushStemBuffer(Channel, Buffer);
+}
+
+bool COfflineRenderer::PlayBuffer() {
+	return true;
+}
+
+CInstrumentManager *COfflineRenderer::GetInstrumentManager() const {
+	return modfile_.GetInstrumentManager();
+}
+
+void COfflineRenderer::OnTick() {
+	if (is_rendering_impl())
+		m_pWaveRenderer->Tick();
+}
+
+void COfflineRenderer::OnStepRow() {
+	if (is_rendering_impl())
+		m_pWaveRenderer->StepRow();
+}
+
+void COfflineRenderer::OnPlayNote(stChannelID chan, const ft0cc::doc::pattern_note &note) {
+}
+
+void COfflineRenderer::OnUpdateRow(int frame, int row) {
+}
+
+bool COfflineRenderer::IsChannelMuted(stChannelID chan) const {
+	return false;
+}
+
+bool COfflineRenderer::ShouldStopPlayer() const {
+	return is_rendering_impl() && m_pWaveRenderer->ShouldStopPlayer();
+}
+
+int COfflineRenderer::GetArpNote(stChannelID chan) const {
+	return -1;
+}
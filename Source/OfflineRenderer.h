@@ -0,0 +1,116 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <memory>
+#include <vector>		// // //
+#include <cstddef>		// // //
+#include "Common.h"
+#include "SoundGenBase.h"
+#include "APU/Types.h"
+
+class CFamiTrackerModule;
+class CAPU;
+class CSoundDriver;
+class CTempoCounter;
+class CWaveRenderer;
+class CRegisterCapture;		// // //
+
+// // // settings used by the offline renderer in place of CSettings::Sound
+struct stOfflineRenderSettings {
+	unsigned SampleRate = 44100u;
+	unsigned SampleSize = 16u;
+	int BassFilter = 30;
+	int TrebleFilter = 12000;
+	int TrebleDamping = 24;
+	int MixVolume = 100;
+	bool ChannelMeters = false;		// nothing displays the meters during offline renders
+};
+
+// // // renders a module to a wave renderer without a window, audio device or sound thread
+class COfflineRenderer : public CSoundGenBase, public IAudioCallback, public IStemCallback {		// // //
+public:
+	COfflineRenderer(const CFamiTrackerModule &modfile, const stOfflineRenderSettings &settings);
+	~COfflineRenderer();
+
+	// Runs the emulation as fast as possible until the wave renderer finishes; channels with a
+	// stem stream in the wave renderer are written to their own streams in the same pass
+	void Render(std::shared_ptr<CWaveRenderer> pRender);
+	// // // Prepares the emulation for rendering without running it
+	void StartRender(std::shared_ptr<CWaveRenderer> pRender);
+	// Runs a single frame of the emulation, returns false after the render has stopped
+	bool RenderFrame();
+
+	// // // Saves the emulation state of the renderer, the sound driver and the APU
+	std::vector<std::byte> SaveState();
+	// // // Restores a state saved by a renderer of the same module and settings; rendering may be
+	// continued with RenderFrame, writing to the output stream of the given wave renderer
+	void LoadState(array_view<const std::byte> snapshot, std::shared_ptr<CWaveRenderer> pRender = nullptr);
+
+	// // // Records all APU writes made from now on into a register log, which can be replayed
+	// with different sample rate and mixer settings by CRegisterReplayer
+	const CRegisterCapture &StartRegisterCapture();
+
+	unsigned GetFrameCount() const;		// // // frames emulated so far
+	unsigned GetFrameRate() const;
+
+private:
+	void ResetAPU();
+	void BeginPlayer(unsigned track);
+	void HaltPlayer();
+	void StopRendering();
+	void UpdateAPU();
+
+	bool is_rendering_impl() const;
+
+	// IAudioCallback impl
+	void FlushBuffer(array_view<const int16_t> Buffer) override;
+	bool PlayBuffer() override;
+
+	// // // IStemCallback impl
+	void FlushStemBuffer(stChannelID Channel, array_view<const int16_t> Buffer) override;
+
+	// CSoundGenBase impl
+	CInstrumentManager *GetInstrumentManager() const override;
+	void OnTick() override;
+	void OnStepRow() override;
+	void OnPlayNote(stChannelID chan, const ft0cc::doc::pattern_note &note) override;
+	void OnUpdateRow(int frame, int row) override;
+	bool IsChannelMuted(stChannelID chan) const override;
+	bool ShouldStopPlayer() const override;
+	int GetArpNote(stChannelID chan) const override;
+
+private:
+	const CFamiTrackerModule &modfile_;
+
+	std::unique_ptr<CAPU> m_pAPU;
+	std::shared_ptr<CTempoCounter> m_pTempoCounter;
+	std::unique_ptr<CSoundDriver> m_pSoundDriver;
+	std::shared_ptr<CWaveRenderer> m_pWaveRenderer;
+	std::unique_ptr<CRegisterCapture> m_pRegisterCapture;		// // //
+
+	int m_iUpdateCycles = 0;
+	unsigned m_iFrameCount = 0u;
+	bool m_bHaltRequest = false;
+};
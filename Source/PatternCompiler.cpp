@@ -147,7 +147,7 @@ void CPatternCompiler::CompileData(int Track, int Pattern, stChannelID Channel)
 	int EffColumns = pSong->GetEffectColumnCount(Channel);
 
 	// Global init
-	m_iHash = 0;
+	m_iHash = 0xCBF29CE484222325u;		// // // FNV-1a offset basis
 	m_iDuration = 0;
 	m_iCurrentDefaultDuration = 0xFF;
 
@@ -735,9 +735,8 @@ CPatternCompiler::stSpacingInfo CPatternCompiler::ScanNoteLengths(int Track, uns
 void CPatternCompiler::WriteData(unsigned char Value)
 {
 	m_vData.push_back(Value);
-	m_iHash += Value;				// Simple CRC-hash
-	m_iHash += (m_iHash << 10);
-	m_iHash ^= (m_iHash >> 6);
+	m_iHash ^= Value;				// // // 64-bit FNV-1a hash
+	m_iHash *= 0x100000001B3u;
 }
 
 void CPatternCompiler::AccumulateDuration()
@@ -895,7 +894,7 @@ void CPatternCompiler::OptimizeString()
 	(void)last_inst;		// // //
 }
 
-unsigned int CPatternCompiler::GetHash() const
+std::uint64_t CPatternCompiler::GetHash() const		// // //
 {
 	return m_iHash;
 }
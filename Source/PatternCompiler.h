@@ -28,6 +28,7 @@
 #include "APU/Types_fwd.h"		// // //
 #include <memory>		// // //
 #include <string_view>		// // //
+#include <cstdint>		// // //
 
 class CFamiTrackerModule;		// // //
 class CCompilerLog;
@@ -42,7 +43,7 @@ public:
 
 	void			CompileData(int Track, int Pattern, stChannelID Channel);
 
-	unsigned int	GetHash() const;
+	std::uint64_t	GetHash() const;		// // //
 	bool			CompareData(const std::vector<unsigned char> &data) const;		// // //
 
 	const std::vector<unsigned char> &GetData() const;		// // //
@@ -80,7 +81,7 @@ private:
 	unsigned int	m_iDuration;
 	unsigned int	m_iCurrentDefaultDuration;
 	bool			m_bDSamplesAccessed[OCTAVE_RANGE * NOTE_RANGE] = { }; // <- check the range, its not optimal right now
-	unsigned int	m_iHash;
+	std::uint64_t	m_iHash;		// // //
 	const std::vector<unsigned> &m_iInstrumentList;		// // //
 
 	const DPCM_List_t *m_pDPCMList = nullptr;		// // //
@@ -22,62 +22,76 @@
 
 #include "PatternData.h"
 #include "ft0cc/doc/pattern_note.hpp"
-#include <type_traits>
+#include <algorithm>		// // //
+#include <atomic>		// // //
+#include <utility>		// // //
 
 namespace {
 
 const auto BLANK = ft0cc::doc::pattern_note { };
 
+std::atomic<std::uint64_t> NextPatternVersion {1u};		// // // 0 is reserved for blank patterns
+
 } // namespace
 
-CPatternData::CPatternData(const CPatternData &other) : data_(std::make_unique<elem_t>(*other.data_)) {
+CPatternData::CPatternData() = default;
+
+CPatternData::CPatternData(const CPatternData &other) :		// // //
+	data_(other.data_), rows_(data_.get()), version_(other.GetVersion())
+{
+}
+
+CPatternData::CPatternData(CPatternData &&other) noexcept :
+	data_(std::move(other.data_)), rows_(data_.get()), version_(other.version_.exchange(0u))		// // //
+{
+	other.Publish();
 }
 
 CPatternData::~CPatternData() noexcept {
 }
 
-CPatternData &CPatternData::operator=(const CPatternData &other) {
+CPatternData &CPatternData::operator=(const CPatternData &other) {		// // //
 	if (this != &other) {
-		if (other.data_) {
-			Allocate();
-			*data_ = *other.data_;
-		}
-		else
-			data_.reset();
+		data_ = other.data_;
+		Publish();
+		version_ = other.GetVersion();
 	}
 	return *this;
 }
 
-ft0cc::doc::pattern_note &CPatternData::GetNoteOn(unsigned row) {
-	Allocate();
-	return (*data_)[row];
+CPatternData &CPatternData::operator=(CPatternData &&other) noexcept {		// // //
+	if (this != &other) {
+		data_ = std::move(other.data_);
+		Publish();
+		other.Publish();
+		version_ = other.version_.exchange(0u);
+	}
+	return *this;
 }
 
 const ft0cc::doc::pattern_note &CPatternData::GetNoteOn(unsigned row) const {
-	return data_ ? (*data_)[row] : BLANK;
+	const elem_t *rows = GetRows();		// // //
+	return rows && row < rows->capacity.load(std::memory_order_acquire) ? RowAt(*rows, row) : BLANK;
 }
 
 void CPatternData::SetNoteOn(unsigned row, const ft0cc::doc::pattern_note &note) {
-	Allocate();
-	(*data_)[row] = note;
+	if (GetNoteOn(row) == note)		// // // also skips blank rows past the capacity
+		return;
+	Detach();		// // //
+	Allocate(row + 1);
+	RowAt(*data_, row) = note;
+	Touch();		// // // after the write, see GetVersion
 }
 
 bool CPatternData::operator==(const CPatternData &other) const noexcept {
-	if (!data_ && !other.data_)
-		return true;
-
-	const auto IsPatternBlank = [] (const elem_t &notes) {
-		for (const auto &n : notes)
-			if (n != ft0cc::doc::pattern_note { })
-				return false;
+	if (GetRows() == other.GetRows())		// // // also true for shared rows
 		return true;
-	};
-	if (!data_ && other.data_)
-		return IsPatternBlank(*other.data_);
-	if (data_ && !other.data_)
-		return IsPatternBlank(*data_);
 
-	return *data_ == *other.data_;
+	// // // compare rows up to the larger capacity, missing rows are blank
+	for (unsigned i = 0, n = std::max(GetCapacity(), other.GetCapacity()); i < n; ++i)
+		if (GetNoteOn(i) != other.GetNoteOn(i))
+			return false;
+	return true;
 }
 
 bool CPatternData::operator!=(const CPatternData &other) const noexcept {
@@ -90,7 +104,16 @@ CPatternData::operator bool() const noexcept {
 */
 
 unsigned CPatternData::GetMaximumSize() const noexcept {
-	return std::tuple_size_v<elem_t>;
+	return max_size;		// // //
+}
+
+unsigned CPatternData::GetCapacity() const noexcept {		// // //
+	const elem_t *rows = GetRows();
+	return rows ? rows->capacity.load(std::memory_order_acquire) : 0u;
+}
+
+std::uint64_t CPatternData::GetVersion() const noexcept {		// // //
+	return version_.load(std::memory_order_acquire);
 }
 
 unsigned CPatternData::GetNoteCount(unsigned rowcount) const {
@@ -102,35 +125,60 @@ unsigned CPatternData::GetNoteCount(unsigned rowcount) const {
 }
 
 bool CPatternData::IsEmpty() const {
-	if (!data_)
-		return true;
-	for (const auto &x : *data_)
+	for (const auto &x : Rows())		// // //
 		if (x != BLANK)
 			return false;
 	return true;
 }
 
-array_view<ft0cc::doc::pattern_note> CPatternData::Rows() {
+CPatternData::row_view<const ft0cc::doc::pattern_note> CPatternData::Rows() const {
 	return Rows(GetMaximumSize());
 }
 
-array_view<const ft0cc::doc::pattern_note> CPatternData::Rows() const {
-	return Rows(GetMaximumSize());
+CPatternData::row_view<const ft0cc::doc::pattern_note> CPatternData::Rows(unsigned rowcount) const {
+	const elem_t *rows = GetRows();		// // //
+	return {rows, rows ? std::min(rowcount, rows->capacity.load(std::memory_order_acquire)) : 0u};
+}
+
+ft0cc::doc::pattern_note &CPatternData::RowAt(const elem_t &data, unsigned row) {		// // //
+	return (*data.blocks[row / block_size])[row % block_size];
 }
 
-array_view<ft0cc::doc::pattern_note> CPatternData::Rows(unsigned rowcount) {
-	return data_ ?
-		array_view<ft0cc::doc::pattern_note> {data_->data(), rowcount} :
-		array_view<ft0cc::doc::pattern_note> { };
+const CPatternData::elem_t *CPatternData::GetRows() const noexcept {		// // //
+	return rows_.load(std::memory_order_acquire);
 }
 
-array_view<const ft0cc::doc::pattern_note> CPatternData::Rows(unsigned rowcount) const {
-	return data_ ?
-		array_view<const ft0cc::doc::pattern_note> {data_->data(), rowcount} :
-		array_view<const ft0cc::doc::pattern_note> { };
+void CPatternData::Allocate(unsigned rows) {		// // //
+	if (rows <= GetCapacity())
+		return;
+	if (!data_) {
+		data_ = std::make_shared<elem_t>();
+		Publish();
+	}
+	// new blocks are added behind the existing ones, which are never moved
+	const unsigned capacity = data_->capacity.load(std::memory_order_relaxed);
+	for (unsigned b = capacity / block_size, n = (std::min(rows, max_size) + block_size - 1) / block_size; b < n; ++b)
+		data_->blocks[b] = std::make_unique<block_t>();
+	data_->capacity.store(std::min((rows + block_size - 1) / block_size * block_size, max_size), std::memory_order_release);
+}
+
+void CPatternData::Touch() noexcept {		// // //
+	version_.store(NextPatternVersion++, std::memory_order_release);
+}
+
+void CPatternData::Detach() {		// // //
+	// the old storage stays alive in the other copies, so readers still holding it are unaffected
+	if (data_ && data_.use_count() > 1) {
+		auto copy = std::make_shared<elem_t>();
+		for (unsigned b = 0; b < block_count; ++b)
+			if (data_->blocks[b])
+				copy->blocks[b] = std::make_unique<block_t>(*data_->blocks[b]);
+		copy->capacity.store(data_->capacity.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		data_ = std::move(copy);
+		Publish();
+	}
 }
 
-void CPatternData::Allocate() {
-	if (!data_)
-		data_ = std::make_unique<elem_t>();
+void CPatternData::Publish() noexcept {		// // //
+	rows_.store(data_.get(), std::memory_order_release);
 }
@@ -25,7 +25,12 @@
 
 #include "FamiTrackerDefines.h"
 #include <array>
+#include <atomic>		// // //
 #include <memory>
+#include <cstdint>		// // //
+#include <cstddef>		// // //
+#include <iterator>		// // //
+#include <type_traits>		// // //
 #include "ft0cc/cpputil/array_view.hpp"
 
 namespace ft0cc::doc {
@@ -33,20 +38,87 @@ class pattern_note;
 } // namespace ft0cc::doc
 
 // // // the real pattern class
+// row storage is shared between copies and only cloned before the first write
+// rows are allocated in blocks up to the last written row, rows past the capacity are blank
+// allocated blocks never move, so references to rows stay valid while the pattern grows
+// rows are only written on the editing thread through SetNoteOn; the const accessors may be
+// called from the sound thread at the same time, they read the storage published after a clone
 class CPatternData {
 	static constexpr unsigned max_size = MAX_PATTERN_LENGTH;
+	static constexpr unsigned block_size = 64u;		// // //
+	static constexpr unsigned block_count = (max_size + block_size - 1) / block_size;		// // //
 
-	using elem_t = std::array<ft0cc::doc::pattern_note, max_size>;
+	using block_t = std::array<ft0cc::doc::pattern_note, block_size>;		// // //
+	struct elem_t {
+		std::array<std::unique_ptr<block_t>, block_count> blocks;
+		std::atomic<unsigned> capacity {0u};		// // // stored after the blocks below it
+	};
 
 public:
-	CPatternData() = default;
+	// // // view of the allocated rows of a pattern
+	template <typename T>
+	class row_view {
+	public:
+		class iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = std::remove_const_t<T>;
+			using difference_type = std::ptrdiff_t;
+			using pointer = T *;
+			using reference = T &;
+
+			iterator(const elem_t *data, unsigned row) noexcept : data_(data), row_(row) { }
+
+			T &operator*() const {
+				return CPatternData::RowAt(*data_, row_);
+			}
+			iterator &operator++() noexcept {
+				++row_;
+				return *this;
+			}
+			bool operator==(const iterator &other) const noexcept {
+				return row_ == other.row_;
+			}
+			bool operator!=(const iterator &other) const noexcept {
+				return row_ != other.row_;
+			}
+
+		private:
+			const elem_t *data_;
+			unsigned row_;
+		};
+
+		row_view() noexcept = default;
+		row_view(const elem_t *data, unsigned rows) noexcept : data_(data), size_(rows) { }
+
+		iterator begin() const noexcept {
+			return {data_, 0u};
+		}
+		iterator end() const noexcept {
+			return {data_, size_};
+		}
+		std::size_t size() const noexcept {
+			return size_;
+		}
+		bool empty() const noexcept {
+			return size_ == 0u;
+		}
+		T &operator[](std::size_t row) const {
+			return *iterator {data_, static_cast<unsigned>(row)};
+		}
+
+	private:
+		const elem_t *data_ = nullptr;
+		unsigned size_ = 0u;
+	};
+
+	CPatternData();
 	CPatternData(const CPatternData &other);
-	CPatternData(CPatternData &&other) noexcept = default;
+	CPatternData(CPatternData &&other) noexcept;
 	CPatternData &operator=(const CPatternData &other);
-	CPatternData &operator=(CPatternData &&other) noexcept = default;
+	CPatternData &operator=(CPatternData &&other) noexcept;
 	~CPatternData() noexcept;
 
-	ft0cc::doc::pattern_note &GetNoteOn(unsigned row);
 	const ft0cc::doc::pattern_note &GetNoteOn(unsigned row) const;
 	void SetNoteOn(unsigned row, const ft0cc::doc::pattern_note &note);
 
@@ -55,16 +127,25 @@ public:
 //	explicit operator bool() const noexcept;
 
 	unsigned GetMaximumSize() const noexcept;
+	unsigned GetCapacity() const noexcept;		// // //
+	// // // copies share a version until either is modified, blank patterns have version 0
+	// the version changes after the rows are written, so it must be read before the rows
+	std::uint64_t GetVersion() const noexcept;
 	unsigned GetNoteCount(unsigned rowcount) const;
 	bool IsEmpty() const;
 
-	array_view<ft0cc::doc::pattern_note> Rows();
-	array_view<const ft0cc::doc::pattern_note> Rows() const;
-	array_view<ft0cc::doc::pattern_note> Rows(unsigned rowcount);
-	array_view<const ft0cc::doc::pattern_note> Rows(unsigned rowcount) const;
+	row_view<const ft0cc::doc::pattern_note> Rows() const;
+	row_view<const ft0cc::doc::pattern_note> Rows(unsigned rowcount) const;
 
 private:
-	void Allocate();
+	static ft0cc::doc::pattern_note &RowAt(const elem_t &data, unsigned row);		// // //
+	const elem_t *GetRows() const noexcept;		// // //
+	void Allocate(unsigned rows);		// // //
+	void Detach();
+	void Publish() noexcept;		// // //
+	void Touch() noexcept;		// // //
 
-	std::unique_ptr<elem_t> data_;
+	std::shared_ptr<elem_t> data_;		// // // only replaced on the editing thread
+	std::atomic<const elem_t *> rows_ {nullptr};		// // // data_ as published to readers
+	std::atomic<std::uint64_t> version_ {0u};		// // //
 };
@@ -3031,11 +3031,12 @@ void CPatternEditor::PasteRaw(const CPatternClipData &ClipData, const CCursorPos
 			unsigned f = pos.quot % Frames;
 			unsigned line = pos.rem;
 			CPatternData &pattern = pSongView->GetPatternOnFrame(c, f);
-			ft0cc::doc::pattern_note &Target = pattern.GetNoteOn(line);
+			ft0cc::doc::pattern_note Target = pattern.GetNoteOn(line);		// // //
 			const ft0cc::doc::pattern_note &Source = *(ClipData.GetPattern(i, r));
 			CopyNoteSection(Target, Source,
 				(i == 0) ? StartColumn : column_t::Note,
 				std::min((i == Channels + Pos.Xpos.Track - 1) ? EndColumn : column_t::Effect4, maxcol));
+			pattern.SetNoteOn(line, Target);		// // //
 		}
 	}
 }
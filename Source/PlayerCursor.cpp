@@ -22,6 +22,7 @@
 
 #include "PlayerCursor.h"
 #include "SongData.h"
+#include "StateArchive.h"		// // //
 
 CPlayerCursor::CPlayerCursor(const CSongData &song, unsigned index) :
 	song_(song), track_(index)
@@ -128,6 +129,10 @@ std::optional<unsigned> CPlayerCursor::GetQueuedFrame() const noexcept {
 	return queue_;
 }
 
+void CPlayerCursor::SerializeState(CStateArchive &ar) {		// // //
+	ar(frame_, row_, tick_, total_frames_, total_rows_, total_ticks_, queue_, loop_);
+}
+
 unsigned CPlayerCursor::DequeueFrame() {
 	auto frame = *queue_;
 	queue_.reset();
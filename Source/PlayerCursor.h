@@ -26,6 +26,7 @@
 #include <optional>
 
 class CSongData;
+class CStateArchive;		// // //
 
 // // // TODO: integrate this with CCursorPos
 class CPlayerCursor {
@@ -56,6 +57,8 @@ public:
 
 	std::optional<unsigned> GetQueuedFrame() const noexcept;
 
+	void SerializeState(CStateArchive &ar);		// // //
+
 private:
 	void MoveToRow(unsigned Row);
 	void MoveToFrame(unsigned frame);
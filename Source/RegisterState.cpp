@@ -21,9 +21,33 @@
 */
 
 #include "RegisterState.h"
+#include "StateArchive.h"		// // //
+#include <algorithm>		// // //
+#include <vector>		// // //
+
+void CRegisterState::SerializeState(CStateArchive &ar)		// // //
+{
+	ar(m_iValue, m_iWriteClock, m_iNewClock);
+}
+
+bool CRegisterState::CatchUp(uint32_t Tick)		// // //
+{
+	const uint32_t Elapsed = Tick - m_iTick;
+	m_iTick = Tick;
+	m_iWriteClock -= std::min<uint32_t>(m_iWriteClock, Elapsed);
+	m_iNewClock -= std::min<uint32_t>(m_iNewClock, Elapsed);
+	return m_iWriteClock || m_iNewClock;
+}
+
+CRegisterState CRegisterState::Decayed(uint32_t Tick) const		// // //
+{
+	CRegisterState State = *this;
+	State.CatchUp(Tick);
+	return State;
+}
+
 
 CRegisterLogger::CRegisterLogger() :
-	m_mRegister(),
 	m_iPort(0),
 	m_bAutoIncrement(false),
 	m_bBlocked(false)
@@ -32,26 +56,47 @@ CRegisterLogger::CRegisterLogger() :
 
 void CRegisterLogger::Reset()
 {
-	for (auto &r : m_mRegister)
-		r.second.Reset();
+	for (auto &r : m_Registers)		// // //
+		r.Reset();
+	std::fill(m_DecayingBits.begin(), m_DecayingBits.end(), 0u);
 }
 
 bool CRegisterLogger::AddRegisterRange(unsigned Low, unsigned High)
 {
-	for (unsigned i = Low; i <= High; ++i)
-		if (m_mRegister.find(i) != m_mRegister.end()) // conflict
+	for (const auto &r : m_Ranges)		// // //
+		if (Low <= r.High && r.Low <= High) // conflict
 			return false;
 
-	for (unsigned i = Low; i <= High; ++i)
-		m_mRegister[i] = CRegisterState { };
-	m_mWarpValues[++High] = Low;
+	auto it = std::find_if(m_Ranges.begin(), m_Ranges.end(), [&] (const stRegisterRange &r) { return r.Low > High; });
+	m_Ranges.insert(it, stRegisterRange {Low, High, m_Registers.size()});
+	m_Registers.resize(m_Registers.size() + (High - Low + 1), CRegisterState { });
+	m_DecayingBits.resize((m_Registers.size() + 63) / 64, 0u);
+	SetPort(m_iPort);
 	return true;
 }
 
+std::size_t CRegisterLogger::FindRange(unsigned Address) const		// // //
+{
+	for (std::size_t i = 0; i < m_Ranges.size(); ++i)
+		if (Address >= m_Ranges[i].Low && Address <= m_Ranges[i].High)
+			return i;
+	return NO_REGISTER;
+}
+
+void CRegisterLogger::SetDecaying(std::size_t Index, bool Decaying)		// // //
+{
+	const uint64_t Mask = uint64_t {1} << (Index % 64);
+	if (Decaying)
+		m_DecayingBits[Index / 64] |= Mask;
+	else
+		m_DecayingBits[Index / 64] &= ~Mask;
+}
+
 bool CRegisterLogger::SetPort(unsigned Address)
 {
 	m_iPort = Address;
-	return m_mRegister.find(m_iPort) != m_mRegister.end();
+	m_iPortRange = FindRange(Address);		// // //
+	return m_iPortRange != NO_REGISTER;
 }
 
 void CRegisterLogger::SetAutoincrement(bool Enable)
@@ -61,28 +106,58 @@ void CRegisterLogger::SetAutoincrement(bool Enable)
 
 bool CRegisterLogger::Write(uint8_t Value)
 {
-	if (m_mRegister.find(m_iPort) == m_mRegister.end())
+	if (m_iPortRange == NO_REGISTER)		// // //
 		return false;
 
-	m_mRegister.at(m_iPort).Update(Value);
-	if (m_bAutoIncrement)
-		if (m_mWarpValues.find(++m_iPort) != m_mWarpValues.end())
-			m_iPort = m_mWarpValues[m_iPort];
+	const auto &Range = m_Ranges[m_iPortRange];
+	const std::size_t Index = Range.Offset + (m_iPort - Range.Low);
+	m_Registers[Index].CatchUp(m_iTick);
+	m_Registers[Index].Update(Value);
+	SetDecaying(Index, true);
+
+	if (m_bAutoIncrement)		// // // the port wraps around within its range
+		m_iPort = m_iPort < Range.High ? m_iPort + 1 : Range.Low;
 
 	return true;
 }
 
-CRegisterState *CRegisterLogger::GetRegister(unsigned Address)
+std::optional<CRegisterState> CRegisterLogger::GetRegister(unsigned Address) const		// // //
 {
-	if (m_mRegister.find(Address) == m_mRegister.end())
-		return nullptr;
-	return &m_mRegister.at(Address);
+	std::size_t RangeIndex = FindRange(Address);
+	if (RangeIndex == NO_REGISTER)
+		return std::nullopt;
+	const std::size_t Index = m_Ranges[RangeIndex].Offset + (Address - m_Ranges[RangeIndex].Low);
+	return m_Registers[Index].Decayed(m_iTick);
 }
 
 void CRegisterLogger::Step()
 {
-	for (auto &r : m_mRegister)
-		r.second.Step();
+	if (++m_iTick % CRegisterState::DECAY_RATE == 0)		// // //
+		CatchUpAll();
+}
+
+void CRegisterLogger::CatchUpAll()		// // //
+{
+	for (std::size_t w = 0; w < m_DecayingBits.size(); ++w)
+		if (m_DecayingBits[w])
+			for (std::size_t i = w * 64; i < std::min(m_Registers.size(), w * 64 + 64); ++i)
+				SetDecaying(i, m_Registers[i].CatchUp(m_iTick));
+}
+
+void CRegisterLogger::SerializeState(CStateArchive &ar)		// // //
+{
+	ar.Check(m_Registers.size(), "register count");
+
+	CatchUpAll();
+	for (const auto &r : m_Ranges)
+		for (std::size_t i = r.Offset; i <= r.Offset + (r.High - r.Low); ++i) {
+			m_Registers[i].SerializeState(ar);
+			m_Registers[i].m_iTick = m_iTick;		// loaded clocks are up to date
+			SetDecaying(i, m_Registers[i].CatchUp(m_iTick));
+		}
+
+	ar(m_iPort, m_bAutoIncrement, m_bBlocked);
+	SetPort(m_iPort);
 }
 
 
@@ -98,7 +173,7 @@ CRegisterLoggerBlock::CRegisterLoggerBlock(CRegisterLogger &Logger) :
 
 CRegisterLoggerBlock::~CRegisterLoggerBlock()
 {
-	m_Logger.m_iPort = m_iPort;
+	m_Logger.SetPort(m_iPort);		// // //
 	m_Logger.m_bAutoIncrement = m_bAutoIncrement;
 	m_Logger.m_bBlocked = m_bBlocked;
 }
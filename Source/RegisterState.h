@@ -23,13 +23,19 @@
 
 #pragma once
 
-#include <unordered_map>
+#include <vector>		// // //
+#include <optional>		// // //
+#include <cstdint>
+
+class CStateArchive;		// // //
 
 /*!
 	\brief A class which manages writes to a single APU register.
 */
 class CRegisterState
 {
+	friend class CRegisterLogger;		// // //
+
 public:
 	/*!	\brief Constructor of the register state. */
 	CRegisterState() : m_iValue(0), m_iWriteClock(0), m_iNewClock(0) { }
@@ -58,14 +64,29 @@ public:
 
 	/*!	\brief Steps one tick and updates the register state's time information. */
 	void Step() { if (m_iWriteClock) --m_iWriteClock; if (m_iNewClock) --m_iNewClock; }
+	/*!	\brief Saves or loads the register state.
+		\param ar The state archive. */
+	void SerializeState(CStateArchive &ar);		// // //
+
+	/*!	\brief Obtains a copy of the register state with the time information brought up to date.
+		\param Tick The current tick count of the register logger.
+		\return The decayed register state. */
+	CRegisterState Decayed(uint32_t Tick) const;		// // //
 
 public:
 	static const unsigned int DECAY_RATE = 15;
 
+private:
+	/*!	\brief Applies the ticks elapsed since the register was last brought up to date.
+		\param Tick The current tick count of the register logger.
+		\return Whether the register is still decaying. */
+	bool CatchUp(uint32_t Tick);		// // //
+
 private:
 	uint8_t m_iValue;
 	unsigned int m_iWriteClock;
 	unsigned int m_iNewClock;
+	uint32_t m_iTick = 0;		// // // tick count of the logger at the last catch-up
 };
 
 /*!
@@ -106,17 +127,42 @@ public:
 	bool Write(uint8_t Value);
 
 	/*!	\brief Obtains a register object.
+		\details The returned copy has its time information brought up to date; the logger itself
+		is not modified, so this may be called from outside the audio thread.
 		\param Address The address value of the register.
-		\param The register state object, or nullptr if the given address does not exist. */
-	CRegisterState *GetRegister(unsigned Address);
+		\param The register state, or nothing if the given address does not exist. */
+	std::optional<CRegisterState> GetRegister(unsigned Address) const;		// // //
 
-	/*!	\brief Steps one tick and updates the time information of all registers. */
+	/*!	\brief Steps one tick and updates the time information of all registers.
+		\details Registers are only updated when they are written to, and decaying registers
+		once every DECAY_RATE ticks, so this does not depend on the number of registers. */
 	void Step();
+	/*!	\brief Saves or loads the states of all registers and the address port.
+		\details The same register ranges must have been added before loading.
+		\param ar The state archive. */
+	void SerializeState(CStateArchive &ar);		// // //
+
+private:
+	static constexpr std::size_t NO_REGISTER = static_cast<std::size_t>(-1);		// // //
+
+	std::size_t FindRange(unsigned Address) const;		// // //
+	void SetDecaying(std::size_t Index, bool Decaying);		// // //
+	void CatchUpAll();		// // //
 
 protected:
-	std::unordered_map<unsigned, CRegisterState> m_mRegister;
-	std::unordered_map<unsigned, unsigned> m_mWarpValues;
+	// // // A contiguous range of registers, which the address port wraps around
+	struct stRegisterRange {
+		unsigned Low;
+		unsigned High;
+		std::size_t Offset;		// Index of the first register in m_Registers
+	};
+
+	std::vector<stRegisterRange> m_Ranges;		// // // sorted by address
+	std::vector<CRegisterState> m_Registers;		// // //
+	std::vector<uint64_t> m_DecayingBits;		// // // registers that may have running decay clocks
+	uint32_t m_iTick = 0;		// // //
 	unsigned int m_iPort;
+	std::size_t m_iPortRange = NO_REGISTER;		// // // range containing the port
 	bool m_bAutoIncrement;
 	bool m_bBlocked;
 };
@@ -122,6 +122,24 @@ void CSeqInstHandler::UpdateInstrument()
 	}
 }
 
+void CSeqInstHandler::SerializeState(CStateArchive &ar, std::shared_ptr<const CInstrument> pInst)		// // //
+{
+	CInstHandler::SerializeState(ar, pInst);
+	ar(m_iDutyParam);
+
+	auto pSeqInst = std::dynamic_pointer_cast<const CSeqInstrument>(m_pInstrument);
+	for (auto &[seqType, info] : m_SequenceInfo) {
+		bool HasSequence = info.m_pSequence != nullptr;
+		ar(HasSequence);
+		if (ar.IsLoading()) {
+			info.m_pSequence = HasSequence && pSeqInst ? pSeqInst->GetSequence(seqType) : nullptr;
+			if (HasSequence && !info.m_pSequence)
+				throw CStateArchiveException {"State snapshot does not match the current instrument"};
+		}
+		ar(info.m_iSeqState, info.m_iSeqPointer);
+	}
+}
+
 bool CSeqInstHandler::ProcessSequence(const CSequence &Seq, int Pos)
 {
 	int Value = Seq.GetItem(Pos);
@@ -64,6 +64,15 @@ void CSeqInstHandlerN163::UpdateInstrument()
 	m_bForceUpdate = false;
 }
 
+void CSeqInstHandlerN163::SerializeState(CStateArchive &ar, std::shared_ptr<const CInstrument> pInst)		// // //
+{
+	CSeqInstHandler::SerializeState(ar, pInst);
+	bool Swapped = m_pBufferCurrent != m_cBuffer;
+	ar(m_cBuffer, Swapped, m_bForceUpdate);
+	m_pBufferCurrent = m_cBuffer + (Swapped ? CInstrumentN163::MAX_WAVE_SIZE : 0);
+	m_pBufferPrevious = m_cBuffer + (Swapped ? 0 : CInstrumentN163::MAX_WAVE_SIZE);
+}
+
 void CSeqInstHandlerN163::RequestWaveUpdate()
 {
 	m_bForceUpdate = true;
@@ -34,3 +34,9 @@ bool CSeqInstHandlerSawtooth::IsDutyIgnored() const
 {
 	return m_bIgnoreDuty;
 }
+
+void CSeqInstHandlerSawtooth::SerializeState(CStateArchive &ar, std::shared_ptr<const CInstrument> pInst)		// // //
+{
+	CSeqInstHandler::SerializeState(ar, pInst);
+	ar(m_bIgnoreDuty);
+}
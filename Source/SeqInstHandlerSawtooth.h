@@ -48,6 +48,7 @@ public:
 	/*!	\brief Queries whether the duty sequence should be ignored when calculating the volume.
 		\return Whether the current instrument uses a 64-step volume sequence. */
 	bool IsDutyIgnored() const;
+	void SerializeState(CStateArchive &ar, std::shared_ptr<const CInstrument> pInst) override;		// // //
 
 private:
 	bool m_bIgnoreDuty = false;
@@ -60,12 +60,8 @@ const CTrackData *CSongData::GetTrack(stChannelID chan) const {
 bool CSongData::IsPatternInUse(stChannelID Channel, unsigned int Pattern) const
 {
 	// Check if pattern is addressed in frame list
-	if (Pattern < MAX_PATTERN)
-		if (auto *pTrack = GetTrack(Channel))
-			for (unsigned i = 0; i < GetFrameCount(); ++i)
-				if (pTrack->GetFramePattern(i) == Pattern)
-					return true;
-	return false;
+	auto *pTrack = GetTrack(Channel);		// // //
+	return pTrack && pTrack->IsPatternInUse(Pattern);
 }
 
 unsigned CSongData::GetFreePatternIndex(stChannelID Channel, unsigned Whence) const {		// // //
@@ -154,6 +150,9 @@ void CSongData::SetPatternLength(unsigned int Length)
 void CSongData::SetFrameCount(unsigned int Count)
 {
 	m_iFrameCount = Count;
+	VisitTracks([&] (CTrackData &track) {		// // //
+		track.SetFrameCount(Count);
+	});
 }
 
 void CSongData::SetSongSpeed(unsigned int Speed)
@@ -256,8 +255,10 @@ void CSongData::InsertRow(stChannelID Chan, unsigned Frame, unsigned Row) {
 
 void CSongData::CopyTrack(stChannelID Chan, const CSongData &From, stChannelID ChanFrom) {
 	if (auto *lhs = GetTrack(Chan))
-		if (auto *rhs = From.GetTrack(ChanFrom))
+		if (auto *rhs = From.GetTrack(ChanFrom)) {
 			*lhs = *rhs;
+			lhs->SetFrameCount(GetFrameCount());		// // // pattern uses follow this song's frame count
+		}
 }
 
 void CSongData::SwapChannels(stChannelID First, stChannelID Second)		// // //
@@ -232,30 +232,93 @@ void stChannelState::HandleSxxCommand(unsigned char xy) {
 }
 
 
+bool stChannelState::CanMerge(bool MaskFDS) const {		// // //
+	// echo buffer entries still waiting for an earlier note
+	for (int i = 0; i < std::min(BufferPos, (int)std::size(Echo)); ++i)
+		if (Echo[i] >= ECHO_BUFFER_ECHO && Echo[i] < ECHO_BUFFER_ECHO + (int)ECHO_BUFFER_LENGTH)
+			return false;
+
+	const int Volume = Effect[value_cast(ft0cc::doc::effect_type::VOLUME)];
+	const int NoteCut = Effect[value_cast(ft0cc::doc::effect_type::NOTE_CUT)];
+	if (Effect_LengthCounter != -1 || Volume != -1 || NoteCut != -1)
+		if (Effect_LengthCounter == -1 || Volume == -1 ||
+			(NoteCut == -1 && Effect_LengthCounter != 0xE0 && IsAPUTriangle(ChannelID)))
+			return false;
+
+	const int ModSpeed = Effect[value_cast(ft0cc::doc::effect_type::FDS_MOD_SPEED_HI)];
+	if (ModSpeed != -1 || Effect_AutoFMMult != -1 || MaskFDS)
+		if (ModSpeed == -1 || Effect_AutoFMMult == -1)
+			return false;
+
+	return true;
+}
+
+void stChannelState::Merge(const stChannelState &Other) {		// // //
+	const auto VOLUME = value_cast(ft0cc::doc::effect_type::VOLUME);
+	const auto NOTE_CUT = value_cast(ft0cc::doc::effect_type::NOTE_CUT);
+	const auto MOD_SPEED = value_cast(ft0cc::doc::effect_type::FDS_MOD_SPEED_HI);
+
+	if (Effect_LengthCounter == -1) {
+		Effect_LengthCounter = Other.Effect_LengthCounter;
+		Effect[VOLUME] = Other.Effect[VOLUME];
+		Effect[NOTE_CUT] = Other.Effect[NOTE_CUT];
+	}
+	if (Effect_AutoFMMult == -1) {
+		Effect_AutoFMMult = Other.Effect_AutoFMMult;
+		Effect[MOD_SPEED] = Other.Effect[MOD_SPEED];
+	}
+	for (std::size_t i = 0; i < std::size(Effect); ++i)
+		if (Effect[i] == -1 && i != VOLUME && i != NOTE_CUT && i != MOD_SPEED)
+			Effect[i] = Other.Effect[i];
+
+	if (Instrument == MAX_INSTRUMENTS)
+		Instrument = Other.Instrument;
+	if (Volume == MAX_VOLUME)
+		Volume = Other.Volume;
+
+	for (int i = BufferPos; i < (int)std::size(Echo); ++i) {
+		Echo[i] = Other.Echo[i - BufferPos];
+		Transpose[i] = Other.Transpose[i - BufferPos];
+	}
+	BufferPos += Other.BufferPos;
+}
+
+
 
 void CSongState::Retrieve(const CFamiTrackerModule &modfile, unsigned Track, unsigned Frame, unsigned Row) {
 	CConstSongView SongView {modfile.GetChannelOrder().Canonicalize(), *modfile.GetSong(Track), false};
-	const auto &song = SongView.GetSong();
 
+	Reset(SongView);		// // //
+	ScanBackward(modfile, SongView, Frame, Row, { });
+	Finish(modfile, SongView.GetSong());
+}
+
+void CSongState::Retrieve(const CFamiTrackerModule &modfile, unsigned Track, unsigned Frame, unsigned Row, CSongStateCache &cache) {		// // //
+	CConstSongView SongView {modfile.GetChannelOrder().Canonicalize(), *modfile.GetSong(Track), false};
+
+	Reset(SongView);
+	ScanBackward(modfile, SongView, Frame, Row, cache.Prepare(modfile, Track, SongView, Frame));
+	Finish(modfile, SongView.GetSong());
+}
+
+void CSongState::Reset(const CConstSongView &view) {		// // //
 	State.clear();
-	SongView.GetChannelOrder().ForeachChannel([&] (stChannelID id) {
+	view.GetChannelOrder().ForeachChannel([&] (stChannelID id) {
 		State.try_emplace(id, stChannelState { });
 	});
+	Tempo = -1;
+	Speed = -1;
+	GroovePos = -1;
+	TotalRows = 0;
+	MaskFDS = false;
+	Halted = false;
+}
 
-	int totalRows = 0;
-
-	bool maskFDS = false;
-	bool doHalt = false;
+void CSongState::ScanRows(const CFamiTrackerModule &modfile, const CConstSongView &view, unsigned Frame, unsigned Rows) {		// // //
+	const auto &song = view.GetSong();
 
-	while (true) {
-		if (Row)
-			--Row;
-		else if (Frame)
-			Row = SongView.GetFrameLength(--Frame) - 1;
-		else
-			break;
-
-		SongView.ForeachTrack([&] (const CTrackData &track, stChannelID c) {
+	for (unsigned Row = Rows; Row-- > 0; ) {
+		view.ForeachTrack([&] (const CTrackData &track, stChannelID c) {
 			stChannelState &chState = State.find(c)->second;
 			int EffColumns = track.GetEffectColumnCount();
 			const auto &Note = track.GetPatternOnFrame(Frame).GetNoteOn(Row);		// // //
@@ -274,7 +337,7 @@ void CSongState::Retrieve(const CFamiTrackerModule &modfile, unsigned Track, uns
 				case ft0cc::doc::effect_type::JUMP: case ft0cc::doc::effect_type::SKIP: // no true backward iterator
 					break;
 				case ft0cc::doc::effect_type::HALT:
-					doHalt = true;
+					Halted = true;
 					break;
 				case ft0cc::doc::effect_type::SPEED:
 					if (Speed == -1 && (cmd.param < modfile.GetSpeedSplitPoint() || song.GetSongTempo() == 0)) {
@@ -286,7 +349,7 @@ void CSongState::Retrieve(const CFamiTrackerModule &modfile, unsigned Track, uns
 					break;
 				case ft0cc::doc::effect_type::GROOVE:
 					if (GroovePos == -1 && cmd.param < MAX_GROOVE && modfile.HasGroove(cmd.param)) {
-						GroovePos = totalRows + 1;
+						GroovePos = TotalRows + 1;
 						Speed = cmd.param;
 					}
 					break;
@@ -302,15 +365,15 @@ void CSongState::Retrieve(const CFamiTrackerModule &modfile, unsigned Track, uns
 					break;
 				case ft0cc::doc::effect_type::FDS_MOD_SPEED_HI:
 					if (cmd.param <= 0x0F)
-						maskFDS = true;
-					else if (!maskFDS && chState.Effect[value_cast(cmd.fx)] == -1) {
+						MaskFDS = true;
+					else if (!MaskFDS && chState.Effect[value_cast(cmd.fx)] == -1) {
 						chState.Effect[value_cast(cmd.fx)] = cmd.param;
 						if (chState.Effect_AutoFMMult == -1)
 							chState.Effect_AutoFMMult = -2;
 					}
 					break;
 				case ft0cc::doc::effect_type::FDS_MOD_SPEED_LO:
-					maskFDS = true;
+					MaskFDS = true;
 					break;
 				case ft0cc::doc::effect_type::DUTY_CYCLE:
 					if (c.Chip == sound_chip_t::VRC7)		// // // 050B
@@ -331,14 +394,52 @@ void CSongState::Retrieve(const CFamiTrackerModule &modfile, unsigned Track, uns
 				}
 			}
 		});
-		if (doHalt)
-			break;
-		++totalRows;
+		if (Halted)
+			return;
+		++TotalRows;
 	}
+}
+
+void CSongState::ScanBackward(const CFamiTrackerModule &modfile, const CConstSongView &view, unsigned Frame, unsigned Row,
+	const std::vector<CSongState> &checkpoints) {		// // //
+	// checkpoints[f] holds the state at the start of frame f
+	while (true) {
+		ScanRows(modfile, view, Frame, Row);
+		if (Halted || !Frame)
+			return;
+		if (Frame < checkpoints.size() && Merge(checkpoints[Frame], view.GetSong()))
+			return;
+		Row = view.GetFrameLength(--Frame);
+	}
+}
+
+bool CSongState::Merge(const CSongState &Other, const CSongData &song) {		// // //
+	// with a zero tempo, the speed command sets the tempo only after the speed is known
+	if (song.GetSongTempo() == 0 && (Speed == -1) != (Tempo == -1))
+		return false;
+	for (const auto &[id, chState] : State)
+		if (!chState.CanMerge(MaskFDS))
+			return false;
+
+	for (auto &[id, chState] : State)
+		chState.Merge(Other.State.find(id)->second);
+	if (Tempo == -1)
+		Tempo = Other.Tempo;
+	if (GroovePos == -1) {
+		Speed = Other.Speed;
+		GroovePos = Other.GroovePos >= 0 ? Other.GroovePos + TotalRows : Other.GroovePos;
+	}
+	TotalRows += Other.TotalRows;
+	MaskFDS = MaskFDS || Other.MaskFDS;
+	Halted = Other.Halted;
+	return true;
+}
+
+void CSongState::Finish(const CFamiTrackerModule &modfile, const CSongData &song) {		// // //
 	if (GroovePos == -1 && song.GetSongGroove()) {
 		unsigned Index = song.GetSongSpeed();
 		if (Index < MAX_GROOVE && modfile.HasGroove(Index)) {
-			GroovePos = totalRows;
+			GroovePos = TotalRows;
 			Speed = Index;
 		}
 	}
@@ -365,3 +466,67 @@ std::string CSongState::GetChannelStateString(const CFamiTrackerModule &modfile,
 
 	return str;
 }
+
+
+
+void CSongStateCache::Clear() {		// // //
+	tracks_.clear();
+}
+
+bool CSongStateCache::stTrackCache::operator==(const stTrackCache &other) const {
+	return Channels == other.Channels && EffColumns == other.EffColumns && PatternLength == other.PatternLength &&
+		Tempo == other.Tempo && SplitPoint == other.SplitPoint && Grooves == other.Grooves;
+}
+
+bool CSongStateCache::stTrackCache::operator!=(const stTrackCache &other) const {
+	return !operator==(other);
+}
+
+const std::vector<CSongState> &CSongStateCache::Prepare(const CFamiTrackerModule &modfile, unsigned Track, const CConstSongView &view, unsigned Frame) {
+	// song properties that the whole retrieved state depends on
+	const auto &song = view.GetSong();
+	stTrackCache key;
+	view.ForeachTrack([&] (const CTrackData &track, stChannelID c) {
+		key.Channels.push_back(c);
+		key.EffColumns.push_back(track.GetEffectColumnCount());
+	});
+	key.PatternLength = song.GetPatternLength();
+	key.Tempo = song.GetSongTempo();
+	key.SplitPoint = modfile.GetSpeedSplitPoint();
+	for (unsigned i = 0; i < MAX_GROOVE; ++i)
+		key.Grooves[i] = modfile.HasGroove(i);
+
+	auto &cache = tracks_[Track];
+	if (cache != key) {
+		cache = std::move(key);
+		cache.Checkpoints.emplace_back().Reset(view);
+	}
+
+	// a checkpoint depends on all frames before it
+	for (unsigned f = 0; f < Frame && f < cache.FrameVersions.size(); ++f)
+		if (cache.FrameVersions[f] != GetFrameVersions(view, f)) {
+			cache.FrameVersions.resize(f);
+			cache.Checkpoints.resize(f + 1);
+			break;
+		}
+
+	while (cache.FrameVersions.size() < Frame) {
+		unsigned f = cache.FrameVersions.size();
+		auto versions = GetFrameVersions(view, f);		// before the rows, which are written first
+		CSongState state;
+		state.Reset(view);
+		state.ScanBackward(modfile, view, f, view.GetFrameLength(f), cache.Checkpoints);
+		cache.FrameVersions.push_back(std::move(versions));
+		cache.Checkpoints.push_back(std::move(state));
+	}
+
+	return cache.Checkpoints;
+}
+
+std::vector<std::uint64_t> CSongStateCache::GetFrameVersions(const CConstSongView &view, unsigned Frame) {
+	std::vector<std::uint64_t> versions;
+	view.ForeachTrack([&] (const CTrackData &track) {
+		versions.push_back(track.GetPatternOnFrame(Frame).GetVersion());
+	});
+	return versions;
+}
@@ -30,8 +30,14 @@
 #include <string>
 #include <array>
 #include <map>
+#include <vector>		// // //
+#include <bitset>		// // //
+#include <cstdint>		// // //
 
 class CFamiTrackerModule;
+class CConstSongView;		// // //
+class CSongData;		// // //
+class CSongStateCache;		// // //
 namespace ft0cc::doc {
 struct effect_command;
 class pattern_note;
@@ -75,17 +81,68 @@ private:
 	void HandleExxCommand2A03(unsigned char param);
 	void HandleSxxCommand(unsigned char param);
 
+	// // // merging a state retrieved from an earlier position gives the same result as
+	// continuing to scan from there, unless effects that depend on each other are partially set
+	bool CanMerge(bool MaskFDS) const;
+	void Merge(const stChannelState &Other);
+
 	int BufferPos = 0;
 	std::array<int, ECHO_BUFFER_LENGTH> Transpose = { };
 };
 
 class CSongState {
+	friend class CSongStateCache;		// // //
+
 public:
 	void Retrieve(const CFamiTrackerModule &modfile, unsigned Track, unsigned Frame, unsigned Row);
+	void Retrieve(const CFamiTrackerModule &modfile, unsigned Track, unsigned Frame, unsigned Row, CSongStateCache &cache);		// // //
 	std::string GetChannelStateString(const CFamiTrackerModule &modfile, stChannelID chan) const;
 
 	std::map<stChannelID, stChannelState> State;
 	int Tempo = -1;
 	int Speed = -1;
 	int GroovePos = -1; // -1: disable groove
+
+private:
+	void Reset(const CConstSongView &view);		// // //
+	void ScanRows(const CFamiTrackerModule &modfile, const CConstSongView &view, unsigned Frame, unsigned Rows);
+	void ScanBackward(const CFamiTrackerModule &modfile, const CConstSongView &view, unsigned Frame, unsigned Row,
+		const std::vector<CSongState> &checkpoints);
+	bool Merge(const CSongState &Other, const CSongData &song);
+	void Finish(const CFamiTrackerModule &modfile, const CSongData &song);
+
+	int TotalRows = 0;		// // //
+	bool MaskFDS = false;
+	bool Halted = false;
+};
+
+// // // Song states at the start of each frame, used to retrieve the state at any row by
+// scanning at most one frame. Checkpoints are revalidated against the pattern versions
+// and dropped from the first frame that has been edited.
+class CSongStateCache {
+	friend class CSongState;
+
+public:
+	void Clear();
+
+private:
+	struct stTrackCache {
+		std::vector<stChannelID> Channels;
+		std::vector<unsigned> EffColumns;
+		unsigned PatternLength = 0;
+		unsigned Tempo = 0;
+		unsigned SplitPoint = 0;
+		std::bitset<MAX_GROOVE> Grooves;
+
+		bool operator==(const stTrackCache &other) const;
+		bool operator!=(const stTrackCache &other) const;
+
+		std::vector<std::vector<std::uint64_t>> FrameVersions;	// pattern versions of each scanned frame
+		std::vector<CSongState> Checkpoints;					// state at the start of each frame
+	};
+
+	const std::vector<CSongState> &Prepare(const CFamiTrackerModule &modfile, unsigned Track, const CConstSongView &view, unsigned Frame);
+	static std::vector<std::uint64_t> GetFrameVersions(const CConstSongView &view, unsigned Frame);
+
+	std::map<unsigned, stTrackCache> tracks_;
 };
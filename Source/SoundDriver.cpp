@@ -33,6 +33,7 @@
 #include "PlayerCursor.h"
 #include "SongState.h"
 #include "ChannelMap.h"
+#include "StateArchive.h"		// // //
 #include "Assertion.h"
 
 
@@ -147,6 +148,36 @@ void CSoundDriver::SetTempoCounter(std::shared_ptr<CTempoCounter> tempo) {
 		m_pTempoCounter->AssignModule(*modfile_);
 }
 
+void CSoundDriver::SerializeState(CStateArchive &ar) {		// // //
+	ar(m_bPlaying, m_bHaltRequest, m_iJumpToPattern, m_iSkipToRow, m_bDoHalt);
+
+	bool HasCursor = m_pPlayerCursor != nullptr;
+	unsigned Track = HasCursor ? m_pPlayerCursor->GetCurrentSong() : 0u;
+	ar(HasCursor, Track);
+	if (ar.IsLoading()) {
+		m_pPlayerCursor.reset();
+		if (HasCursor) {
+			const CSongData *pSong = modfile_ ? modfile_->GetSong(Track) : nullptr;
+			if (!pSong)
+				throw CStateArchiveException {"State snapshot does not match the current module"};
+			m_pPlayerCursor = std::make_unique<CPlayerCursor>(*pSong, Track);
+		}
+	}
+	if (m_pPlayerCursor)
+		m_pPlayerCursor->SerializeState(ar);
+
+	bool HasTempo = m_pTempoCounter != nullptr;
+	ar.Check(HasTempo, "tempo counter");
+	if (m_pTempoCounter)
+		m_pTempoCounter->SerializeState(ar);
+
+	for (auto &chip : chips_)
+		chip->SerializeState(ar);
+	ForeachTrack([&] (CChannelHandler &, CTrackerChannel &tr) {
+		tr.SerializeState(ar);
+	});
+}
+
 void CSoundDriver::Tick() {
 	if (IsPlaying())
 		PlayerTick();
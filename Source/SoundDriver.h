@@ -39,6 +39,7 @@ class CChipHandler;
 class CTrackerChannel;
 class CAPUInterface;
 class CSongState;
+class CStateArchive;		// // //
 namespace ft0cc::doc {
 struct effect_command;
 class pattern_note;
@@ -66,6 +67,7 @@ public:
 
 	void LoadSoundState(const CSongState &state);
 	void SetTempoCounter(std::shared_ptr<CTempoCounter> tempo);
+	void SerializeState(CStateArchive &ar);		// // //
 
 	void Tick();
 
@@ -69,6 +69,7 @@ CSoundGen depends on CFamiTrackerView for:
 #include "Instrument.h"
 #include "str_conv/str_conv.hpp"		// // //
 #include "BinaryFileStream.h"		// // //
+#include "RegisterState.h"		// // //
 
 // // // Log VGM output (port from sn7t when necessary)
 //#define WRITE_VGM
@@ -108,6 +109,7 @@ CSoundGen::CSoundGen() :
 	m_pAPU(std::make_unique<CAPU>()),		// // //
 	m_bHaltRequest(false),
 	m_pInstRecorder(std::make_unique<CInstrumentRecorder>(this)),		// // //
+	m_pSongStateCache(std::make_unique<CSongStateCache>()),		// // //
 	m_bWaveChanged(0),
 	m_iMachineType(machine_t::NTSC),
 	m_bRunning(false),
@@ -155,6 +157,9 @@ void CSoundGen::AssignModule(CFamiTrackerModule &modfile) {
 	m_pInstRecorder->AssignModule(modfile);
 	m_pSoundDriver->AssignModule(modfile);
 	m_pTempoCounter->AssignModule(modfile);
+
+	CSingleLock l(&m_csAPULock, TRUE);		// // //
+	m_pSongStateCache->Clear();		// checkpoints belong to the songs of the previous module
 }
 
 void CSoundGen::AssignView(CFamiTrackerView *pView)
@@ -611,7 +616,7 @@ void CSoundGen::ApplyGlobalState()		// // //
 	auto [Frame, Row] = IsPlaying() ? GetPlayerPos() : m_pTrackerView->GetSelectedPos();		// // //
 
 	CSongState state;
-	state.Retrieve(*m_pModule, GetPlayerTrack(), Frame, Row);
+	state.Retrieve(*m_pModule, GetPlayerTrack(), Frame, Row, *m_pSongStateCache);		// // //
 
 	m_pSoundDriver->LoadSoundState(state);
 
@@ -731,7 +736,7 @@ uint8_t CSoundGen::GetReg(sound_chip_t Chip, int Reg) const
 	return m_pAPU->GetReg(Chip, Reg);
 }
 
-CRegisterState *CSoundGen::GetRegState(sound_chip_t Chip, unsigned Reg) const		// // //
+std::optional<CRegisterState> CSoundGen::GetRegState(sound_chip_t Chip, unsigned Reg) const		// // //
 {
 	return m_pAPU->GetRegState(Chip, Reg);
 }
@@ -943,8 +948,7 @@ void CSoundGen::PlayPreviewSample(int Offset, int Pitch) {		// // //
 	int Loop = 0;
 	int Length = ((m_pPreviewSample->size() - 1) >> 4) - (Offset << 2);
 
-	if (auto *p2A03 = dynamic_cast<C2A03 *>(m_pAPU->GetSoundChip(sound_chip_t::APU)))		// // //
-		p2A03->WriteSample(std::move(m_pPreviewSample));		// // //
+	m_pAPU->WriteSample(std::move(m_pPreviewSample));		// // //
 
 	m_pAPU->Write(0x4010, Pitch | Loop);
 	m_pAPU->Write(0x4012, Offset);			// load address, start at $C000
@@ -33,6 +33,7 @@
 #include <vector>		// // //
 #include <map>		// // //
 #include <memory>		// // //
+#include <optional>		// // //
 #include "SoundGenBase.h"		// // //
 #include "APU/Types.h"
 #include "ft0cc/cpputil/fs.hpp"		// // //
@@ -80,6 +81,7 @@ class CPlayerCursor;		// // //
 class CSoundDriver;		// // //
 class CSoundChipSet;		// // //
 class CBinaryFileStream;		// // //
+class CSongStateCache;		// // //
 
 namespace ft0cc::doc {
 class dpcm_sample;
@@ -178,7 +180,7 @@ public:
 	int			GetNamcoChannelCount() const;		// // //
 
 	uint8_t		GetReg(sound_chip_t Chip, int Reg) const;
-	CRegisterState *GetRegState(sound_chip_t Chip, unsigned Reg) const;		// // //
+	std::optional<CRegisterState> GetRegState(sound_chip_t Chip, unsigned Reg) const;		// // //
 	double		GetChannelFrequency(sound_chip_t Chip, int Channel) const;		// // //
 	std::string	RecallChannelState(stChannelID Channel) const;		// // //
 
@@ -306,6 +308,7 @@ private:
 	std::shared_ptr<CWaveRenderer> m_pWaveRenderer;			// // //
 	std::shared_ptr<CBinaryFileStream> m_pRenderFile;				// // //
 	std::unique_ptr<CInstrumentRecorder> m_pInstRecorder;
+	std::unique_ptr<CSongStateCache> m_pSongStateCache;		// // //
 
 	std::map<stChannelID, bool> muted_;						// // //
 
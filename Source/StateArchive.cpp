@@ -0,0 +1,55 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "StateArchive.h"
+#include <algorithm>
+
+CStateArchive::CStateArchive(array_view<const std::byte> input) :
+	input_(input), loading_(true)
+{
+}
+
+bool CStateArchive::IsLoading() const noexcept {
+	return loading_;
+}
+
+std::vector<std::byte> CStateArchive::Release() {
+	return std::move(output_);
+}
+
+void CStateArchive::Finish() const {
+	if (loading_ && !input_.empty())
+		throw CStateArchiveException {"Unexpected data at the end of state snapshot"};
+}
+
+void CStateArchive::Transfer(void *p, std::size_t n) {
+	auto *bytes = static_cast<std::byte *>(p);
+	if (loading_) {
+		if (input_.size() < n)
+			throw CStateArchiveException {"Unexpected end of state snapshot"};
+		std::copy_n(input_.begin(), n, bytes);
+		input_.remove_front(n);
+	}
+	else
+		output_.insert(output_.end(), bytes, bytes + n);
+}
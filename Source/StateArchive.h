@@ -0,0 +1,94 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include "ft0cc/cpputil/array_view.hpp"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+class CStateArchiveException : public std::runtime_error {
+	using std::runtime_error::runtime_error;
+};
+
+// // // flat byte archive for emulation state snapshots
+//
+// Each object lists its state members once in a SerializeState method, which is used both
+// for saving and for loading. Members are stored as raw bytes, so a snapshot may only be
+// restored by the same build into objects configured the same way as the saved ones.
+class CStateArchive {
+public:
+	// Creates an archive that saves state
+	CStateArchive() = default;
+	// Creates an archive that loads state from a snapshot
+	explicit CStateArchive(array_view<const std::byte> input);
+
+	bool IsLoading() const noexcept;
+
+	// Saves or loads trivially copyable objects in order
+	template <typename... Ts>
+	void operator()(Ts &...xs) {
+		static_assert((... && std::is_trivially_copyable_v<Ts>), "State members must be trivially copyable");
+		(Transfer(std::addressof(xs), sizeof(Ts)), ...);
+	}
+
+	// Saves or loads the size of a vector followed by its elements
+	template <typename T>
+	void Vector(std::vector<T> &v) {
+		static_assert(std::is_trivially_copyable_v<T>, "State members must be trivially copyable");
+		std::uint32_t sz = static_cast<std::uint32_t>(v.size());
+		(*this)(sz);
+		if (loading_)
+			v.resize(sz);
+		Transfer(v.data(), sz * sizeof(T));
+	}
+
+	// Saves a value that is derived from the configuration of an object, or checks that the
+	// loaded value is identical
+	template <typename T>
+	void Check(const T &x, const char *what) {
+		T y = x;
+		(*this)(y);
+		if (loading_ && !(y == x))
+			throw CStateArchiveException {std::string {"State snapshot does not match the current "} + what};
+	}
+
+	// Returns the saved snapshot
+	std::vector<std::byte> Release();
+	// Throws if the loaded snapshot contains more data than what has been read
+	void Finish() const;
+
+private:
+	void Transfer(void *p, std::size_t n);
+
+private:
+	std::vector<std::byte> output_;
+	array_view<const std::byte> input_;
+	bool loading_ = false;
+};
@@ -24,6 +24,8 @@
 #include "FamiTrackerModule.h"
 #include "SongData.h"
 #include "SongState.h"
+#include "StateArchive.h"		// // //
+#include "FamiTrackerDefines.h"		// // //
 #include "ft0cc/doc/groove.hpp"
 
 // // // CTempoCounter
@@ -128,6 +130,24 @@ void CTempoCounter::LoadSoundState(const CSongState &state) {
 	SetupSpeed();
 }
 
+void CTempoCounter::SerializeState(CStateArchive &ar) {		// // //
+	// the current groove is stored as its index in the module
+	int Groove = -1;
+	if (m_pCurrentGroove && m_pModule)
+		for (int i = 0; i < MAX_GROOVE; ++i)
+			if (m_pModule->GetGroove(i) == m_pCurrentGroove) {
+				Groove = i;
+				break;
+			}
+	ar(Groove);
+	if (ar.IsLoading())
+		m_pCurrentGroove = Groove != -1 && m_pModule ? m_pModule->GetGroove(Groove) : nullptr;
+	if (ar.IsLoading() && Groove != -1 && !m_pCurrentGroove)
+		throw CStateArchiveException {"State snapshot does not match the current groove"};
+
+	ar(m_iTempo, m_iSpeed, m_iGroovePosition, m_iTempoAccum, m_iTempoDecrement, m_iTempoRemainder);
+}
+
 void CTempoCounter::SetupSpeed() {
 	if (m_iTempo) {		// // //
 		m_iTempoDecrement = (m_iTempo * 24) / m_iSpeed;
@@ -22,6 +22,7 @@
 
 #include "TempoDisplay.h"
 #include "TempoCounter.h"
+#include <utility>
 
 CTempoDisplay::CTempoDisplay(const CTempoCounter &cnt, unsigned rows) :
 	cnt_(&cnt),
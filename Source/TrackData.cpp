@@ -21,6 +21,7 @@
 */
 
 #include "TrackData.h"
+#include <algorithm>		// // //
 
 CPatternData &CTrackData::GetPattern(unsigned Pattern) {
 	return m_pPatternData.at(Pattern);
@@ -43,8 +44,30 @@ unsigned int CTrackData::GetFramePattern(unsigned Frame) const {
 }
 
 void CTrackData::SetFramePattern(unsigned Frame, unsigned Pattern) {
-	if (Frame < m_iFrameList.size())
+	if (Frame < m_iFrameList.size()) {
+		if (Frame < m_iFrameCount) {		// // //
+			if (m_iFrameList[Frame] < MAX_PATTERN)
+				--m_iPatternUses[m_iFrameList[Frame]];
+			if (Pattern < MAX_PATTERN)
+				++m_iPatternUses[Pattern];
+		}
 		m_iFrameList[Frame] = Pattern;
+	}
+}
+
+void CTrackData::SetFrameCount(unsigned Count) {		// // //
+	Count = std::min<unsigned>(Count, m_iFrameList.size());
+	for (unsigned i = Count; i < m_iFrameCount; ++i)
+		if (m_iFrameList[i] < MAX_PATTERN)
+			--m_iPatternUses[m_iFrameList[i]];
+	for (unsigned i = m_iFrameCount; i < Count; ++i)
+		if (m_iFrameList[i] < MAX_PATTERN)
+			++m_iPatternUses[m_iFrameList[i]];
+	m_iFrameCount = Count;
+}
+
+bool CTrackData::IsPatternInUse(unsigned Pattern) const {		// // //
+	return Pattern < MAX_PATTERN && m_iPatternUses[Pattern] > 0;
 }
 
 unsigned CTrackData::GetEffectColumnCount() const {
@@ -37,6 +37,9 @@ public:
 	unsigned int GetFramePattern(unsigned Frame) const;
 	void SetFramePattern(unsigned Frame, unsigned Pattern);
 
+	void SetFrameCount(unsigned Count);		// // //
+	bool IsPatternInUse(unsigned Pattern) const;		// // //
+
 	unsigned GetEffectColumnCount() const;
 	void SetEffectColumnCount(unsigned Count);
 
@@ -75,5 +78,7 @@ public:
 private:
 	std::array<CPatternData, MAX_PATTERN> m_pPatternData = { };
 	std::array<unsigned int, MAX_FRAMES> m_iFrameList = { };
+	std::array<unsigned short, MAX_PATTERN> m_iPatternUses = {1u};		// // // number of visible frames using each pattern
+	unsigned m_iFrameCount = 1;		// // //
 	unsigned char m_iEffectColumns = 1;		// // //
 };
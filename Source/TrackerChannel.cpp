@@ -24,6 +24,7 @@
 #include "Instrument.h"		// // //
 #include "APU/Types.h"		// // //
 #include "FamiTrackerDefines.h"		// // //
+#include "StateArchive.h"		// // //
 
 /*
  * This class serves as the interface between the UI and the sound player for each channel
@@ -98,6 +99,13 @@ int CTrackerChannel::GetPitch() const
 	return m_iPitch;
 }
 
+void CTrackerChannel::SerializeState(CStateArchive &ar)		// // //
+{
+	std::lock_guard<std::mutex> lock {m_csNoteLock};
+
+	ar(m_Note, m_iNotePriority, m_iVolumeMeter, m_iPitch, m_bNewNote);
+}
+
 bool IsInstrumentCompatible(sound_chip_t Chip, inst_type_t Type) {		// // //
 	switch (Chip) {
 	case sound_chip_t::APU:
@@ -59,12 +59,14 @@ void CTransposeDlg::Transpose(int Trsp, CSongData &song) {
 	song.VisitPatterns([&] (CPatternData &pat, stChannelID c, unsigned) {
 		if (IsAPUNoise(c) || IsDPCM(c))
 			return;
-		for (ft0cc::doc::pattern_note &note : pat.Rows()) {
+		for (unsigned row = 0, n = pat.GetCapacity(); row < n; ++row) {		// // //
+			auto note = pat.GetNoteOn(row);
 			auto inst = note.inst();
 			if (inst != MAX_INSTRUMENTS && inst != HOLD_INSTRUMENT && is_note(note.note()) && !s_bDisableInst[inst]) {
 				int MIDI = std::clamp(note.midi_note() + Trsp, 0, NOTE_COUNT - 1);
 				note.set_oct(ft0cc::doc::oct_from_midi(MIDI));
 				note.set_note(ft0cc::doc::pitch_from_midi(MIDI));
+				pat.SetNoteOn(row, note);
 			}
 		}
 	});
@@ -22,6 +22,7 @@
 
 #include "WaveRenderer.h"
 #include "NumConv.h"
+#include "StateArchive.h"		// // //
 
 CWaveRenderer::~CWaveRenderer() {
 	CloseOutputStream();
@@ -34,11 +35,28 @@ void CWaveRenderer::SetOutputStream(std::unique_ptr<COutputWaveStream> pWave) {
 void CWaveRenderer::CloseOutputStream() {
 	if (m_pWaveStream)
 		m_pWaveStream.reset();
+	m_StemStreams.clear();		// // //
+}
+
+void CWaveRenderer::SetStemStream(stChannelID Channel, std::unique_ptr<COutputWaveStream> pWave) {		// // //
+	if (pWave)
+		m_StemStreams[Channel] = std::move(pWave);
+	else
+		m_StemStreams.erase(Channel);
+}
+
+std::vector<stChannelID> CWaveRenderer::GetStemChannels() const {		// // //
+	std::vector<stChannelID> Channels;
+	for (const auto &x : m_StemStreams)
+		Channels.push_back(x.first);
+	return Channels;
 }
 
 void CWaveRenderer::Start() {
 	m_bStarted = true;
 	m_pWaveStream->WriteWAVHeader();
+	for (auto &x : m_StemStreams)		// // //
+		x.second->WriteWAVHeader();
 }
 
 bool CWaveRenderer::ShouldStartPlayer() {
@@ -77,6 +95,11 @@ int CWaveRenderer::GetRenderTrack() const {
 	return m_iRenderTrack;
 }
 
+void CWaveRenderer::SerializeState(CStateArchive &ar) {		// // //
+	ar(m_bStarted, m_bFinished, m_bRequestRenderStop, m_bStoppingRender,
+		m_iDelayedStart, m_iDelayedEnd, m_iRenderTrack, m_iRenderRowCount);
+}
+
 void CWaveRenderer::FinishRender() {
 	m_bRequestRenderStop = true;
 }
@@ -105,6 +128,12 @@ int CWaveRendererTick::GetProgressPercent() const {
 	return Finished() ? 100 : m_iRenderTick * 100 / m_iTicksToRender;
 }
 
+void CWaveRendererTick::SerializeState(CStateArchive &ar) {		// // //
+	CWaveRenderer::SerializeState(ar);
+	ar.Check(m_iTicksToRender, "render length");
+	ar(m_iRenderTick);
+}
+
 
 
 CWaveRendererRow::CWaveRendererRow(unsigned Rows) :
@@ -127,3 +156,9 @@ std::string CWaveRendererRow::GetProgressString() const {
 int CWaveRendererRow::GetProgressPercent() const {
 	return Finished() ? 100 : m_iRenderRow * 100 / m_iRowsToRender;
 }
+
+void CWaveRendererRow::SerializeState(CStateArchive &ar) {		// // //
+	CWaveRenderer::SerializeState(ar);
+	ar.Check(m_iRowsToRender, "render length");
+	ar(m_iRenderRow);
+}
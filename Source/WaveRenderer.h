@@ -26,8 +26,13 @@
 #include <memory>
 #include <cstdint>
 #include <string>
+#include <map>		// // //
+#include <vector>		// // //
 #include "ft0cc/cpputil/array_view.hpp"
 #include "WaveStream.h"
+#include "APU/Types.h"		// // //
+
+class CStateArchive;		// // //
 
 class CWaveRenderer {
 public:
@@ -36,12 +41,23 @@ public:
 	void SetOutputStream(std::unique_ptr<COutputWaveStream> pWave);
 	void CloseOutputStream();
 
+	// // // Adds a stream receiving the output of a single channel; requires a renderer that
+	// supports stems, such as COfflineRenderer
+	void SetStemStream(stChannelID Channel, std::unique_ptr<COutputWaveStream> pWave);
+	std::vector<stChannelID> GetStemChannels() const;
+
 	template <typename T>
 	void FlushBuffer(array_view<const T> Buf) const {
 		if (m_pWaveStream)
 			m_pWaveStream->WriteSamples(Buf);
 	}
 
+	template <typename T>
+	void FlushStemBuffer(stChannelID Channel, array_view<const T> Buf) const {		// // //
+		if (auto it = m_StemStreams.find(Channel); it != m_StemStreams.end())
+			it->second->WriteSamples(Buf);
+	}
+
 	void Start();
 	virtual void Tick() { }
 	virtual void StepRow() { }
@@ -58,11 +74,15 @@ public:
 	virtual std::string GetProgressString() const = 0;
 	virtual int GetProgressPercent() const = 0;
 
+	// // // saves or loads the render progress, but not the output stream
+	virtual void SerializeState(CStateArchive &ar);
+
 protected:
 	void FinishRender();
 
 private:
 	std::unique_ptr<COutputWaveStream> m_pWaveStream;
+	std::map<stChannelID, std::unique_ptr<COutputWaveStream>> m_StemStreams;		// // //
 	bool m_bStarted = false;
 	bool m_bFinished = false;
 
@@ -82,6 +102,7 @@ private:
 	void Tick() override;
 	std::string GetProgressString() const override;
 	int GetProgressPercent() const override;
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 private:
 	unsigned m_iTicksToRender;
@@ -97,6 +118,7 @@ private:
 	void StepRow() override;
 	std::string GetProgressString() const override;
 	int GetProgressPercent() const override;
+	void SerializeState(CStateArchive &ar) override;		// // //
 
 private:
 	unsigned m_iRowsToRender;
@@ -39,7 +39,8 @@ CInputWaveStream::CInputWaveStream(std::shared_ptr<CBinaryReader> file) : file_(
 
 
 COutputWaveStream::COutputWaveStream(std::shared_ptr<CBinaryWriter> file, const CWaveFileFormat &fmt) :
-	file_(std::move(file)), fmt_(fmt), start_pos_(file_->GetWriterPos())
+	file_(std::move(file)), fmt_(fmt), start_pos_(file_->GetWriterPos()),
+	buffer_(BLOCK_SIZE * sizeof(std::uint64_t))		// // //
 {
 	Assert(fmt.Format == CWaveFileFormat::format_code::pcm || fmt.Format == CWaveFileFormat::format_code::ieee_float);
 }
@@ -28,6 +28,8 @@
 #include <type_traits>
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <vector>
 #include "ft0cc/cpputil/array_view.hpp"
 #include "BinaryStream.h"
 
@@ -97,6 +99,22 @@ T convert_sample(U x, unsigned /*sigbits*/) {
 	return static_cast<T>(x);
 }
 
+// // // unsigned integer type holding the representation of a sample
+template <typename T>
+struct sample_bits {
+	using type = std::make_unsigned_t<T>;
+};
+
+template <>
+struct sample_bits<float> {
+	using type = std::uint32_t;
+};
+
+template <>
+struct sample_bits<double> {
+	using type = std::uint64_t;
+};
+
 } // namespace details
 
 struct CWaveFileFormat {
@@ -137,29 +155,27 @@ public:
 
 	template <typename T>
 	void WriteSamples(array_view<const T> samples) {
-		for (T x : samples) {
-			switch (fmt_.Format) {
-			case CWaveFileFormat::format_code::pcm:
-				if (fmt_.SampleSize <= 8)
-					DoWriteSample(details::convert_sample<std::uint8_t>(x, fmt_.SampleSize));
-				else if (fmt_.SampleSize <= 16)
-					DoWriteSample(details::convert_sample<std::int16_t>(x, fmt_.SampleSize));
-				else if (fmt_.SampleSize <= 32)
-					DoWriteSample(details::convert_sample<std::int32_t>(x, fmt_.SampleSize));
-//				else if (fmt_.SampleSize <= 64)
-//					DoWriteSample(details::convert_sample<std::int64_t>(x, fmt_.SampleSize));
-				break;
-			case CWaveFileFormat::format_code::ieee_float:
-				if (fmt_.SampleSize == 32)
-					DoWriteSample(details::convert_sample<float>(x, fmt_.SampleSize));
-				else if (fmt_.SampleSize == 64)
-					DoWriteSample(details::convert_sample<double>(x, fmt_.SampleSize));
-//				else if (fmt_.SampleSize == 80)
-//					DoWriteSample(details::convert_sample<long double>(x, fmt_.SampleSize));
-				break;
-			default:
-				return;
-			}
+		switch (fmt_.Format) {		// // // select the conversion once per block
+		case CWaveFileFormat::format_code::pcm:
+			if (fmt_.SampleSize <= 8)
+				WriteSampleBlocks<std::uint8_t>(samples);
+			else if (fmt_.SampleSize <= 16)
+				WriteSampleBlocks<std::int16_t>(samples);
+			else if (fmt_.SampleSize <= 32)
+				WriteSampleBlocks<std::int32_t>(samples);
+//			else if (fmt_.SampleSize <= 64)
+//				WriteSampleBlocks<std::int64_t>(samples);
+			break;
+		case CWaveFileFormat::format_code::ieee_float:
+			if (fmt_.SampleSize == 32)
+				WriteSampleBlocks<float>(samples);
+			else if (fmt_.SampleSize == 64)
+				WriteSampleBlocks<double>(samples);
+//			else if (fmt_.SampleSize == 80)
+//				WriteSampleBlocks<long double>(samples);
+			break;
+		default:
+			return;
 		}
 
 		write_count_ += fmt_.BytesPerSample() * samples.size();
@@ -167,41 +183,47 @@ public:
 	}
 
 private:
-	template <typename T>
-	void DoWriteSample(T x) {
-		if constexpr (std::is_same_v<T, float>) {
-			static_assert(sizeof(float) == sizeof(std::int32_t));
-			union {
-				float f;
-				std::int32_t i;
-			} u = {x};
-			return DoWriteSample(u.i);
-		}
-		else if constexpr (std::is_same_v<T, double>) {
-			static_assert(sizeof(double) == sizeof(std::int64_t));
-			union {
-				double f;
-				std::int64_t i;
-			} u = {x};
-			return DoWriteSample(u.i);
-		}
-		else if constexpr (std::is_integral_v<T>) {
-			if constexpr (sizeof(T) == sizeof(std::uint8_t))
-				file_->WriteInt<std::uint8_t>(x);
-			else if constexpr (sizeof(T) == sizeof(std::int16_t))
-				file_->WriteInt<std::int16_t>(x);
-			else if constexpr (sizeof(T) == sizeof(std::int32_t))
-				file_->WriteInt<std::int32_t>(x);
-			else {
-				auto x2 = static_cast<std::make_unsigned_t<T>>(x) >> (8 * (sizeof(T) - fmt_.BytesPerSample()));
-				for (std::size_t i = 0; i < fmt_.BytesPerSample(); ++i) {
-					file_->WriteInt<std::uint8_t>(static_cast<std::uint8_t>(x2 & 0xFFu));
-					x2 >>= 8;
+	static constexpr std::size_t BLOCK_SIZE = 4096u;		// // // samples converted per write
+
+	// // // Converts samples to U, then writes the most significant bytes in little-endian order
+	template <typename U, typename T>
+	void WriteSampleBlocks(array_view<const T> samples) {
+		using bits_t = typename details::sample_bits<U>::type;
+		static_assert(sizeof(bits_t) == sizeof(U));
+
+		const unsigned sigbits = fmt_.SampleSize;
+		const std::size_t bytes = fmt_.BytesPerSample();
+		const unsigned shift = static_cast<unsigned>(sizeof(U) - bytes) * 8u;
+
+		while (!samples.empty()) {
+			const std::size_t n = std::min(samples.size(), BLOCK_SIZE);
+			std::byte *out = buffer_.data();
+			if (bytes == sizeof(U))
+				for (std::size_t i = 0; i < n; ++i) {
+					bits_t x = to_bits<bits_t>(details::convert_sample<U>(samples[i], sigbits));
+					for (std::size_t b = 0; b < sizeof(U); ++b)
+						*out++ = static_cast<std::byte>(x >> (b * 8));
+				}
+			else
+				for (std::size_t i = 0; i < n; ++i) {
+					bits_t x = to_bits<bits_t>(details::convert_sample<U>(samples[i], sigbits)) >> shift;
+					for (std::size_t b = 0; b < bytes; ++b)
+						*out++ = static_cast<std::byte>(x >> (b * 8));
 				}
-			}
+			file_->WriteBuffer({buffer_.data(), static_cast<std::size_t>(out - buffer_.data())});
+			samples.remove_front(n);
+		}
+	}
+
+	template <typename Bits, typename U>
+	static Bits to_bits(U x) noexcept {
+		if constexpr (std::is_floating_point_v<U>) {
+			Bits y;
+			std::memcpy(&y, &x, sizeof(y));
+			return y;
 		}
 		else
-			file_->WriteBytes(byte_view(x));
+			return static_cast<Bits>(x);
 	}
 
 	std::shared_ptr<CBinaryWriter> file_;
@@ -209,4 +231,5 @@ private:
 	std::size_t start_pos_;
 	std::size_t write_count_ = 0u;
 	std::size_t sample_count_ = 0u;
+	std::vector<std::byte> buffer_;		// // // staging buffer for WriteSampleBlocks
 };
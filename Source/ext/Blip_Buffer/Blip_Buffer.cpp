@@ -9,6 +9,21 @@
 #include <stdlib.h>
 #include <math.h>
 
+// // // SIMD kernels are available on x86
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define BLIP_X86
+	#include <emmintrin.h>
+	#include <immintrin.h>
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+		#define BLIP_TARGET_SSE2
+		#define BLIP_TARGET_AVX2
+	#else
+		#define BLIP_TARGET_SSE2 __attribute__((target("sse2")))
+		#define BLIP_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
 //#define DITHERING
 
 /* Copyright (C) 2003-2006 Shay Green. This module is free software; you
@@ -22,7 +37,7 @@ more details. You should have received a copy of the GNU Lesser General
 Public License along with this module; if not, write to the Free Software
 Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA */
 
-int const buffer_extra = blip_widest_impulse_ + 2;
+int const buffer_extra = blip_widest_impulse_ + blip_kernel_pad_;		// // // room for the vector kernels
 
 Blip_Buffer::Blip_Buffer()
 {
@@ -36,6 +51,7 @@ Blip_Buffer::Blip_Buffer()
 	clock_rate_ = 0;
 	bass_freq_ = 16;
 	length_ = 0;
+	select_kernels();		// // //
 
 	// assumptions code makes about implementation-defined features
 	#ifndef NDEBUG
@@ -43,7 +59,7 @@ Blip_Buffer::Blip_Buffer()
 		long i = LONG_MIN;
 		assert( (i >> 1) == LONG_MIN / 2 );
 		i = LONG_MIN;
-		assert( (i >> 31) == -1 );
+		assert( (i >> (sizeof i * CHAR_BIT - 1)) == -1 );
 
 		// casting to smaller signed type truncates bits and extends sign
 		i = (SHRT_MAX + 1) * 5;
@@ -90,6 +106,8 @@ Blip_Buffer::blargg_err_t Blip_Buffer::set_sample_rate( long new_rate, int msec
 
 	buffer_size_ = new_size;
 
+	select_kernels();		// // //
+
 	// update things based on the sample rate
 	sample_rate_ = new_rate;
 	length_ = new_size * 1000 / new_rate - 1;
@@ -165,10 +183,43 @@ void Blip_Buffer::remove_samples( long count )
 	}
 }
 
+// // // State snapshots
+
+long Blip_Buffer::state_size() const
+{
+	return 2 + samples_avail() + buffer_extra;
+}
+
+void Blip_Buffer::save_state( long* out ) const
+{
+	out [0] = (long) offset_;
+	out [1] = reader_accum;
+	for ( long i = 0; i < samples_avail() + buffer_extra; i++ )		// // //
+		out [2 + i] = buffer_ [i];
+}
+
+Blip_Buffer::blargg_err_t Blip_Buffer::load_state( long const* in, long count )
+{
+	if ( count < 2 )
+		return "Invalid buffer state";
+	blip_resampled_time_t offset = (blip_resampled_time_t) in [0];
+	long samples = (long) (offset >> BLIP_BUFFER_ACCURACY);
+	if ( samples > buffer_size_ || count != 2 + samples + buffer_extra )
+		return "Invalid buffer state";
+
+	clear();
+	offset_ = offset;
+	reader_accum = in [1];
+	for ( long i = 0; i < samples + buffer_extra; i++ )		// // //
+		buffer_ [i] = (buf_t_) in [2 + i];
+	return 0;
+}
+
 // Blip_Synth_
 
-Blip_Synth_::Blip_Synth_( short* p, int w ) :
+Blip_Synth_::Blip_Synth_( short* p, short* k, int w ) :
 	impulses( p ),
+	kernels( k ),
 	width( w )
 {
 	volume_unit_ = 0.0;
@@ -253,6 +304,29 @@ void Blip_Synth_::adjust_impulse()
 	//for ( int i = blip_res; i--; printf( "\n" ) )
 	//  for ( int j = 0; j < width / 2; j++ )
 	//      printf( "%5ld,", impulses [j * blip_res + i + 1] );
+
+	update_kernels();		// // //
+}
+
+// // // Rearrange impulses into one contiguous kernel per phase, padded with zeros to
+// the widest impulse and by blip_kernel_pad_ on both sides. Kernel k of a phase is
+// added to the k-th sample from the transition, the same taps that
+// Blip_Synth::offset_resampled() adds.
+void Blip_Synth_::update_kernels()
+{
+	int const fwd = (blip_widest_impulse_ - width) / 2;
+	for ( int phase = 0; phase < blip_res; phase++ )
+	{
+		short* out = kernels + phase * blip_kernel_size_;
+		for ( int k = 0; k < blip_kernel_size_; k++ )
+			out [k] = 0;
+		out += blip_kernel_pad_;
+		for ( int k = 0; k < width / 2; k++ )
+		{
+			out [fwd + k] = impulses [blip_res - phase + blip_res * k];
+			out [fwd + width - 1 - k] = impulses [phase + blip_res * k];
+		}
+	}
 }
 
 void Blip_Synth_::treble_eq( blip_eq_t const& eq )
@@ -363,6 +437,278 @@ int dither(long size)
 }
 #endif
 
+// // // SIMD kernels
+
+typedef Blip_Buffer::buf_t_ buf_t_;
+
+// Finds the kernel and buffer position of a transition. Kernels are padded with
+// blip_kernel_pad_ zeros on both sides.
+static inline long blip_impulse_pos( Blip_Buffer* blip_buf, short const* kernels,
+		Blip_Buffer::blip_resampled_time_t time, short const*& kernel )
+{
+	// Fails if time is beyond end of Blip_Buffer
+	assert( (long) (time >> BLIP_BUFFER_ACCURACY) < blip_buf->buffer_size_ );
+	int phase = (int) (time >> (BLIP_BUFFER_ACCURACY - BLIP_PHASE_BITS) & (blip_res - 1));
+	kernel = kernels + phase * blip_kernel_size_ + blip_kernel_pad_;
+	return (long) (time >> BLIP_BUFFER_ACCURACY);
+}
+
+// Defines the batched and the single transition entry points of a kernel which adds
+// one impulse at a buffer index
+#define BLIP_IMPULSE_KERNELS( name, target ) \
+	target static void add_impulses_##name( Blip_Buffer* blip_buf, short const* kernels, \
+			blip_time_t const* times, int const* deltas, int count, int delta_factor ) \
+	{ \
+		for ( int n = 0; n < count; n++ ) \
+		{ \
+			short const* kernel; \
+			long index = blip_impulse_pos( blip_buf, kernels, \
+				times [n] * blip_buf->factor_ + blip_buf->offset_, kernel ); \
+			add_impulse_##name( blip_buf->buffer_, index, kernel, deltas [n] * delta_factor ); \
+		} \
+	} \
+	target static void add_impulse_resampled_##name( Blip_Buffer* blip_buf, short const* kernels, \
+			Blip_Buffer::blip_resampled_time_t time, int delta ) \
+	{ \
+		short const* kernel; \
+		long index = blip_impulse_pos( blip_buf, kernels, time, kernel ); \
+		add_impulse_##name( blip_buf->buffer_, index, kernel, delta ); \
+	}
+
+static inline void add_impulse_scalar( buf_t_* buffer, long index, short const* kernel, int delta )
+{
+	buf_t_* buf = buffer + index;
+	for ( int k = 0; k < blip_widest_impulse_; k++ )
+		buf [k] += kernel [k] * delta;
+}
+
+BLIP_IMPULSE_KERNELS( scalar, )
+
+static void mix_samples_scalar( buf_t_* out, blip_sample_t const* in, long count )
+{
+	int const sample_shift = blip_sample_bits - 16;
+	int prev = 0;
+	while ( count-- )
+	{
+		buf_t_ s = (buf_t_) *in++ << sample_shift;
+		*out += s - prev;
+		prev = s;
+		++out;
+	}
+	*out -= prev;
+}
+
+#ifdef BLIP_X86
+// The vector kernels always add to whole vectors at a multiple of the vector width
+// from the start of the buffer, moving the kernel instead. Close transitions then
+// access identical vectors, which avoids store forwarding stalls.
+
+BLIP_TARGET_SSE2
+static inline void add_impulse_sse2( buf_t_* buffer, long index, short const* kernel, int delta )
+{
+	int const width = 4;
+	int const shift = (int) (index & (width - 1));
+	buf_t_* buf = buffer + index - shift;
+	kernel -= shift;
+
+	__m128i const d = _mm_set1_epi32( delta );
+	for ( int k = 0; k < blip_widest_impulse_ + width; k += width )
+	{
+		__m128i* dest = (__m128i*) (buf + k);
+		__m128i const c16 = _mm_loadl_epi64( (__m128i const*) (kernel + k) );
+		__m128i const c = _mm_srai_epi32( _mm_unpacklo_epi16( c16, c16 ), 16 );
+
+		// SSE2 has no 32-bit multiplication, the low halves of the unsigned 64-bit
+		// products are the same for signed operands
+		__m128i const p02 = _mm_mul_epu32( c, d );
+		__m128i const p13 = _mm_mul_epu32( _mm_srli_epi64( c, 32 ), d );
+		__m128i const p = _mm_unpacklo_epi32( _mm_shuffle_epi32( p02, _MM_SHUFFLE( 0, 0, 2, 0 ) ),
+			_mm_shuffle_epi32( p13, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+		_mm_storeu_si128( dest, _mm_add_epi32( _mm_loadu_si128( dest ), p ) );
+	}
+}
+
+BLIP_IMPULSE_KERNELS( sse2, BLIP_TARGET_SSE2 )
+
+BLIP_TARGET_SSE2
+static void mix_samples_sse2( buf_t_* out, blip_sample_t const* in, long count )
+{
+	int const sample_shift = blip_sample_bits - 16;
+	if ( !count )
+		return mix_samples_scalar( out, in, count );
+
+	// first sample has no predecessor
+	*out++ += (buf_t_) *in << sample_shift;
+	long i = 1;
+	for ( ; i + 8 <= count; i += 8 )
+	{
+		__m128i const cur = _mm_loadu_si128( (__m128i const*) (in + i) );
+		__m128i const prev = _mm_loadu_si128( (__m128i const*) (in + i - 1) );
+		__m128i const diff [2] = {
+			_mm_slli_epi32( _mm_sub_epi32( _mm_srai_epi32( _mm_unpacklo_epi16( cur, cur ), 16 ),
+				_mm_srai_epi32( _mm_unpacklo_epi16( prev, prev ), 16 ) ), sample_shift ),
+			_mm_slli_epi32( _mm_sub_epi32( _mm_srai_epi32( _mm_unpackhi_epi16( cur, cur ), 16 ),
+				_mm_srai_epi32( _mm_unpackhi_epi16( prev, prev ), 16 ) ), sample_shift ),
+		};
+		for ( int j = 0; j < 2; j++ )
+		{
+			__m128i* dest = (__m128i*) (out + j * 4);
+			_mm_storeu_si128( dest, _mm_add_epi32( _mm_loadu_si128( dest ), diff [j] ) );
+		}
+		out += 8;
+	}
+	for ( ; i < count; i++ )
+		*out++ += ((buf_t_) in [i] << sample_shift) - ((buf_t_) in [i - 1] << sample_shift);
+	*out -= (buf_t_) in [count - 1] << sample_shift;
+}
+
+BLIP_TARGET_AVX2
+static inline void add_impulse_avx2( buf_t_* buffer, long index, short const* kernel, int delta )
+{
+	int const width = 8;
+	int const shift = (int) (index & (width - 1));
+	buf_t_* buf = buffer + index - shift;
+	kernel -= shift;
+
+	__m256i const d = _mm256_set1_epi32( delta );
+	for ( int k = 0; k < blip_widest_impulse_ + width; k += width )
+	{
+		__m256i* dest = (__m256i*) (buf + k);
+		__m256i const c = _mm256_cvtepi16_epi32( _mm_loadu_si128( (__m128i const*) (kernel + k) ) );
+		_mm256_storeu_si256( dest, _mm256_add_epi32( _mm256_loadu_si256( dest ), _mm256_mullo_epi32( c, d ) ) );
+	}
+}
+
+BLIP_IMPULSE_KERNELS( avx2, BLIP_TARGET_AVX2 )
+
+BLIP_TARGET_AVX2
+static void mix_samples_avx2( buf_t_* out, blip_sample_t const* in, long count )
+{
+	int const sample_shift = blip_sample_bits - 16;
+	if ( !count )
+		return mix_samples_scalar( out, in, count );
+
+	// first sample has no predecessor
+	*out++ += (buf_t_) *in << sample_shift;
+	long i = 1;
+	for ( ; i + 8 <= count; i += 8 )
+	{
+		__m256i const cur = _mm256_cvtepi16_epi32( _mm_loadu_si128( (__m128i const*) (in + i) ) );
+		__m256i const prev = _mm256_cvtepi16_epi32( _mm_loadu_si128( (__m128i const*) (in + i - 1) ) );
+		__m256i const diff = _mm256_slli_epi32( _mm256_sub_epi32( cur, prev ), sample_shift );
+		_mm256_storeu_si256( (__m256i*) out, _mm256_add_epi32( _mm256_loadu_si256( (__m256i const*) out ), diff ) );
+		out += 8;
+	}
+	for ( ; i < count; i++ )
+		*out++ += ((buf_t_) in [i] << sample_shift) - ((buf_t_) in [i - 1] << sample_shift);
+	*out -= (buf_t_) in [count - 1] << sample_shift;
+}
+#endif
+
+#undef BLIP_IMPULSE_KERNELS
+
+static bool blip_supports( blip_simd_t simd )
+{
+	switch ( simd )
+	{
+	case blip_simd_none:
+		return true;
+#ifdef BLIP_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+	case blip_simd_sse2: {
+		int info [4];
+		__cpuid( info, 1 );
+		return (info [3] & (1 << 26)) != 0;
+	}
+	case blip_simd_avx2: {
+		int info [4];
+		__cpuid( info, 0 );
+		if ( info [0] < 7 )
+			return false;
+		__cpuid( info, 1 );
+		if ( (info [2] & (1 << 27)) == 0 || (_xgetbv( 0 ) & 6) != 6 ) // OS saves AVX registers
+			return false;
+		__cpuidex( info, 7, 0 );
+		return (info [1] & (1 << 5)) != 0;
+	}
+#else
+	case blip_simd_sse2:
+		return __builtin_cpu_supports( "sse2" );
+	case blip_simd_avx2:
+		return __builtin_cpu_supports( "avx2" );
+#endif
+#endif
+	default:
+		return false;
+	}
+}
+
+namespace {
+
+struct blip_kernels_t {
+	blip_simd_t simd = blip_simd_none;
+	void (*add_impulses)( Blip_Buffer*, short const*, blip_time_t const*, int const*, int, int ) = &add_impulses_scalar;
+	void (*add_impulse_resampled)( Blip_Buffer*, short const*, Blip_Buffer::blip_resampled_time_t, int ) = &add_impulse_resampled_scalar;
+	void (*mix_samples)( buf_t_*, blip_sample_t const*, long ) = &mix_samples_scalar;
+
+	void select( blip_simd_t target )
+	{
+		while ( !blip_supports( target ) )
+			target = (blip_simd_t) (target - 1);
+		simd = target;
+		switch ( target )
+		{
+#ifdef BLIP_X86
+		case blip_simd_avx2:
+			add_impulses = &add_impulses_avx2;
+			add_impulse_resampled = &add_impulse_resampled_avx2;
+			mix_samples = &mix_samples_avx2;
+			break;
+		case blip_simd_sse2:
+			add_impulses = &add_impulses_sse2;
+			add_impulse_resampled = &add_impulse_resampled_sse2;
+			mix_samples = &mix_samples_sse2;
+			break;
+#endif
+		default:
+			add_impulses = &add_impulses_scalar;
+			add_impulse_resampled = &add_impulse_resampled_scalar;
+			mix_samples = &mix_samples_scalar;
+		}
+	}
+};
+
+blip_kernels_t& blip_kernels()
+{
+	static blip_kernels_t kernels = [] {
+		blip_kernels_t k;
+		k.select( blip_simd_avx2 );
+		return k;
+	}();
+	return kernels;
+}
+
+} // namespace
+
+blip_simd_t blip_get_simd()
+{
+	return blip_kernels().simd;
+}
+
+blip_simd_t blip_set_simd( blip_simd_t simd )
+{
+	blip_kernels().select( simd );
+	return blip_get_simd();
+}
+
+void Blip_Buffer::select_kernels()
+{
+	blip_kernels_t const& k = blip_kernels();
+	add_impulses_ = k.add_impulses;
+	add_impulse_resampled_ = k.add_impulse_resampled;
+	mix_samples_ = k.mix_samples;
+}
+
 long Blip_Buffer::read_samples( blip_sample_t* out, long max_samples, int stereo )
 {
 	long count = samples_avail();
@@ -419,16 +765,6 @@ long Blip_Buffer::read_samples( blip_sample_t* out, long max_samples, int stereo
 void Blip_Buffer::mix_samples( blip_sample_t const* in, long count )
 {
 	buf_t_* out = buffer_ + (offset_ >> BLIP_BUFFER_ACCURACY) + blip_widest_impulse_ / 2;
-
-	int const sample_shift = blip_sample_bits - 16;
-	int prev = 0;
-	while ( count-- )
-	{
-		long s = (long) *in++ << sample_shift;
-		*out += s - prev;
-		prev = s;
-		++out;
-	}
-	*out -= prev;
+	mix_samples_( out, in, count );		// // //
 }
 
@@ -6,6 +6,8 @@
 #ifndef BLIP_BUFFER_H
 #define BLIP_BUFFER_H
 
+#include <stdint.h>		// // //
+
 // Time unit at source clock rate
 typedef long blip_time_t;
 
@@ -76,6 +78,17 @@ public:
 	// buffer becomes full.
 	blip_time_t count_clocks( long count ) const;
 
+	// // // Number of elements written by save_state()
+	long state_size() const;
+
+	// // // Save the unread samples, the tails of impulses added past them and the
+	// read position to 'out'
+	void save_state( long* out ) const;
+
+	// // // Restore a state saved from a buffer with the same sample rate, clock rate
+	// and length. Returns NULL on success, otherwise returns error without affecting the buffer.
+	blargg_err_t load_state( long const* in, long count );
+
 	// not documented yet
 	typedef unsigned long blip_resampled_time_t;
 	void remove_silence( long count );
@@ -95,12 +108,17 @@ private:
 	Blip_Buffer( const Blip_Buffer& );
 	Blip_Buffer& operator = ( const Blip_Buffer& );
 public:
-	typedef long buf_t_;
+	typedef int32_t buf_t_;		// // // 32 bits on every platform, as with 32-bit long
 	unsigned long factor_;
 	blip_resampled_time_t offset_;
 	buf_t_* buffer_;
 	long buffer_size_;
+	// // // SIMD kernels used with this buffer, selected by set_sample_rate()
+	void (*add_impulses_)( Blip_Buffer*, short const* kernels, blip_time_t const* times, int const* deltas, int count, int delta_factor );
+	void (*add_impulse_resampled_)( Blip_Buffer*, short const* kernels, blip_resampled_time_t, int delta );
+	void (*mix_samples_)( buf_t_* out, blip_sample_t const* in, long count );
 private:
+	void select_kernels();		// // //
 	long reader_accum;
 	int bass_shift;
 	long sample_rate_;
@@ -130,26 +148,48 @@ private:
 	// Internal
 	typedef unsigned long blip_resampled_time_t;
 	int const blip_widest_impulse_ = 16;
+	int const blip_kernel_pad_ = 8;		// // //
+	int const blip_kernel_size_ = blip_widest_impulse_ + blip_kernel_pad_ * 2;
 	int const blip_res = 1 << BLIP_PHASE_BITS;
 	class blip_eq_t;
 
 	class Blip_Synth_ {
 		double volume_unit_;
 		short* const impulses;
+		short* const kernels;		// // //
 		int const width;
 		long kernel_unit;
 		int impulses_size() const { return blip_res / 2 * width + 1; }
 		void adjust_impulse();
+		void update_kernels();		// // //
 	public:
 		Blip_Buffer* buf;
 		int last_amp;
 		int delta_factor;
 
-		Blip_Synth_( short* impulses, int width );
+		Blip_Synth_( short* impulses, short* kernels, int width );		// // //
 		void treble_eq( blip_eq_t const& );
 		void volume_unit( double );
+		void offset_batch( blip_time_t const* times, int const* deltas, int count, Blip_Buffer* blip_buf ) const {		// // //
+			blip_buf->add_impulses_( blip_buf, kernels, times, deltas, count, delta_factor );
+		}
+		void offset_resampled( blip_resampled_time_t time, int delta, Blip_Buffer* blip_buf ) const {		// // //
+			blip_buf->add_impulse_resampled_( blip_buf, kernels, time, delta * delta_factor );
+		}
 	};
 
+// // // SIMD kernels used by Blip_Synth and Blip_Buffer::mix_samples, the best supported
+// one is selected on startup; all give identical output
+enum blip_simd_t { blip_simd_none, blip_simd_sse2, blip_simd_avx2 };
+
+// Currently used SIMD kernels
+blip_simd_t blip_get_simd();
+
+// Select SIMD kernels, falls back to the best supported kernels below 'simd'.
+// Returns the kernels actually selected. Buffers pick them up in their next
+// set_sample_rate() call.
+blip_simd_t blip_set_simd( blip_simd_t simd );
+
 // Quality level. Start with blip_good_quality.
 const int blip_med_quality  = 8;
 const int blip_good_quality = 12;
@@ -183,6 +223,11 @@ public:
 	void offset( blip_time_t, int delta, Blip_Buffer* ) const;
 	void offset( blip_time_t t, int delta ) const { offset( t, delta, impl.buf ); }
 
+	// // // Same as calling offset() for each transition, but uses SIMD kernels
+	void offset_batch( blip_time_t const* times, int const* deltas, int count, Blip_Buffer* buf ) const {
+		impl.offset_batch( times, deltas, count, buf );
+	}
+
 	// Works directly in terms of fractional output samples. Contact author for more.
 	void offset_resampled( blip_resampled_time_t, int delta, Blip_Buffer* ) const;
 
@@ -195,10 +240,11 @@ public:
 	}
 
 public:
-	explicit Blip_Synth(double range) : impl( impulses, quality ), range_( range < 0. ? -range : range ) { }		// // //
+	explicit Blip_Synth(double range) : impl( impulses, kernels, quality ), range_( range < 0. ? -range : range ) { }		// // //
 private:
 	typedef short imp_t;
 	imp_t impulses [blip_res * (quality / 2) + 1];
+	imp_t kernels [blip_res * blip_kernel_size_];		// // // impulses for each phase, see update_kernels()
 	Blip_Synth_ impl;
 	double range_;
 };
@@ -260,61 +306,13 @@ const long blip_unscaled = 65535;
 const int blip_low_quality  = blip_med_quality;
 const int blip_best_quality = blip_high_quality;
 
-#define BLIP_FWD( i ) {                     \
-	long t0 = i0 * delta + buf [fwd + i];   \
-	long t1 = imp [blip_res * (i + 1)] * delta + buf [fwd + 1 + i]; \
-	i0 = imp [blip_res * (i + 2)];          \
-	buf [fwd + i] = t0;                     \
-	buf [fwd + 1 + i] = t1; }
-
-#define BLIP_REV( r ) {                     \
-	long t0 = i0 * delta + buf [rev - r];   \
-	long t1 = imp [blip_res * r] * delta + buf [rev + 1 - r];   \
-	i0 = imp [blip_res * (r - 1)];          \
-	buf [rev - r] = t0;                     \
-	buf [rev + 1 - r] = t1; }
-
 template<int quality>		// // //
 inline void Blip_Synth<quality>::offset_resampled( blip_resampled_time_t time,
 		int delta, Blip_Buffer* blip_buf ) const
 {
-	// Fails if time is beyond end of Blip_Buffer, due to a bug in caller code or the
-	// need for a longer buffer as set by set_sample_rate().
-	assert( (long) (time >> BLIP_BUFFER_ACCURACY) < blip_buf->buffer_size_ );
-	delta *= impl.delta_factor;
-	int phase = (int) (time >> (BLIP_BUFFER_ACCURACY - BLIP_PHASE_BITS) & (blip_res - 1));
-	imp_t const* imp = impulses + blip_res - phase;
-	long* buf = blip_buf->buffer_ + (time >> BLIP_BUFFER_ACCURACY);
-	long i0 = *imp;
-
-	int const fwd = (blip_widest_impulse_ - quality) / 2;
-	int const rev = fwd + quality - 2;
-
-	BLIP_FWD( 0 )
-	if constexpr ( quality > 8  ) BLIP_FWD( 2 )		// // //
-	if constexpr ( quality > 12 ) BLIP_FWD( 4 )
-	{
-		int const mid = quality / 2 - 1;
-		long t0 = i0 * delta + buf [fwd + mid - 1];
-		long t1 = imp [blip_res * mid] * delta + buf [fwd + mid];
-		imp = impulses + phase;
-		i0 = imp [blip_res * mid];
-		buf [fwd + mid - 1] = t0;
-		buf [fwd + mid] = t1;
-	}
-	if constexpr ( quality > 12 ) BLIP_REV( 6 )		// // //
-	if constexpr ( quality > 8  ) BLIP_REV( 4 )
-	BLIP_REV( 2 )
-
-	long t0 = i0 * delta + buf [rev];
-	long t1 = *imp * delta + buf [rev + 1];
-	buf [rev] = t0;
-	buf [rev + 1] = t1;
+	impl.offset_resampled( time, delta, blip_buf );
 }
 
-#undef BLIP_FWD
-#undef BLIP_REV
-
 template<int quality>		// // //
 void Blip_Synth<quality>::offset( blip_time_t t, int delta, Blip_Buffer* buf ) const
 {
@@ -24,11 +24,35 @@
 #include "APU/Types.h"
 #include <cstring>
 #include <cmath>
+#include <algorithm>		// // //
 
 namespace xgm {
 
 const int RC_BITS = 12;
 
+namespace {
+
+// 8 bit approximation of master volume
+const double MASTER_VOL = 2.4 * 1223.0; // max FDS vol vs max APU square (arbitrarily 1223)
+const double MAX_OUT = 32.0f * 63.0f; // value that should map to master vol
+const int32_t MASTER[4] = {
+    int((MASTER_VOL / MAX_OUT) * 256.0 * 2.0f / 2.0f),
+    int((MASTER_VOL / MAX_OUT) * 256.0 * 2.0f / 3.0f),
+    int((MASTER_VOL / MAX_OUT) * 256.0 * 2.0f / 4.0f),
+    int((MASTER_VOL / MAX_OUT) * 256.0 * 2.0f / 5.0f) };
+
+// // // clocks until a 16-bit phase accumulator reaches the next table step
+uint32_t StepClocks (uint32_t phase, int32_t f)
+{
+    if (f > 0)
+        return (0x10000 - (phase & 0xFFFF) + f - 1) / f;
+    if (f < 0)
+        return ((phase & 0xFFFF) - f) / -f;
+    return NES_FDS::NO_EVENT;
+}
+
+} // namespace
+
 NES_FDS::NES_FDS ()
 {
     option[OPT_CUTOFF] = 2000;
@@ -44,10 +68,6 @@ NES_FDS::NES_FDS ()
     Reset();
 }
 
-NES_FDS::~NES_FDS ()
-{
-}
-
 void NES_FDS::SetClock (double c)
 {
     clock = c;
@@ -137,18 +157,19 @@ void NES_FDS::Tick (uint32_t clocks)
             {
                 env_timer[i] += clocks;
                 uint32_t period = ((env_speed[i]+1) * master_env_speed) << 3;
-                while (env_timer[i] >= period)
+                if (env_timer[i] >= period)
                 {
-                    // clock the envelope
+                    // // // clock the envelope as many times as needed at once
+                    uint32_t steps = env_timer[i] / period;
                     if (env_mode[i])
                     {
-                        if (env_out[i] < 32) ++env_out[i];
+                        if (env_out[i] < 32) env_out[i] = std::min(env_out[i] + steps, 32u);
                     }
                     else
                     {
-                        if (env_out[i] > 0 ) --env_out[i];
+                        env_out[i] -= std::min(env_out[i], steps);
                     }
-                    env_timer[i] -= period;
+                    env_timer[i] -= steps * period;
                 }
             }
         }
@@ -183,40 +204,8 @@ void NES_FDS::Tick (uint32_t clocks)
     // clock the wav table
     if (!wav_halt)
     {
-        // complex mod calculation
-        int32_t mod = 0;
-        if (env_out[EMOD] != 0) // skip if modulator off
-        {
-            // convert mod_pos to 7-bit signed
-            int32_t pos = (mod_pos < 64) ? mod_pos : (mod_pos-128);
-
-            // multiply pos by gain,
-            // shift off 4 bits but with odd "rounding" behaviour
-            int32_t temp = pos * env_out[EMOD];
-            int32_t rem = temp & 0x0F;
-            temp >>= 4;
-            if ((rem > 0) && ((temp & 0x80) == 0))
-            {
-                if (pos < 0) temp -= 1;
-                else         temp += 2;
-            }
-
-            // wrap if range is exceeded
-            while (temp >= 192) temp -= 256;
-            while (temp <  -64) temp += 256;
-
-            // multiply result by pitch,
-            // shift off 6 bits, round to nearest
-            temp = freq[TWAV] * temp;
-            rem = temp & 0x3F;
-            temp >>= 6;
-            if (rem >= 32) temp += 1;
-
-            mod = temp;
-        }
-
         // advance wavetable position
-        int32_t f = freq[TWAV] + mod;
+        int32_t f = freq[TWAV] + CalcMod();		// // //
         phase[TWAV] = phase[TWAV] + (clocks * f);
         phase[TWAV] = phase[TWAV] & 0x3FFFFF; // wrap
 
@@ -242,17 +231,84 @@ void NES_FDS::Tick (uint32_t clocks)
     last_vol = vol_out;
 }
 
-int32_t NES_FDS::Render ()		// // //
+int32_t NES_FDS::CalcMod () const		// // //
+{
+    // complex mod calculation
+    if (env_out[EMOD] == 0) // skip if modulator off
+        return 0;
+
+    // convert mod_pos to 7-bit signed
+    int32_t pos = (mod_pos < 64) ? mod_pos : (mod_pos-128);
+
+    // multiply pos by gain,
+    // shift off 4 bits but with odd "rounding" behaviour
+    int32_t temp = pos * env_out[EMOD];
+    int32_t rem = temp & 0x0F;
+    temp >>= 4;
+    if ((rem > 0) && ((temp & 0x80) == 0))
+    {
+        if (pos < 0) temp -= 1;
+        else         temp += 2;
+    }
+
+    // wrap if range is exceeded
+    while (temp >= 192) temp -= 256;
+    while (temp <  -64) temp += 256;
+
+    // multiply result by pitch,
+    // shift off 6 bits, round to nearest
+    temp = freq[TWAV] * temp;
+    rem = temp & 0x3F;
+    temp >>= 6;
+    if (rem >= 32) temp += 1;
+
+    return temp;
+}
+
+uint32_t NES_FDS::NextEvent () const		// // //
 {
-    // 8 bit approximation of master volume
-    const double MASTER_VOL = 2.4 * 1223.0; // max FDS vol vs max APU square (arbitrarily 1223)
-    const double MAX_OUT = 32.0f * 63.0f; // value that should map to master vol
-    const int32_t MASTER[4] = {
-        int((MASTER_VOL / MAX_OUT) * 256.0 * 2.0f / 2.0f),
-        int((MASTER_VOL / MAX_OUT) * 256.0 * 2.0f / 3.0f),
-        int((MASTER_VOL / MAX_OUT) * 256.0 * 2.0f / 4.0f),
-        int((MASTER_VOL / MAX_OUT) * 256.0 * 2.0f / 5.0f) };
+    uint32_t next = NO_EVENT;
 
+    // envelope clocks, unless the envelope is already at its limit
+    if (!env_halt && !wav_halt && (master_env_speed != 0))
+    {
+        for (int i=0; i<2; ++i)
+        {
+            if (!env_disable[i] && (env_mode[i] ? env_out[i] < 32 : env_out[i] > 0))
+            {
+                uint32_t period = ((env_speed[i]+1) * master_env_speed) << 3;
+                next = std::min(next, env_timer[i] < period ? period - env_timer[i] : 1u);
+            }
+        }
+    }
+
+    if (!wav_halt)
+    {
+        // mod table steps only matter while the modulator is on
+        if (!mod_halt && (env_out[EMOD] != 0))
+            next = std::min(next, StepClocks(phase[TMOD], freq[TMOD]));
+
+        // the wav table advances at a constant rate between the events above,
+        // its steps only matter while they are audible
+        if (!wav_write && (env_out[EVOL] != 0))
+            next = std::min(next, StepClocks(phase[TWAV], freq[TWAV] + CalcMod()));
+    }
+
+    return next;
+}
+
+bool NES_FDS::IsSettled () const		// // //
+{
+    int32_t out = fout;
+    if (!wav_write)
+        out = wave[TWAV][(phase[TWAV]>>16)&0x3F] * std::min(env_out[EVOL], 32u);
+
+    int32_t v = out * MASTER[master_vol] >> 8;
+    return (((rc_accum * rc_k) + (v * rc_l)) >> RC_BITS) == rc_accum;
+}
+
+int32_t NES_FDS::Render ()		// // //
+{
     int32_t v = fout * MASTER[master_vol] >> 8;
 
     // lowpass RC filter
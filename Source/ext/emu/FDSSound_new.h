@@ -78,13 +78,23 @@ protected:
     int32_t rc_k;
     int32_t rc_l;
 
+    int32_t CalcMod () const;		// // //
+
 public:
+    // // // returned by NextEvent if nothing is scheduled to happen
+    static constexpr uint32_t NO_EVENT = UINT32_MAX;
+
     NES_FDS ();
-    ~ NES_FDS ();
+    ~ NES_FDS () = default;		// // // trivially copyable for state snapshots
 
     void Reset ();
     void Tick (uint32_t clocks);
     int32_t Render ();		// // //
+    // // // clocks until the next wav table step, mod table step or envelope
+    // clock that can change the output, Tick may run in one go until then
+    uint32_t NextEvent () const;
+    // // // true if Render would return the same value until the next event
+    bool IsSettled () const;
     bool Write (uint32_t adr, uint32_t val);
     bool Read (uint32_t adr, uint32_t & val);
     void SetRate (double);
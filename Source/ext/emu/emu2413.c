@@ -73,6 +73,7 @@ SOFTWARE.
 **************************************************************************************/
 #include "ext/emu/emu2413.h"		// // //
 #include <stdlib.h>
+#include <stddef.h>		// // //
 #include <string.h>
 #include <math.h>
 
@@ -162,17 +163,16 @@ static uint8_t default_inst[OPLL_TONE_NUM][(16 + 3) * 16] = {
 #define EXPAND_BITS_X(x,s,d) (((x)<<((d)-(s)))|((1<<((d)-(s)))-1))
 
 /* Adjust envelope speed which depends on sampling rate. */
-#define RATE_ADJUST(x) (rate==49716?x:(uint32_t)((double)(x)*clk/72/rate + 0.5)) /* added 0.5 to round the value*/
+#define RATE_ADJUST(o,x) ((o)->rate==49716?x:(uint32_t)((double)(x)*(o)->clk/72/(o)->rate + 0.5)) /* added 0.5 to round the value*/
 
 #define MOD(o,x) (&(o)->slot[(x)<<1])
 #define CAR(o,x) (&(o)->slot[((x)<<1)|1])
 
 #define BIT(s,b) (((s)>>(b))&1)
 
-/* Input clock */
-static uint32_t clk = 844451141;
-/* Sampling rate */
-static uint32_t rate = 3354932;
+/* Tables below are independent of clock and rate, and are shared by all
+   OPLL objects. They are built once by OPLL_init and never written again. */
+static int tables_ready = 0;
 
 /* WaveTable for each envelope amp */
 static uint16_t fullsintable[PG_WIDTH];
@@ -184,10 +184,6 @@ static uint16_t *waveform[2] = { fullsintable, halfsintable };
 static int32_t pmtable[PM_PG_WIDTH];
 static int32_t amtable[AM_PG_WIDTH];
 
-/* Phase delta for LFO */
-static uint32_t pm_dphase;
-static uint32_t am_dphase;
-
 /* dB to Liner table */
 static int16_t DB2LIN_TABLE[(DB_MUTE + DB_MUTE) * 2];
 
@@ -204,21 +200,10 @@ static OPLL_PATCH default_patch[OPLL_TONE_NUM][(16 + 3) * 2];
 enum OPLL_EG_STATE
 { READY, ATTACK, DECAY, SUSHOLD, SUSTINE, RELEASE, SETTLE, FINISH };
 
-/* Phase incr table for Attack */
-static uint32_t dphaseARTable[16][16];
-/* Phase incr table for Decay and Release */
-static uint32_t dphaseDRTable[16][16];
-
 /* KSL + TL Table */
 static uint32_t tllTable[16][8][1 << TL_BITS][4];
 static int32_t rksTable[2][8][2];
 
-/* Phase incr table for PG */
-static uint32_t dphaseTable[512][8][16];
-
-// Added by jsr
-int16_t opll_volumes[10];		// // //
-
 /***************************************************
 
                   Create tables
@@ -329,7 +314,7 @@ makeAmTable (void)
 
 /* Phase increment counter table */
 static void
-makeDphaseTable (void)
+makeDphaseTable (OPLL * opll)
 {
   uint32_t fnum, block, ML;
   uint32_t mltable[16] =
@@ -338,7 +323,7 @@ makeDphaseTable (void)
   for (fnum = 0; fnum < 512; fnum++)
     for (block = 0; block < 8; block++)
       for (ML = 0; ML < 16; ML++)
-        dphaseTable[fnum][block][ML] = RATE_ADJUST (((fnum * mltable[ML]) << block) >> (20 - DP_BITS));
+        opll->dphaseTable[fnum][block][ML] = RATE_ADJUST (opll, ((fnum * mltable[ML]) << block) >> (20 - DP_BITS));
 }
 
 static void
@@ -376,7 +361,7 @@ makeTllTable (void)
 
 /* Rate Table for Attack */
 static void
-makeDphaseARTable (void)
+makeDphaseARTable (OPLL * opll)
 {
   int32_t AR, Rks, RM, RL;
 
@@ -390,13 +375,13 @@ makeDphaseARTable (void)
       switch (AR)
       {
       case 0:
-        dphaseARTable[AR][Rks] = 0;
+        opll->dphaseARTable[AR][Rks] = 0;
         break;
       case 15:
-        dphaseARTable[AR][Rks] = 0;/*EG_DP_WIDTH;*/
+        opll->dphaseARTable[AR][Rks] = 0;/*EG_DP_WIDTH;*/
         break;
       default:
-        dphaseARTable[AR][Rks] = RATE_ADJUST ((3 * (RL + 4) << (RM + 1)));
+        opll->dphaseARTable[AR][Rks] = RATE_ADJUST (opll, (3 * (RL + 4) << (RM + 1)));
         break;
       }
     }
@@ -404,7 +389,7 @@ makeDphaseARTable (void)
 
 /* Rate Table for Decay and Release */
 static void
-makeDphaseDRTable (void)
+makeDphaseDRTable (OPLL * opll)
 {
   int32_t DR, Rks, RM, RL;
 
@@ -418,10 +403,10 @@ makeDphaseDRTable (void)
       switch (DR)
       {
       case 0:
-        dphaseDRTable[DR][Rks] = 0;
+        opll->dphaseDRTable[DR][Rks] = 0;
         break;
       default:
-        dphaseDRTable[DR][Rks] = RATE_ADJUST ((RL + 4) << (RM - 1));
+        opll->dphaseDRTable[DR][Rks] = RATE_ADJUST (opll, (RL + 4) << (RM - 1));
         break;
       }
     }
@@ -532,33 +517,33 @@ OPLL_patch2dump (const OPLL_PATCH * patch, uint8_t * dump)
 ************************************************************/
 
 static inline uint32_t
-calc_eg_dphase (OPLL_SLOT * slot)
+calc_eg_dphase (const OPLL * opll, const OPLL_SLOT * slot)
 {
 
   switch (slot->eg_mode)
   {
   case ATTACK:
-    return dphaseARTable[slot->patch->AR][slot->rks];
+    return opll->dphaseARTable[slot->patch->AR][slot->rks];
 
   case DECAY:
-    return dphaseDRTable[slot->patch->DR][slot->rks];
+    return opll->dphaseDRTable[slot->patch->DR][slot->rks];
 
   case SUSHOLD:
     return 0;
 
   case SUSTINE:
-    return dphaseDRTable[slot->patch->RR][slot->rks];
+    return opll->dphaseDRTable[slot->patch->RR][slot->rks];
 
   case RELEASE:
     if (slot->sustine)
-      return dphaseDRTable[5][slot->rks];
+      return opll->dphaseDRTable[5][slot->rks];
     else if (slot->patch->EG)
-      return dphaseDRTable[slot->patch->RR][slot->rks];
+      return opll->dphaseDRTable[slot->patch->RR][slot->rks];
     else
-      return dphaseDRTable[7][slot->rks];
+      return opll->dphaseDRTable[7][slot->rks];
 
   case SETTLE:
-    return dphaseDRTable[15][0];
+    return opll->dphaseDRTable[15][0];
 
   case FINISH:
     return 0;
@@ -580,49 +565,49 @@ calc_eg_dphase (OPLL_SLOT * slot)
 #define SLOT_TOM 16
 #define SLOT_CYM 17
 
-#define UPDATE_PG(S)  (S)->dphase = dphaseTable[(S)->fnum][(S)->block][(S)->patch->ML]
+#define UPDATE_PG(O,S)  (S)->dphase = (O)->dphaseTable[(S)->fnum][(S)->block][(S)->patch->ML]
 #define UPDATE_TLL(S)\
 (((S)->type==0)?\
 ((S)->tll = tllTable[((S)->fnum)>>5][(S)->block][(S)->patch->TL][(S)->patch->KL]):\
 ((S)->tll = tllTable[((S)->fnum)>>5][(S)->block][(S)->volume][(S)->patch->KL]))
 #define UPDATE_RKS(S) (S)->rks = rksTable[((S)->fnum)>>8][(S)->block][(S)->patch->KR]
 #define UPDATE_WF(S)  (S)->sintbl = waveform[(S)->patch->WF]
-#define UPDATE_EG(S)  (S)->eg_dphase = calc_eg_dphase(S)
-#define UPDATE_ALL(S)\
-  UPDATE_PG(S);\
+#define UPDATE_EG(O,S)  (S)->eg_dphase = calc_eg_dphase(O,S)
+#define UPDATE_ALL(O,S)\
+  UPDATE_PG(O,S);\
   UPDATE_TLL(S);\
   UPDATE_RKS(S);\
   UPDATE_WF(S); \
-  UPDATE_EG(S) /* EG should be updated last. */
+  UPDATE_EG(O,S) /* EG should be updated last. */
 
 
 /* Slot key on  */
 static inline void
-slotOn (OPLL_SLOT * slot)
+slotOn (const OPLL * opll, OPLL_SLOT * slot)
 {
   slot->eg_mode = ATTACK;
   slot->eg_phase = 0;
   slot->phase = 0;
-  UPDATE_EG(slot);
+  UPDATE_EG (opll, slot);
 }
 
 /* Slot key on without reseting the phase */
 static inline void
-slotOn2 (OPLL_SLOT * slot)
+slotOn2 (const OPLL * opll, OPLL_SLOT * slot)
 {
   slot->eg_mode = ATTACK;
   slot->eg_phase = 0;
-  UPDATE_EG(slot);
+  UPDATE_EG (opll, slot);
 }
 
 /* Slot key off */
 static inline void
-slotOff (OPLL_SLOT * slot)
+slotOff (const OPLL * opll, OPLL_SLOT * slot)
 {
   if (slot->eg_mode == ATTACK)
     slot->eg_phase = EXPAND_BITS (AR_ADJUST_TABLE[HIGHBITS (slot->eg_phase, EG_DP_BITS - EG_BITS)], EG_BITS, EG_DP_BITS);
   slot->eg_mode = RELEASE;
-  UPDATE_EG(slot);
+  UPDATE_EG (opll, slot);
 }
 
 /* Channel key on */
@@ -630,9 +615,9 @@ static inline void
 keyOn (OPLL * opll, int32_t i)
 {
   if (!opll->slot_on_flag[i * 2])
-    slotOn (MOD(opll,i));
+    slotOn (opll, MOD(opll,i));
   if (!opll->slot_on_flag[i * 2 + 1])
-    slotOn (CAR(opll,i));
+    slotOn (opll, CAR(opll,i));
   opll->key_status[i] = 1;
 }
 
@@ -641,7 +626,7 @@ static inline void
 keyOff (OPLL * opll, int32_t i)
 {
   if (opll->slot_on_flag[i * 2 + 1])
-    slotOff (CAR(opll,i));
+    slotOff (opll, CAR(opll,i));
   opll->key_status[i] = 0;
 }
 
@@ -655,28 +640,28 @@ static inline void
 keyOn_SD (OPLL * opll)
 {
   if (!opll->slot_on_flag[SLOT_SD])
-    slotOn (CAR(opll,7));
+    slotOn (opll, CAR(opll,7));
 }
 
 static inline void
 keyOn_TOM (OPLL * opll)
 {
   if (!opll->slot_on_flag[SLOT_TOM])
-    slotOn (MOD(opll,8));
+    slotOn (opll, MOD(opll,8));
 }
 
 static inline void
 keyOn_HH (OPLL * opll)
 {
   if (!opll->slot_on_flag[SLOT_HH])
-    slotOn2 (MOD(opll,7));
+    slotOn2 (opll, MOD(opll,7));
 }
 
 static inline void
 keyOn_CYM (OPLL * opll)
 {
   if (!opll->slot_on_flag[SLOT_CYM])
-    slotOn2 (CAR(opll,8));
+    slotOn2 (opll, CAR(opll,8));
 }
 
 /* Drum key off */
@@ -690,28 +675,28 @@ static inline void
 keyOff_SD (OPLL * opll)
 {
   if (opll->slot_on_flag[SLOT_SD])
-    slotOff (CAR(opll,7));
+    slotOff (opll, CAR(opll,7));
 }
 
 static inline void
 keyOff_TOM (OPLL * opll)
 {
   if (opll->slot_on_flag[SLOT_TOM])
-    slotOff (MOD(opll,8));
+    slotOff (opll, MOD(opll,8));
 }
 
 static inline void
 keyOff_HH (OPLL * opll)
 {
   if (opll->slot_on_flag[SLOT_HH])
-    slotOff (MOD(opll,7));
+    slotOff (opll, MOD(opll,7));
 }
 
 static inline void
 keyOff_CYM (OPLL * opll)
 {
   if (opll->slot_on_flag[SLOT_CYM])
-    slotOff (CAR(opll,8));
+    slotOff (opll, CAR(opll,8));
 }
 
 /* Change a voice */
@@ -887,36 +872,32 @@ OPLL_SLOT_reset (OPLL_SLOT * slot, int type)
 }
 
 static void
-internal_refresh (void)
+internal_refresh (OPLL * opll)
 {
-  makeDphaseTable ();
-  makeDphaseARTable ();
-  makeDphaseDRTable ();
-  pm_dphase = (uint32_t) RATE_ADJUST (PM_SPEED * PM_DP_WIDTH / (clk / 72));
-  am_dphase = (uint32_t) RATE_ADJUST (AM_SPEED * AM_DP_WIDTH / (clk / 72));
+  makeDphaseTable (opll);
+  makeDphaseARTable (opll);
+  makeDphaseDRTable (opll);
+  opll->pm_dphase = (uint32_t) RATE_ADJUST (opll, PM_SPEED * PM_DP_WIDTH / (opll->clk / 72));
+  opll->am_dphase = (uint32_t) RATE_ADJUST (opll, AM_SPEED * AM_DP_WIDTH / (opll->clk / 72));
 }
 
-static void
-maketables (uint32_t c, uint32_t r)
+// // // Builds the shared tables; call once before creating OPLL objects on
+// several threads, OPLL_new does this lazily otherwise
+void
+OPLL_init (void)
 {
-  if (c != clk)
-  {
-    clk = c;
-    makePmTable ();
-    makeAmTable ();
-    makeDB2LinTable ();
-    makeAdjustTable ();
-    makeTllTable ();
-    makeRksTable ();
-    makeSinTable ();
-    makeDefaultPatch ();
-  }
+  if (tables_ready)
+    return;
 
-  if (r != rate)
-  {
-    rate = r;
-    internal_refresh ();
-  }
+  makePmTable ();
+  makeAmTable ();
+  makeDB2LinTable ();
+  makeAdjustTable ();
+  makeTllTable ();
+  makeRksTable ();
+  makeSinTable ();
+  makeDefaultPatch ();
+  tables_ready = 1;
 }
 
 OPLL *
@@ -925,12 +906,16 @@ OPLL_new (uint32_t c, uint32_t r)		// // //
   OPLL *opll;
   int32_t i;
 
-  maketables (c, r);
+  OPLL_init ();
 
   opll = (OPLL *) calloc (sizeof (OPLL), 1);
   if (opll == NULL)
     return NULL;
 
+  opll->clk = c;
+  opll->rate = r;
+  internal_refresh (opll);
+
   for (i = 0; i < 19 * 2; i++)
     memcpy(&opll->patch[i],&null_patch,sizeof(OPLL_PATCH));
 
@@ -990,8 +975,8 @@ OPLL_reset (OPLL * opll)
   for (i = 0; i < 0x40; i++)
     OPLL_writeReg (opll, i, 0);
 
-  opll->realstep = (uint32_t) ((1 << 31) / rate);
-  opll->opllstep = (uint32_t) ((1 << 31) / (clk / 72));
+  opll->realstep = (uint32_t) ((1 << 31) / opll->rate);
+  opll->opllstep = (uint32_t) ((1 << 31) / (opll->clk / 72));
   opll->oplltime = 0;
   for (i = 0; i < 14; i++)
     opll->pan[i] = 2;
@@ -1012,11 +997,11 @@ OPLL_forceRefresh (OPLL * opll)
 
   for (i = 0; i < 18; i++)
   {
-    UPDATE_PG (&opll->slot[i]);
+    UPDATE_PG (opll, &opll->slot[i]);
     UPDATE_RKS (&opll->slot[i]);
     UPDATE_TLL (&opll->slot[i]);
     UPDATE_WF (&opll->slot[i]);
-    UPDATE_EG (&opll->slot[i]);
+    UPDATE_EG (opll, &opll->slot[i]);
   }
 }
 
@@ -1024,18 +1009,18 @@ void
 OPLL_set_rate (OPLL * opll, uint32_t r)
 {
   if (opll->quality)
-    rate = 49716;
+    opll->rate = 49716;
   else
-    rate = r;
-  internal_refresh ();
-  rate = r;
+    opll->rate = r;
+  internal_refresh (opll);
+  opll->rate = r;
 }
 
 void
 OPLL_set_quality (OPLL * opll, uint32_t q)
 {
   opll->quality = q;
-  OPLL_set_rate (opll, rate);
+  OPLL_set_rate (opll, opll->rate);
 }
 
 /*********************************************************
@@ -1072,8 +1057,8 @@ OPLL_set_quality (OPLL * opll, uint32_t q)
 static void
 update_ampm (OPLL * opll)
 {
-  opll->pm_phase = (opll->pm_phase + pm_dphase) & (PM_DP_WIDTH - 1);
-  opll->am_phase = (opll->am_phase + am_dphase) & (AM_DP_WIDTH - 1);
+  opll->pm_phase = (opll->pm_phase + opll->pm_dphase) & (PM_DP_WIDTH - 1);
+  opll->am_phase = (opll->am_phase + opll->am_dphase) & (AM_DP_WIDTH - 1);
   opll->lfo_am = amtable[HIGHBITS (opll->am_phase, AM_DP_BITS - AM_PG_BITS)];
   opll->lfo_pm = pmtable[HIGHBITS (opll->pm_phase, PM_DP_BITS - PM_PG_BITS)];
 }
@@ -1102,7 +1087,7 @@ update_noise (OPLL * opll)
 
 /* EG */
 static void
-calc_envelope (OPLL_SLOT * slot, int32_t lfo)
+calc_envelope (const OPLL * opll, OPLL_SLOT * slot, int32_t lfo)
 {
 #define S2E(x) (SL2EG((int32_t)(x/SL_STEP))<<(EG_DP_BITS-EG_BITS))
 
@@ -1123,7 +1108,7 @@ calc_envelope (OPLL_SLOT * slot, int32_t lfo)
       egout = 0;
       slot->eg_phase = 0;
       slot->eg_mode = DECAY;
-      UPDATE_EG (slot);
+      UPDATE_EG (opll, slot);
     }
     break;
 
@@ -1136,13 +1121,13 @@ calc_envelope (OPLL_SLOT * slot, int32_t lfo)
       {
         slot->eg_phase = SL[slot->patch->SL];
         slot->eg_mode = SUSHOLD;
-        UPDATE_EG (slot);
+        UPDATE_EG (opll, slot);
       }
       else
       {
         slot->eg_phase = SL[slot->patch->SL];
         slot->eg_mode = SUSTINE;
-        UPDATE_EG (slot);
+        UPDATE_EG (opll, slot);
       }
     }
     break;
@@ -1152,7 +1137,7 @@ calc_envelope (OPLL_SLOT * slot, int32_t lfo)
     if (slot->patch->EG == 0)
     {
       slot->eg_mode = SUSTINE;
-      UPDATE_EG (slot);
+      UPDATE_EG (opll, slot);
     }
     break;
 
@@ -1174,7 +1159,7 @@ calc_envelope (OPLL_SLOT * slot, int32_t lfo)
     {
       slot->eg_mode = ATTACK;
       egout = (1 << EG_BITS) - 1;
-      UPDATE_EG(slot);
+      UPDATE_EG (opll, slot);
     }
     break;
 
@@ -1337,7 +1322,7 @@ update_output (OPLL * opll)
   for (i = 0; i < 18; i++)
   {
     calc_phase(&opll->slot[i],opll->lfo_pm);
-    calc_envelope(&opll->slot[i],opll->lfo_am);
+    calc_envelope(opll,&opll->slot[i],opll->lfo_am);
   }
 
   /* CH1-6 */
@@ -1346,8 +1331,8 @@ update_output (OPLL * opll)
     {
       opll->ch_out[i] += calc_slot_car (CAR(opll,i), calc_slot_mod(MOD(opll,i))) * INST_VOL_MULT;
 	  int16_t absvol = abs(opll->ch_out[i]);
-      if (absvol > opll_volumes[i])
-        opll_volumes[i] = absvol;
+      if (absvol > opll->chan_vol[i])
+        opll->chan_vol[i] = absvol;
     }
 
   /* CH7 */
@@ -1426,6 +1411,61 @@ OPLL_calc (OPLL * opll)
   return mix_output(opll);
 }
 
+/* Renders several samples at once, same as calling OPLL_calc for each of them */
+void
+OPLL_calc_block (OPLL * opll, int16_t * out, uint32_t samples)		// // //
+{
+  uint32_t i;
+
+  if (!opll->quality)
+  {
+    for (i = 0; i < samples; i++)
+    {
+      update_output(opll);
+      out[i] = mix_output(opll);
+    }
+    return;
+  }
+
+  for (i = 0; i < samples; i++)
+  {
+    while (opll->realstep > opll->oplltime)
+    {
+      opll->oplltime += opll->opllstep;
+      update_output(opll);
+    }
+    opll->oplltime -= opll->realstep;
+    out[i] = mix_output(opll);
+  }
+}
+
+/* Same as OPLL_calc_block, also writes the output of the first chans channels to chan_out,
+   null entries are skipped */
+void
+OPLL_calc_block_split (OPLL * opll, int16_t * out, int16_t *const * chan_out, uint32_t chans, uint32_t samples)		// // //
+{
+  uint32_t i, ch;
+
+  for (i = 0; i < samples; i++)
+  {
+    if (!opll->quality)
+      update_output(opll);
+    else
+    {
+      while (opll->realstep > opll->oplltime)
+      {
+        opll->oplltime += opll->opllstep;
+        update_output(opll);
+      }
+      opll->oplltime -= opll->realstep;
+    }
+    out[i] = mix_output(opll);
+    for (ch = 0; ch < chans; ch++)
+      if (chan_out[ch])
+        chan_out[ch][i] = opll->ch_out[ch];
+  }
+}
+
 static inline void
 mix_output_stereo(OPLL *opll, int32_t out[2]) {
   int ch;
@@ -1516,9 +1556,9 @@ OPLL_writeReg (OPLL * opll, uint32_t reg, uint32_t data)
     {
       if (opll->patch_number[i] == 0)
       {
-        UPDATE_PG (MOD(opll,i));
+        UPDATE_PG (opll, MOD(opll,i));
         UPDATE_RKS (MOD(opll,i));
-        UPDATE_EG (MOD(opll,i));
+        UPDATE_EG (opll, MOD(opll,i));
       }
     }
     break;
@@ -1533,9 +1573,9 @@ OPLL_writeReg (OPLL * opll, uint32_t reg, uint32_t data)
     {
       if (opll->patch_number[i] == 0)
       {
-        UPDATE_PG (CAR(opll,i));
+        UPDATE_PG (opll, CAR(opll,i));
         UPDATE_RKS (CAR(opll,i));
-        UPDATE_EG (CAR(opll,i));
+        UPDATE_EG (opll, CAR(opll,i));
       }
     }
     break;
@@ -1574,7 +1614,7 @@ OPLL_writeReg (OPLL * opll, uint32_t reg, uint32_t data)
     {
       if (opll->patch_number[i] == 0)
       {
-        UPDATE_EG (MOD(opll,i));
+        UPDATE_EG (opll, MOD(opll,i));
       }
     }
     break;
@@ -1586,7 +1626,7 @@ OPLL_writeReg (OPLL * opll, uint32_t reg, uint32_t data)
     {
       if (opll->patch_number[i] == 0)
       {
-        UPDATE_EG(CAR(opll,i));
+        UPDATE_EG (opll, CAR(opll,i));
       }
     }
     break;
@@ -1598,7 +1638,7 @@ OPLL_writeReg (OPLL * opll, uint32_t reg, uint32_t data)
     {
       if (opll->patch_number[i] == 0)
       {
-        UPDATE_EG (MOD(opll,i));
+        UPDATE_EG (opll, MOD(opll,i));
       }
     }
     break;
@@ -1610,7 +1650,7 @@ OPLL_writeReg (OPLL * opll, uint32_t reg, uint32_t data)
     {
       if (opll->patch_number[i] == 0)
       {
-        UPDATE_EG (CAR(opll,i));
+        UPDATE_EG (opll, CAR(opll,i));
       }
     }
     break;
@@ -1642,12 +1682,12 @@ OPLL_writeReg (OPLL * opll, uint32_t reg, uint32_t data)
     }
     update_key_status (opll);
 
-    UPDATE_ALL (MOD(opll,6));
-    UPDATE_ALL (CAR(opll,6));
-    UPDATE_ALL (MOD(opll,7));
-    UPDATE_ALL (CAR(opll,7));
-    UPDATE_ALL (MOD(opll,8));
-    UPDATE_ALL (CAR(opll,8));
+    UPDATE_ALL (opll, MOD(opll,6));
+    UPDATE_ALL (opll, CAR(opll,6));
+    UPDATE_ALL (opll, MOD(opll,7));
+    UPDATE_ALL (opll, CAR(opll,7));
+    UPDATE_ALL (opll, MOD(opll,8));
+    UPDATE_ALL (opll, CAR(opll,8));
 
     break;
 
@@ -1665,8 +1705,8 @@ OPLL_writeReg (OPLL * opll, uint32_t reg, uint32_t data)
   case 0x18:
     ch = reg - 0x10;
     setFnumber (opll, ch, data + ((opll->reg[0x20 + ch] & 1) << 8));
-    UPDATE_ALL (MOD(opll,ch));
-    UPDATE_ALL (CAR(opll,ch));
+    UPDATE_ALL (opll, MOD(opll,ch));
+    UPDATE_ALL (opll, CAR(opll,ch));
     break;
 
   case 0x20:
@@ -1686,8 +1726,8 @@ OPLL_writeReg (OPLL * opll, uint32_t reg, uint32_t data)
       keyOn (opll, ch);
     else
       keyOff (opll, ch);
-    UPDATE_ALL (MOD(opll,ch));
-    UPDATE_ALL (CAR(opll,ch));
+    UPDATE_ALL (opll, MOD(opll,ch));
+    UPDATE_ALL (opll, CAR(opll,ch));
     update_key_status (opll);
     update_rhythm_mode (opll);
     break;
@@ -1722,8 +1762,8 @@ OPLL_writeReg (OPLL * opll, uint32_t reg, uint32_t data)
       setPatch (opll, reg - 0x30, i);
     }
     setVolume (opll, reg - 0x30, v << 2);
-    UPDATE_ALL (MOD(opll,reg - 0x30));
-    UPDATE_ALL (CAR(opll,reg - 0x30));
+    UPDATE_ALL (opll, MOD(opll,reg - 0x30));
+    UPDATE_ALL (opll, CAR(opll,reg - 0x30));
     break;
 
   default:
@@ -1749,9 +1789,44 @@ OPLL_set_pan (OPLL * opll, uint32_t ch, uint32_t pan)
 }
 
 
-int16_t OPLL_getchanvol(int i)
+int16_t OPLL_getchanvol(OPLL *opll, int i)		// // //
 {
-	int16_t retval = opll_volumes[i];
-	opll_volumes[i] = 0;
+	int16_t retval = opll->chan_vol[i];
+	opll->chan_vol[i] = 0;
 	return retval;
 }
+
+// // // The emulation state precedes the clock and rate dependent tables, the slot pointers
+// into the patches and waveforms are stored as indices after it
+#define OPLL_STATE_BYTES offsetof(OPLL, clk)
+
+uint32_t OPLL_getStateSize(void)
+{
+	return (uint32_t)(OPLL_STATE_BYTES + sizeof(int32_t) * 18 * 2);
+}
+
+void OPLL_saveState(const OPLL *opll, uint8_t *buf)
+{
+	int32_t i, index[18 * 2];
+
+	memcpy(buf, opll, OPLL_STATE_BYTES);
+	for (i = 0; i < 18; i++) {
+		const OPLL_SLOT *slot = &opll->slot[i];
+		index[i * 2] = slot->patch == &null_patch ? -1 : (int32_t)(slot->patch - opll->patch);
+		index[i * 2 + 1] = slot->sintbl == halfsintable ? 1 : 0;
+	}
+	memcpy(buf + OPLL_STATE_BYTES, index, sizeof(index));
+}
+
+void OPLL_loadState(OPLL *opll, const uint8_t *buf)
+{
+	int32_t i, index[18 * 2];
+
+	memcpy(opll, buf, OPLL_STATE_BYTES);
+	memcpy(index, buf + OPLL_STATE_BYTES, sizeof(index));
+	for (i = 0; i < 18; i++) {
+		OPLL_SLOT *slot = &opll->slot[i];
+		slot->patch = index[i * 2] < 0 ? &null_patch : &opll->patch[index[i * 2]];
+		slot->sintbl = waveform[index[i * 2 + 1] & 1];
+	}
+}
@@ -125,8 +125,23 @@ typedef struct __OPLL {
   /* Output of each channels / 0-8:TONE, 9:BD 10:HH 11:SD, 12:TOM, 13:CYM, 14:Reserved for DAC */
   int16_t ch_out[15];
 
+  /* Peak output of each tone channel since the last OPLL_getchanvol */
+  int16_t chan_vol[9];		// // //
+
+  /* Clock and rate dependent tables */
+  uint32_t clk ;
+  uint32_t rate ;
+  uint32_t pm_dphase ;
+  uint32_t am_dphase ;
+  uint32_t dphaseARTable[16][16] ;
+  uint32_t dphaseDRTable[16][16] ;
+  uint32_t dphaseTable[512][8][16] ;
+
 } OPLL ;
 
+/* Shared tables */
+void OPLL_init(void) ;		// // //
+
 /* Create Object */
 OPLL *OPLL_new(uint32_t clk, uint32_t rate) ;
 void OPLL_delete(OPLL *) ;
@@ -144,6 +159,8 @@ void OPLL_writeReg(OPLL *, uint32_t reg, uint32_t val) ;
 
 /* Synthsize */
 int16_t OPLL_calc(OPLL *) ;
+void OPLL_calc_block(OPLL *, int16_t *out, uint32_t samples) ;		// // //
+void OPLL_calc_block_split(OPLL *, int16_t *out, int16_t *const *chan_out, uint32_t chans, uint32_t samples) ;		// // //
 void OPLL_calc_stereo(OPLL *, int32_t out[2]) ;
 
 /* Misc */
@@ -159,7 +176,12 @@ void OPLL_getDefaultPatch(int32_t type, int32_t num, OPLL_PATCH *) ;
 uint32_t OPLL_setMask(OPLL *, uint32_t mask) ;
 uint32_t OPLL_toggleMask(OPLL *, uint32_t mask) ;
 
-int16_t OPLL_getchanvol(int i);
+int16_t OPLL_getchanvol(OPLL *, int i);		// // //
+
+/* State snapshot, restored into an OPLL with the same clock and rate */
+uint32_t OPLL_getStateSize(void);		// // //
+void OPLL_saveState(const OPLL *, uint8_t *buf);		// // //
+void OPLL_loadState(OPLL *, const uint8_t *buf);		// // //
 
 #ifdef __cplusplus
 }